@@ -5,18 +5,81 @@
 #include <UI.hpp>
 #include <Board.hpp>
 #include <MoveGenerator.hpp>
+#include <MovePrecomputer.hpp>
 #include <AudioManager.hpp>
+#include <MoveEvents.hpp>
+#include <AssetLoader.hpp>
+#include <DebugOverlay.hpp>
+#include <Analyser.hpp>
+#include <AnalysisOverlay.hpp>
+#include <EnginePlayer.hpp>
+#include <Bitbase.hpp>
+#include <Tablebase.hpp>
+#include <cstdlib>
+#include <cstring>
 
 const int SQUARE_SIZE = 75;
 const int BOARD_SIZE = 8;
 
+// Longest the game loop sleeps waiting for an event. Nothing is redrawn unless something changed.
+const int EVENT_TIMEOUT_MS = 250;
+
+// How often the analysis overlay picks up new results while analysis mode is on
+const int ANALYSIS_REFRESH_MS = 100;
+
+// Thinking time per move of the engine opponent, unless given with --time or --depth
+const int ENGINE_DEFAULT_TIME_MS = 1000;
+
+// The side the engine plays, if any, and the event its worker sends when a move is ready
+struct EngineOpponent {
+    EnginePlayer* player = nullptr;
+    bool playsWhite = false;
+    Uint32 moveEvent = 0;
+};
+
 bool initSDL();
 SDL_Window* createWindow();
 SDL_Renderer* createRenderer(SDL_Window* window);
-void gameLoop(SDL_Renderer* renderer, Board& chessBoard, MoveGenerator& moveGenerator, UI& ui, AudioManager& audioManager);
+void gameLoop(SDL_Renderer* renderer, Board& chessBoard, MoveGenerator& moveGenerator, MovePrecomputer& movePrecomputer, Analyser& analyser, EngineOpponent& engine, UI& ui, AudioManager& audioManager, AssetLoader& assetLoader, Uint64 launchTime);
 
 int main(int argc, char *argv[]){
 
+    // Cold start is timed from here to the first frame and to the last asset
+    Uint64 launchTime = SDL_GetPerformanceCounter();
+
+    // --engine white|black lets the engine play that side, --time MS and --depth N limit each of its moves
+    // A depth alone searches to that depth however long it takes. --tablebases DIR gives the engine and the
+    // analysis the endgame tablebases and bitbases in that directory.
+    const char* engineSide = nullptr;
+    const char* tablebaseDirectory = nullptr;
+    SearchLimits engineLimits;
+    bool hasTime = false, hasDepth = false;
+    for (int i = 1; i < argc; i += 2) {
+        // Every option takes a value, so one left without it at the end gets the usage like an unknown one
+        const char* option = i + 1 < argc ? argv[i] : "";
+        if (std::strcmp(option, "--engine") == 0) engineSide = argv[i + 1];
+        else if (std::strcmp(option, "--time") == 0) hasTime = (engineLimits.timeMs = std::atoi(argv[i + 1])) > 0;
+        else if (std::strcmp(option, "--depth") == 0) hasDepth = (engineLimits.maxDepth = std::atoi(argv[i + 1])) > 0;
+        else if (std::strcmp(option, "--tablebases") == 0) tablebaseDirectory = argv[i + 1];
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--engine white|black] [--time MS] [--depth N] [--tablebases DIR]" << std::endl;
+            return -1;
+        }
+    }
+    if (!hasTime && !hasDepth) engineLimits.timeMs = ENGINE_DEFAULT_TIME_MS;
+    if (!hasDepth) engineLimits.maxDepth = MAX_PLY - 1;
+    if (engineSide && std::strcmp(engineSide, "white") != 0 && std::strcmp(engineSide, "black") != 0) {
+        std::cerr << "--engine takes white or black" << std::endl;
+        return -1;
+    }
+
+    Tablebases tablebases;
+    Bitbases bitbases;
+    if (tablebaseDirectory) {
+        std::cout << tablebases.open(tablebaseDirectory) << " tablebases found in " << tablebaseDirectory << std::endl;
+        std::cout << bitbases.open(tablebaseDirectory) << " bitbases found in " << tablebaseDirectory << std::endl;
+    }
+
     // Initialise SDL
     if (!initSDL()) return -1;
     
@@ -28,15 +91,41 @@ int main(int argc, char *argv[]){
     SDL_Renderer* renderer = createRenderer(window);
     if (!renderer) return -1;
 
-    // Initialise Game
-    AudioManager audioManager;
-    Board chessBoard(audioManager);
+    // Initialise Game, with images and sounds decoded in the background while the board is already shown
+    AudioManager audioManager(false);
+    AssetLoader assetLoader;
+    for (const auto& file : SOUND_FILES) assetLoader.loadSound(file.first, file.second);
+
+    Board chessBoard;
     MoveGenerator moveGenerator(chessBoard);
+    MovePrecomputer movePrecomputer(chessBoard);
+    Analyser analyser(chessBoard, &tablebases, &bitbases);
+
+    // The engine's worker wakes the game loop with an event once its move is ready
+    EngineOpponent engine;
+    engine.moveEvent = SDL_RegisterEvents(1);
+    EnginePlayer enginePlayer(chessBoard, engineLimits, [&engine]() {
+        SDL_Event event;
+        SDL_zero(event);
+        event.type = engine.moveEvent;
+        SDL_PushEvent(&event);
+    }, &tablebases, &bitbases);
+    if (engineSide) {
+        engine.player = &enginePlayer;
+        engine.playsWhite = std::strcmp(engineSide, "white") == 0;
+    }
     UI ui(renderer, &chessBoard, SQUARE_SIZE);
-    ui.loadImages();
+    ui.loadImages(assetLoader);
 
     // Main Game
-    gameLoop(renderer, chessBoard, moveGenerator, ui, audioManager);
+    gameLoop(renderer, chessBoard, moveGenerator, movePrecomputer, analyser, engine, ui, audioManager, assetLoader, launchTime);
+
+    if (bitbases.getTableCount()) {
+        BitbaseCounters counters = bitbases.getCounters();
+        std::cout << "Bitbases: " << counters.probes << " probes, "
+                  << (counters.probes ? 100.0 * counters.hits / counters.probes : 0.0) << "% hits, "
+                  << counters.averageNanoseconds << " ns per probe" << std::endl;
+    }
 
     // Cleanup
     SDL_DestroyRenderer(renderer);
@@ -85,14 +174,12 @@ void handleMouseDown (int mouseX, int mouseY, PieceType& selectedPiece, int& sel
     int bitPos = row * 8 + col;
     U64 mask = 1ULL << bitPos;
 
-    // Check which piece has a corresponding bit set at that location.
-    for(const auto& [type, bitboard] : chessBoard.getCurrentBoard()){
-        if(bitboard & mask){
-            selectedPiece = type;
-            selectedPieceX = col;
-            selectedPieceY = row;
-            break;
-        }
+    // Check which piece is on that square
+    PieceType piece = chessBoard.getPieceAtPosition(bitPos);
+    if (piece != PieceType::EMPTY) {
+        selectedPiece = piece;
+        selectedPieceX = col;
+        selectedPieceY = row;
     }
 
     // Log the selected piece (to ensure valid piece was selected)
@@ -115,7 +202,7 @@ void handleMouseDown (int mouseX, int mouseY, PieceType& selectedPiece, int& sel
 }
 
 // Handle mouse up events
-void handleMouseUp (int releaseX, int releaseY, PieceType& selectedPiece, int& selectedPieceX, int& selectedPieceY, Board& chessBoard, MoveGenerator& moveGenerator, bool& isWhiteTurn, AudioManager& audioManager, U64& validMoves) {
+void handleMouseUp (int releaseX, int releaseY, PieceType& selectedPiece, int& selectedPieceX, int& selectedPieceY, Board& chessBoard, MoveGenerator& moveGenerator, bool& isWhiteTurn, MoveEventQueue& moveEvents, U64& validMoves, bool& isInCheck) {
 
     // Convert mouse coordinates to bitboard position and chessboard coordinates
     int releaseRow = 7 - releaseY / SQUARE_SIZE;
@@ -145,7 +232,9 @@ void handleMouseUp (int releaseX, int releaseY, PieceType& selectedPiece, int& s
     if (validMoves & releaseMask) {
 
         
-        chessBoard.executeMove(selectedPiece, selectedPiecePos, releaseBitPos);
+        Move move = {selectedPiece, selectedPiecePos, releaseBitPos, PieceType::EMPTY};
+        bool isCapture = chessBoard.executeMove(selectedPiece, selectedPiecePos, releaseBitPos);
+        moveEvents.push(isCapture ? MoveEventType::CAPTURE : MoveEventType::MOVE, move);
         moveGenerator.updatePieces();
 
         // Switch turn only after valid move
@@ -156,7 +245,9 @@ void handleMouseUp (int releaseX, int releaseY, PieceType& selectedPiece, int& s
         cout << "Release Bit Pos: " << releaseBitPos << endl;
         chessBoard.printU64(1ULL << releaseBitPos);
 
-        if (moveGenerator.isKingInCheck(isWhiteTurn)) audioManager.playSound(AudioType::CHECK);
+        // Check status only changes when a move is made, so it is worked out here once and cached
+        isInCheck = moveGenerator.isKingInCheck(isWhiteTurn);
+        if (isInCheck) moveEvents.push(MoveEventType::CHECK, move);
     
     }
 
@@ -168,30 +259,140 @@ void handleMouseUp (int releaseX, int releaseY, PieceType& selectedPiece, int& s
 
 
 
-void gameLoop (SDL_Renderer* renderer, Board& chessBoard, MoveGenerator& moveGenerator, UI& ui, AudioManager& audioManager) {
+// Announces the end of the game once the side to move has no legal moves. Returns true if it is over.
+bool checkGameOver(Board& chessBoard, MoveGenerator& moveGenerator, MoveEventQueue& moveEvents, bool isInCheck) {
+
+    if (moveGenerator.hasLegalMove()) return false;
+
+    if (isInCheck) {
+        moveEvents.push(MoveEventType::CHECKMATE);
+        std::cout << "Checkmate! " << (chessBoard.isWhiteToMove() ? "Black" : "White") << " wins" << std::endl;
+    } else {
+        moveEvents.push(MoveEventType::STALEMATE);
+        std::cout << "Stalemate!" << std::endl;
+    }
+    return true;
+
+}
+
+// Plays the engine's move on the board, the way handleMouseUp plays the player's
+void playEngineMove(const SearchResult& result, Board& chessBoard, MoveGenerator& moveGenerator, bool& isWhiteTurn, MoveEventQueue& moveEvents, bool& isInCheck) {
+
+    const Move& move = result.bestMove;
+    bool isCapture = chessBoard.executeMove(move.piece, move.fromPos, move.toPos, move.promotion);
+    moveEvents.push(isCapture ? MoveEventType::CAPTURE : MoveEventType::MOVE, move);
+    moveGenerator.updatePieces();
+    isWhiteTurn = !isWhiteTurn;
+
+    std::cout << "Engine played " << pieceTypeToString(move.piece) << " " << char('a' + move.fromPos % 8) << 1 + move.fromPos / 8
+              << char('a' + move.toPos % 8) << 1 + move.toPos / 8 << " (depth " << result.depth << ", score " << result.score
+              << ", " << result.nodes << " nodes in " << result.seconds << " s)" << std::endl;
+
+    isInCheck = moveGenerator.isKingInCheck(isWhiteTurn);
+    if (isInCheck) moveEvents.push(MoveEventType::CHECK, move);
+
+}
+
+// Sound for each kind of event, false for events that make none
+bool moveEventSound(MoveEventType type, AudioType& sound) {
+    switch (type) {
+        case MoveEventType::GAME_START: sound = AudioType::START; return true;
+        case MoveEventType::MOVE: sound = AudioType::MOVE; return true;
+        case MoveEventType::CAPTURE: sound = AudioType::CAPTURE; return true;
+        case MoveEventType::CHECK: sound = AudioType::CHECK; return true;
+        case MoveEventType::CHECKMATE: sound = AudioType::CHECKMATE; return true;
+        default: return false;
+    }
+}
+
+// Hands decoded images to the UI and sounds to the audio manager. Returns true if any image arrived.
+bool receiveAssets(AssetLoader& assetLoader, UI& ui, AudioManager& audioManager) {
+
+    bool hasImages = false;
+    for (LoadedAsset& asset : assetLoader.collect()) {
+        if (asset.surface) {
+            ui.addImage(asset.piece, asset.surface);
+            hasImages = true;
+        }
+        if (asset.chunk) audioManager.addSound(asset.sound, asset.chunk);
+    }
+
+    // Once everything is in, the atlas is built for the last time and its source surfaces freed
+    bool isDone = assetLoader.isDone();
+    if (hasImages || isDone) ui.uploadImages(isDone);
+    return hasImages || isDone;
+
+}
+
+double secondsSince(Uint64 start) {
+    return static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+}
+
+void gameLoop (SDL_Renderer* renderer, Board& chessBoard, MoveGenerator& moveGenerator, MovePrecomputer& movePrecomputer, Analyser& analyser, EngineOpponent& engine, UI& ui, AudioManager& audioManager, AssetLoader& assetLoader, Uint64 launchTime) {
     SDL_Event windowEvent;
-    PieceType selectedPiece;
+    PieceType selectedPiece = PieceType::EMPTY;
     int selectedPieceX, selectedPieceY;
     U64 validMoves = 0;
     bool isWhiteTurn = true;
+    bool isInCheck = moveGenerator.isKingInCheck(isWhiteTurn);
+    bool needsRedraw = true;
+    bool running = true;
+    bool isFirstFrame = true;
+    bool isLoading = true;
+    DebugOverlay debugOverlay(renderer);
+    AnalysisOverlay analysisOverlay(renderer, SQUARE_SIZE);
+    uint64_t analysisGeneration = 0;
+    bool isGameOver = false;
+
+    // Sounds follow the moves through this queue rather than being played by the board
+    MoveEventQueue moveEvents;
+    moveEvents.push(MoveEventType::GAME_START);
+
+    auto isEngineTurn = [&]() { return engine.player && isWhiteTurn == engine.playsWhite; };
+
+    // Everything that follows a move by either side: the next side's moves are worked out in the background
+    // while it thinks, analysis moves on to the new position, and the engine starts on its reply
+    auto onTurnChanged = [&]() {
+        movePrecomputer.request(chessBoard);
+        if (analysisOverlay.isVisible()) {
+            analysisGeneration = analyser.analyse(chessBoard);
+            analysisOverlay.clear();
+        }
+        isGameOver = checkGameOver(chessBoard, moveGenerator, moveEvents, isInCheck);
+        if (!isGameOver && isEngineTurn()) engine.player->think(chessBoard);
+    };
+
+    if (isEngineTurn()) engine.player->think(chessBoard);
+
+    while(running){
+
+        // Sleep until there is an event instead of spinning, then handle everything queued before drawing once.
+        // A pending redraw (such as the very first frame) does not wait.
+        int timeout = analysisOverlay.isVisible() ? ANALYSIS_REFRESH_MS : EVENT_TIMEOUT_MS;
+        bool hasEvent = needsRedraw ? SDL_PollEvent(&windowEvent) : SDL_WaitEventTimeout(&windowEvent, timeout);
+
+        while (hasEvent) {
 
-    while(true){
-        
-        // event handling
-        if(SDL_PollEvent(&windowEvent)){
-            
             // quit condition
             if(SDL_QUIT == windowEvent.type){
-                break;
+                running = false;
+            }
+
+            // The board does not take moves while the engine is thinking or once the game is over
+            else if ((windowEvent.type == SDL_MOUSEBUTTONDOWN || windowEvent.type == SDL_MOUSEBUTTONUP) && (isGameOver || isEngineTurn())) {
+                selectedPiece = PieceType::EMPTY;
+                validMoves = 0;
             }
 
             else if (windowEvent.type == SDL_MOUSEBUTTONDOWN) {
                 int mouseX, mouseY;
                 SDL_GetMouseState(&mouseX, &mouseY);
                 handleMouseDown(mouseX, mouseY, selectedPiece, selectedPieceX, selectedPieceY, chessBoard, isWhiteTurn);
+                // Already worked out in the background when the turn changed
                 if (selectedPiece != PieceType::EMPTY) {
-                    validMoves = moveGenerator.generatePieceValidMoves(selectedPiece, selectedPieceY * 8 + selectedPieceX);
+                    validMoves = movePrecomputer.getValidMoves(selectedPieceY * 8 + selectedPieceX);
                 }
+                needsRedraw = true;
 
             }
 
@@ -199,41 +400,115 @@ void gameLoop (SDL_Renderer* renderer, Board& chessBoard, MoveGenerator& moveGen
                        
                 int releaseX, releaseY;
                 SDL_GetMouseState(&releaseX, &releaseY);
-                handleMouseUp(releaseX, releaseY, selectedPiece, selectedPieceX, selectedPieceY, chessBoard, moveGenerator, isWhiteTurn, audioManager, validMoves);
+                bool wasWhiteTurn = isWhiteTurn;
+                handleMouseUp(releaseX, releaseY, selectedPiece, selectedPieceX, selectedPieceY, chessBoard, moveGenerator, isWhiteTurn, moveEvents, validMoves, isInCheck);
+
+                if (isWhiteTurn != wasWhiteTurn) onTurnChanged();
                 selectedPiece = PieceType::EMPTY;
                 validMoves = 0;
+                needsRedraw = true;
 
             }
 
-        }
+            // F3 shows or hides the frame timing overlay
+            else if (windowEvent.type == SDL_KEYDOWN && windowEvent.key.keysym.sym == SDLK_F3) {
+                debugOverlay.toggle();
+                needsRedraw = true;
+            }
+
+            // A shows or hides the engine's analysis of the position on the board
+            else if (windowEvent.type == SDL_KEYDOWN && windowEvent.key.keysym.sym == SDLK_a) {
+                analysisOverlay.setVisible(!analysisOverlay.isVisible());
+                analysisOverlay.clear();
+                if (analysisOverlay.isVisible()) analysisGeneration = analyser.analyse(chessBoard);
+                else analyser.stop();
+                needsRedraw = true;
+            }
+
+            // The engine's move is ready
+            else if (windowEvent.type == engine.moveEvent && engine.player) {
+                SearchResult result;
+                if (!isGameOver && engine.player->takeMove(result) && result.hasMove) {
+                    playEngineMove(result, chessBoard, moveGenerator, isWhiteTurn, moveEvents, isInCheck);
+                    onTurnChanged();
+                    needsRedraw = true;
+                }
+            }
+
+            // R resigns the game for the player (the side to move when two people play), Escape abandons it
+            else if (windowEvent.type == SDL_KEYDOWN && !isGameOver && (windowEvent.key.keysym.sym == SDLK_r || windowEvent.key.keysym.sym == SDLK_ESCAPE)) {
+                if (engine.player) engine.player->abort();
+                isGameOver = true;
+                if (windowEvent.key.keysym.sym == SDLK_ESCAPE) {
+                    std::cout << "Game aborted" << std::endl;
+                } else {
+                    bool resigningWhite = engine.player ? !engine.playsWhite : isWhiteTurn;
+                    std::cout << (resigningWhite ? "White" : "Black") << " resigns, " << (resigningWhite ? "Black" : "White") << " wins" << std::endl;
+                }
+            }
+
+            // The window contents may have been lost (uncovered, resized, restored)
+            else if (windowEvent.type == SDL_WINDOWEVENT) {
+                needsRedraw = true;
+            }
+
+            // Render target textures lose their contents along with the renderer
+            else if (windowEvent.type == SDL_RENDER_TARGETS_RESET || windowEvent.type == SDL_RENDER_DEVICE_RESET) {
+                ui.invalidate();
+                needsRedraw = true;
+            }
+
+            // An image or sound finished decoding in the background
+            else if (isLoading && windowEvent.type == assetLoader.getEventType()) {
+                if (receiveAssets(assetLoader, ui, audioManager)) needsRedraw = true;
+                if (assetLoader.isDone()) {
+                    isLoading = false;
+                    std::cout << "All assets loaded after " << secondsSince(launchTime) * 1000 << " ms" << std::endl;
+                }
+            }
+
+            hasEvent = SDL_PollEvent(&windowEvent);
 
-        // Render the board after each event
-        SDL_RenderClear(renderer);
-        ui.drawChessboard();
-        ui.drawPieces();
-        if (selectedPiece != PieceType::EMPTY) {
-            ui.drawValidMoves(validMoves);
         }
 
-        // Check if the king is in check and draw a rectangle if it is
-        if (moveGenerator.isKingInCheck(isWhiteTurn)) {
+        // Events wait in the queue until the sounds have finished loading, so the start sound is not lost
+        MoveEvent moveEvent;
+        AudioType sound;
+        while (!isLoading && moveEvents.pop(moveEvent)) {
+            if (moveEventSound(moveEvent.type, sound)) audioManager.playSound(sound);
+        }
 
-            U64 kingBoard = isWhiteTurn ? chessBoard.getCurrentBoard()[PieceType::WK] : chessBoard.getCurrentBoard()[PieceType::BK];
-            int kingPosition = findLSBIndex(kingBoard);
-            int kingRow = kingPosition / 8;
-            int kingCol = kingPosition % 8;
+        // Newest analysis, if the search thread published any since the last look. Never waits on it.
+        AnalysisInfo analysis;
+        if (analysisOverlay.isVisible() && analyser.poll(analysis) && analysis.generation == analysisGeneration) {
+            analysisOverlay.update(analysis);
+            needsRedraw = true;
+        }
 
-            // Convert board position to pixel coordinates
-            int x = kingCol * SQUARE_SIZE;
-            int y = (7 - kingRow) * SQUARE_SIZE;
+        if (!running || !needsRedraw) continue;
+        needsRedraw = false;
 
-            // Set the color for the rectangle
-            SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
+        Uint64 frameStart = SDL_GetPerformanceCounter();
 
-            SDL_Rect rect = {x, y, SQUARE_SIZE, SQUARE_SIZE};
-            SDL_RenderDrawRect(renderer, &rect);
+        // The king's square is outlined while it is in check
+        int checkSquare = -1;
+        if (isInCheck) {
+            U64 kingBoard = isWhiteTurn ? chessBoard.getBitboard(PieceType::WK) : chessBoard.getBitboard(PieceType::BK);
+            checkSquare = findLSBIndex(kingBoard);
         }
 
+        // Only the squares that changed since the last frame are redrawn
+        SDL_RenderClear(renderer);
+        int squaresRedrawn = ui.render(selectedPiece != PieceType::EMPTY ? validMoves : 0, checkSquare);
+        analysisOverlay.draw();
+        debugOverlay.draw();
+
         SDL_RenderPresent(renderer);
+        debugOverlay.recordFrame(secondsSince(frameStart), squaresRedrawn);
+
+        if (isFirstFrame) {
+            isFirstFrame = false;
+            std::cout << "First frame after " << secondsSince(launchTime) * 1000 << " ms" << std::endl;
+        }
     }
 }
\ No newline at end of file
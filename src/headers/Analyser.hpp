@@ -0,0 +1,160 @@
+#ifndef ANALYSER_HPP
+#define ANALYSER_HPP
+
+#include <Board.hpp>
+#include <Search.hpp>
+#include <SnapshotBuffer.hpp>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+const int ANALYSIS_MAX_PV = 16;
+const int ANALYSIS_MAX_DEPTH = 32;
+
+// One update of the analysis. Fixed size, so that handing it over never allocates.
+struct AnalysisInfo {
+    uint64_t generation = 0;        // which analyse() call it belongs to
+    bool hasMove = false;
+    bool whiteToMove = true;
+    bool isFinished = false;        // the search ended on its own (mate found or depth limit)
+    int score = 0;                  // for the side to move, see isMateScore
+    int depth = 0;
+    uint64_t nodes = 0;
+    double seconds = 0;
+    int pvLength = 0;
+    Move pv[ANALYSIS_MAX_PV];
+
+    // Score from white's point of view, for drawing
+    int whiteScore() const { return whiteToMove ? score : -score; }
+};
+
+// Analyses positions on a background thread while the game goes on. Every completed depth is published
+// through a lock-free snapshot, and so is the best move so far every SEARCH_PROGRESS_MS while a depth is
+// still under way, so the game loop only ever polls and never waits on the search.
+class Analyser {
+
+    private:
+        Search search;
+        std::thread worker;
+
+        std::mutex mutex;
+        std::condition_variable changed;
+        Position requested;
+        uint64_t requestedGeneration;
+        bool isActive;
+        bool stopping;
+
+        // Raised to abandon the search in progress, cleared when the worker takes the next position
+        std::atomic<bool> cancel;
+
+        SnapshotBuffer<AnalysisInfo> snapshots;
+
+        void work();
+
+    public:
+        Analyser(Board& prototype, const Tablebases* tablebases = nullptr, const Bitbases* bitbases = nullptr);
+        ~Analyser();
+
+        // Starts analysing the board's current position, abandoning the previous one. Returns the
+        // generation its updates will carry.
+        uint64_t analyse(Board& current);
+
+        // Stops analysing until the next analyse()
+        void stop();
+
+        // Latest update since the last poll, if there is one. Never blocks.
+        bool poll(AnalysisInfo& info);
+
+        // Copy constructor and copy assignment operators should not be allowed
+        Analyser(const Analyser&) = delete;
+        Analyser& operator=(const Analyser&) = delete;
+
+};
+
+Analyser::Analyser(Board& prototype, const Tablebases* tablebases, const Bitbases* bitbases) : search(prototype, tablebases, bitbases), requestedGeneration(0), isActive(false), stopping(false), cancel(false) {
+    worker = std::thread(&Analyser::work, this);
+}
+
+Analyser::~Analyser() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        cancel = true;
+    }
+    changed.notify_all();
+    worker.join();
+}
+
+uint64_t Analyser::analyse(Board& current) {
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        current.savePosition(requested);
+        generation = ++requestedGeneration;
+        isActive = true;
+        cancel = true;
+    }
+    changed.notify_all();
+    return generation;
+}
+
+void Analyser::stop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    isActive = false;
+    cancel = true;
+}
+
+bool Analyser::poll(AnalysisInfo& info) {
+    return snapshots.read(info);
+}
+
+void Analyser::work() {
+
+    uint64_t generation = 0;
+
+    while (true) {
+
+        Position position;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&]() { return stopping || (isActive && requestedGeneration != generation); });
+            if (stopping) return;
+            generation = requestedGeneration;
+            position = requested;
+            cancel = false;
+        }
+
+        SearchLimits limits;
+        limits.maxDepth = ANALYSIS_MAX_DEPTH;
+        limits.cancel = &cancel;
+
+        AnalysisInfo info;
+        info.generation = generation;
+        info.whiteToMove = position.whiteToMove;
+
+        auto publish = [&](const SearchResult& result) {
+            info.hasMove = result.hasMove;
+            info.score = result.score;
+            info.depth = result.depth;
+            info.nodes = result.nodes;
+            info.seconds = result.seconds;
+            info.pvLength = std::min(static_cast<int>(result.pv.size()), ANALYSIS_MAX_PV);
+            for (int i = 0; i < info.pvLength; i++) info.pv[i] = result.pv[i];
+            snapshots.publish(info);
+        };
+
+        SearchResult result = search.run(position, limits, publish, publish);
+
+        // Mate or stalemate on the board, or the search ran to its depth limit
+        if (!cancel) {
+            info.isFinished = true;
+            publish(result);
+        }
+    }
+
+}
+
+#endif // ANALYSER_HPP
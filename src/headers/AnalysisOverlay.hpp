@@ -0,0 +1,182 @@
+#ifndef ANALYSISOVERLAY_HPP
+#define ANALYSISOVERLAY_HPP
+
+#include <SDL.h>
+#include <Analyser.hpp>
+#include <PixelFont.hpp>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Draws the latest analysis over the board: an evaluation bar down the left edge, an arrow for the best
+// move and the depth, score and principal variation along the bottom
+class AnalysisOverlay {
+
+    private:
+        static const int PIXEL = 2;
+        static const int BAR_WIDTH = 10;
+
+        SDL_Renderer* renderer;
+        int squareSize;
+        bool visible;
+        bool hasInfo;
+        AnalysisInfo info;
+
+        std::vector<SDL_Rect> pixels;
+        std::vector<SDL_Vertex> vertices;
+
+        void drawBar();
+        void drawArrow();
+        void drawText();
+        SDL_FPoint squareCentre(int square);
+
+    public:
+        AnalysisOverlay(SDL_Renderer* r, int squareSize);
+
+        void setVisible(bool isVisible);
+        bool isVisible();
+
+        // Shows this analysis from the next draw on
+        void update(const AnalysisInfo& analysis);
+
+        // Forgets the analysis shown, e.g. when the position changes
+        void clear();
+
+        void draw();
+
+        // Copy constructor and copy assignment operators should not be allowed
+        AnalysisOverlay(const AnalysisOverlay&) = delete;
+        AnalysisOverlay& operator=(const AnalysisOverlay&) = delete;
+
+};
+
+AnalysisOverlay::AnalysisOverlay(SDL_Renderer* r, int size) : renderer(r), squareSize(size), visible(false), hasInfo(false) {}
+
+void AnalysisOverlay::setVisible(bool isVisible) {
+    visible = isVisible;
+}
+
+bool AnalysisOverlay::isVisible() {
+    return visible;
+}
+
+void AnalysisOverlay::update(const AnalysisInfo& analysis) {
+    info = analysis;
+    hasInfo = true;
+}
+
+void AnalysisOverlay::clear() {
+    hasInfo = false;
+}
+
+void AnalysisOverlay::draw() {
+
+    if (!visible || !hasInfo) return;
+
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    drawBar();
+    if (info.hasMove && info.pvLength > 0) drawArrow();
+    drawText();
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+}
+
+SDL_FPoint AnalysisOverlay::squareCentre(int square) {
+    float x = (square % 8 + 0.5f) * squareSize;
+    float y = (7 - square / 8 + 0.5f) * squareSize;
+    return {x, y};
+}
+
+void AnalysisOverlay::drawBar() {
+
+    // White's expected score from the evaluation, a mate fills the bar
+    int score = info.whiteScore();
+    double whiteShare = isMateScore(score) ? (score > 0 ? 1.0 : 0.0) : 1.0 / (1.0 + std::pow(10.0, -score / 400.0));
+
+    int height = squareSize * 8;
+    int whiteHeight = static_cast<int>(whiteShare * height + 0.5);
+
+    SDL_Rect black = {0, 0, BAR_WIDTH, height - whiteHeight};
+    SDL_Rect white = {0, height - whiteHeight, BAR_WIDTH, whiteHeight};
+
+    SDL_SetRenderDrawColor(renderer, 40, 40, 40, 220);
+    SDL_RenderFillRect(renderer, &black);
+    SDL_SetRenderDrawColor(renderer, 240, 240, 240, 220);
+    SDL_RenderFillRect(renderer, &white);
+
+}
+
+void AnalysisOverlay::drawArrow() {
+
+    SDL_FPoint from = squareCentre(info.pv[0].fromPos);
+    SDL_FPoint to = squareCentre(info.pv[0].toPos);
+
+    float dx = to.x - from.x, dy = to.y - from.y;
+    float length = std::sqrt(dx * dx + dy * dy);
+    if (length < 1) return;
+    dx /= length;
+    dy /= length;
+
+    // Shaft up to the base of the head, then the head itself
+    float shaft = squareSize / 8.0f, headWidth = squareSize / 2.5f, headLength = squareSize / 2.5f;
+    SDL_FPoint base = {to.x - dx * headLength, to.y - dy * headLength};
+    float nx = -dy, ny = dx;
+
+    SDL_Color colour = {255, 170, 0, 180};
+    auto vertex = [&](float x, float y) { return SDL_Vertex{{x, y}, colour, {0, 0}}; };
+
+    vertices.clear();
+    vertices.push_back(vertex(from.x + nx * shaft / 2, from.y + ny * shaft / 2));
+    vertices.push_back(vertex(from.x - nx * shaft / 2, from.y - ny * shaft / 2));
+    vertices.push_back(vertex(base.x - nx * shaft / 2, base.y - ny * shaft / 2));
+    vertices.push_back(vertex(base.x + nx * shaft / 2, base.y + ny * shaft / 2));
+    vertices.push_back(vertex(base.x + nx * headWidth / 2, base.y + ny * headWidth / 2));
+    vertices.push_back(vertex(base.x - nx * headWidth / 2, base.y - ny * headWidth / 2));
+    vertices.push_back(vertex(to.x, to.y));
+
+    const int indices[] = {0, 1, 2, 0, 2, 3, 4, 5, 6};
+    SDL_RenderGeometry(renderer, nullptr, vertices.data(), static_cast<int>(vertices.size()), indices, 9);
+
+}
+
+void AnalysisOverlay::drawText() {
+
+    // Depth and score, "+0.35" in pawns or "#3" moves to mate, from white's point of view
+    char heading[32];
+    int score = info.whiteScore();
+    if (isMateScore(score)) {
+        int moves = mateInMoves(info.score);
+        std::snprintf(heading, sizeof(heading), "D%d #%d", info.depth, info.whiteToMove ? moves : -moves);
+    } else {
+        std::snprintf(heading, sizeof(heading), "D%d %+.2f", info.depth, score / 100.0);
+    }
+
+    // Principal variation as from and to squares, as much as fits across the board
+    int maxCharacters = (squareSize * 8 - BAR_WIDTH - 8) / (PIXEL_FONT_ADVANCE * PIXEL);
+    std::string line;
+    for (int i = 0; i < info.pvLength; i++) {
+        const Move& move = info.pv[i];
+        std::string text = {static_cast<char>('a' + move.fromPos % 8), static_cast<char>('1' + move.fromPos / 8),
+                            static_cast<char>('a' + move.toPos % 8), static_cast<char>('1' + move.toPos / 8)};
+        if (move.promotion != PieceType::EMPTY) text += pieceTypeToChar(move.promotion);
+        if (static_cast<int>(line.size() + text.size() + 1) > maxCharacters) break;
+        if (!line.empty()) line += ' ';
+        line += text;
+    }
+
+    int lineHeight = (PIXEL_FONT_HEIGHT + 2) * PIXEL;
+    int top = squareSize * 8 - 2 * lineHeight - 6;
+    SDL_Rect background = {BAR_WIDTH, top - 4, squareSize * 8 - BAR_WIDTH, 2 * lineHeight + 10};
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 160);
+    SDL_RenderFillRect(renderer, &background);
+
+    pixels.clear();
+    addPixelText(pixels, heading, BAR_WIDTH + 4, top, PIXEL);
+    addPixelText(pixels, line.c_str(), BAR_WIDTH + 4, top + lineHeight, PIXEL);
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    SDL_RenderFillRects(renderer, pixels.data(), static_cast<int>(pixels.size()));
+
+}
+
+#endif // ANALYSISOVERLAY_HPP
@@ -0,0 +1,462 @@
+#ifndef ANALYSISSERVICE_HPP
+#define ANALYSISSERVICE_HPP
+
+#include <Board.hpp>
+#include <LineServer.hpp>
+#include <Search.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Long-running analysis service on a Unix domain socket. Clients write one JSON object per line and get
+// one back per line, in the order the searches finish rather than the order they were asked:
+//
+//   {"id": 1, "fen": "<fen>", "nodes": 20000, "time": 50, "depth": 12}
+//     -> {"id": 1, "bestmove": "e2e4", "score": 23, "depth": 9, "nodes": 20000, "pv": "e2e4 e7e5", "search_ms": 11.2, "ms": 14.0}
+//        (score is centipawns for the side to move; a forced mate reports "mate": N moves instead)
+//   {"id": 2, "stats": true}
+//     -> {"id": 2, "queue": 3, "searching": 4, "completed": 1200, "errors": 0, "clients": 2,
+//         "latency_ms": {"p50": 4.1, "p90": 9.8, "p99": 15.2, "max": 21.0}}
+//
+// id is optional and echoed as given, and has to be a string or a number. Limits are optional whole numbers,
+// capped by the service's own; ms is the time from the request arriving to its answer being written, which
+// the latency percentiles are taken over. A request that breaks any of this gets {"error": "..."} back.
+//
+// The searches run on a fixed pool of workers, each with a Search made once at start-up, fed from one
+// queue that every connection adds to. The socket and the clients are handled by a LineServer.
+
+const int SERVICE_LATENCY_SAMPLES = 8192;     // latencies kept for the percentiles, the most recent ones
+const int SERVICE_BATCH = 8;                  // jobs a worker takes from the queue at a time
+const size_t SERVICE_MAX_LINE = 4096;
+
+struct ServiceLimits {
+    uint64_t nodes = 100000;
+    int64_t timeMs = 0;
+    int depth = MAX_PLY - 1;
+};
+
+// A field of a request: the text of a string (unescaped) or of any other value as written
+struct JsonField {
+    std::string text;
+    bool isString;
+};
+
+// Reads a flat JSON object ({"key": value, ...}) with string, number, true, false or null values.
+// Nested objects and arrays are not needed by the protocol and are rejected.
+bool parseJsonObject(const std::string& line, std::unordered_map<std::string, JsonField>& fields) {
+
+    fields.clear();
+    size_t i = 0, n = line.size();
+    auto skipSpace = [&]() { while (i < n && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r')) i++; };
+
+    auto readString = [&](std::string& out) {
+        if (i >= n || line[i] != '"') return false;
+        out.clear();
+        for (i++; i < n && line[i] != '"'; i++) {
+            if (line[i] != '\\') {
+                out += line[i];
+                continue;
+            }
+            if (++i >= n) return false;
+            char c = line[i];
+            out += c == 'n' ? '\n' : c == 't' ? '\t' : c == 'r' ? '\r' : c;
+        }
+        if (i >= n) return false;
+        i++;
+        return true;
+    };
+
+    skipSpace();
+    if (i >= n || line[i++] != '{') return false;
+    skipSpace();
+    if (i < n && line[i] == '}') return true;
+
+    while (true) {
+        std::string key;
+        skipSpace();
+        if (!readString(key)) return false;
+        skipSpace();
+        if (i >= n || line[i++] != ':') return false;
+        skipSpace();
+
+        JsonField field;
+        field.isString = i < n && line[i] == '"';
+        if (field.isString) {
+            if (!readString(field.text)) return false;
+        } else {
+            size_t start = i;
+            while (i < n && line[i] != ',' && line[i] != '}' && line[i] != ' ' && line[i] != '\t') i++;
+            field.text = line.substr(start, i - start);
+            if (field.text.empty() || field.text[0] == '{' || field.text[0] == '[') return false;
+        }
+        fields[key] = field;
+
+        skipSpace();
+        if (i < n && line[i] == ',') {
+            i++;
+            continue;
+        }
+        if (i < n && line[i] == '}') break;
+        return false;
+    }
+
+    return true;
+
+}
+
+// Whether text is a JSON number: an optional minus, digits without leading zeros, then an optional fraction
+// and exponent
+bool isJsonNumber(const std::string& text) {
+
+    size_t i = 0, n = text.size();
+    auto digits = [&]() {
+        size_t start = i;
+        while (i < n && text[i] >= '0' && text[i] <= '9') i++;
+        return i > start;
+    };
+
+    if (i < n && text[i] == '-') i++;
+    if (i < n && text[i] == '0') i++;
+    else if (!digits()) return false;
+
+    if (i < n && text[i] == '.') {
+        i++;
+        if (!digits()) return false;
+    }
+    if (i < n && (text[i] == 'e' || text[i] == 'E')) {
+        i++;
+        if (i < n && (text[i] == '+' || text[i] == '-')) i++;
+        if (!digits()) return false;
+    }
+    return i == n;
+
+}
+
+// Reads a field holding a whole number of zero or more, saturating rather than overflowing
+bool readJsonCount(const JsonField& field, uint64_t& value) {
+
+    if (field.isString || field.text.empty() || !isJsonNumber(field.text)) return false;
+    if (field.text.find_first_not_of("0123456789") != std::string::npos) return false;
+
+    errno = 0;
+    value = std::strtoull(field.text.c_str(), nullptr, 10);
+    if (errno == ERANGE) value = UINT64_MAX;
+    return true;
+
+}
+
+// A JSON string literal holding text
+std::string jsonString(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (c == '\n') out += "\\n";
+        else if (static_cast<unsigned char>(c) >= 0x20) out += c;
+    }
+    return out + "\"";
+}
+
+class AnalysisService {
+
+    private:
+        struct Job {
+            std::shared_ptr<LineConnection> connection;
+            std::string id;                 // as JSON, empty when the request had none
+            Position position;
+            SearchLimits limits;
+            std::chrono::steady_clock::time_point received;
+        };
+
+        Board prototype;
+        const Tablebases* tablebases;
+        const Bitbases* bitbases;
+        ServiceLimits maximum;
+        int threadCount;
+        LineServer server;
+
+        std::atomic<bool> stopping;
+
+        std::mutex queueMutex;
+        std::condition_variable queueChanged;
+        std::deque<Job> queue;
+
+        std::vector<std::thread> workers;
+
+        // Counters and the most recent latencies, under statsMutex
+        std::mutex statsMutex;
+        uint64_t completed;
+        uint64_t errors;
+        int searching;
+        std::vector<double> latencies;
+        size_t latencyCount;
+
+        void work();
+        void handle(const std::shared_ptr<LineConnection>& connection, const char* text, size_t length,
+                    std::chrono::steady_clock::time_point received);
+        void recordLatency(double milliseconds);
+        std::string statistics(const std::string& id);
+
+        static std::string moveText(const Move& move);
+
+    public:
+        AnalysisService(int threads, const ServiceLimits& limits, const Tablebases* tablebases = nullptr,
+                        const Bitbases* bitbases = nullptr);
+        ~AnalysisService();
+
+        // Creates the socket, replacing a stale one left at the path, and starts the workers
+        bool listen(const std::string& path);
+
+        // Accepts clients until stop() is called, then closes every connection and removes the socket
+        void serve();
+
+        // Safe from any thread and from a signal handler
+        void stop();
+
+        // Copy constructor and copy assignment operators should not be allowed
+        AnalysisService(const AnalysisService&) = delete;
+        AnalysisService& operator=(const AnalysisService&) = delete;
+
+};
+
+AnalysisService::AnalysisService(int threads, const ServiceLimits& limits, const Tablebases* endgameTablebases,
+                                 const Bitbases* endgameBitbases)
+    : tablebases(endgameTablebases), bitbases(endgameBitbases), maximum(limits),
+      server([this](const std::shared_ptr<LineConnection>& connection, const char* text, size_t length,
+                    std::chrono::steady_clock::time_point received) { handle(connection, text, length, received); },
+             SERVICE_MAX_LINE, "{\"error\": \"request too long\"}"),
+      stopping(false), completed(0), errors(0), searching(0), latencies(SERVICE_LATENCY_SAMPLES, 0.0), latencyCount(0) {
+    threadCount = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+AnalysisService::~AnalysisService() {
+    stop();
+    queueChanged.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+std::string AnalysisService::moveText(const Move& move) {
+    std::string text = {static_cast<char>('a' + move.fromPos % 8), static_cast<char>('1' + move.fromPos / 8),
+                        static_cast<char>('a' + move.toPos % 8), static_cast<char>('1' + move.toPos / 8)};
+    if (move.promotion != PieceType::EMPTY) text += static_cast<char>(tolower(pieceTypeToChar(move.promotion)));
+    return text;
+}
+
+bool AnalysisService::listen(const std::string& path) {
+
+    if (!server.listen(path)) return false;
+    for (int i = 0; i < threadCount; i++) workers.emplace_back(&AnalysisService::work, this);
+    return true;
+
+}
+
+void AnalysisService::stop() {
+    stopping = true;
+    server.stop();
+}
+
+void AnalysisService::serve() {
+
+    server.serve();
+
+    // Stop the workers before the connections go, so that none of them is left searching for a client
+    queueChanged.notify_all();
+    for (std::thread& worker : workers) worker.join();
+    workers.clear();
+
+    server.close();
+
+}
+
+void AnalysisService::handle(const std::shared_ptr<LineConnection>& connection, const char* text, size_t length,
+                             std::chrono::steady_clock::time_point received) {
+
+    std::string line(text, length);
+    if (line.find_first_not_of(" \t\r") == std::string::npos) return;
+
+    // One board per client reader thread, to check the FEN on
+    static thread_local Board board;
+
+    std::unordered_map<std::string, JsonField> fields;
+    bool valid = parseJsonObject(line, fields);
+
+    // Only an id that is sure to be valid JSON is echoed
+    std::string id;
+    auto found = fields.find("id");
+    bool validId = true;
+    if (valid && found != fields.end()) {
+        if (found->second.isString) id = jsonString(found->second.text);
+        else if (isJsonNumber(found->second.text)) id = found->second.text;
+        else validId = false;
+    }
+    std::string prefix = id.empty() ? "{" : "{\"id\": " + id + ", ";
+
+    auto fail = [&](const char* message) {
+        {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            errors++;
+        }
+        LineServer::send(*connection, prefix + "\"error\": " + jsonString(message) + "}");
+    };
+
+    if (!valid) return fail("invalid request");
+    if (!validId) return fail("invalid id");
+
+    if (fields.count("stats")) {
+        LineServer::send(*connection, statistics(id));
+        return;
+    }
+
+    found = fields.find("fen");
+    if (found == fields.end() || !found->second.isString || !board.loadFEN(found->second.text)) return fail("invalid fen");
+
+    // The request's limits, within the service's
+    Job job;
+    job.connection = connection;
+    job.id = id;
+    job.received = received;
+    board.savePosition(job.position);
+
+    uint64_t nodes = maximum.nodes;
+    int64_t timeMs = maximum.timeMs;
+    int depth = maximum.depth;
+    uint64_t requested;
+    if ((found = fields.find("nodes")) != fields.end()) {
+        if (!readJsonCount(found->second, requested)) return fail("invalid nodes");
+        nodes = std::min(nodes, requested);
+    }
+    if ((found = fields.find("time")) != fields.end()) {
+        if (!readJsonCount(found->second, requested)) return fail("invalid time");
+        requested = std::min<uint64_t>(requested, INT64_MAX);
+        timeMs = timeMs > 0 ? std::min<int64_t>(timeMs, requested) : static_cast<int64_t>(requested);
+    }
+    if ((found = fields.find("depth")) != fields.end()) {
+        if (!readJsonCount(found->second, requested)) return fail("invalid depth");
+        depth = static_cast<int>(std::min<uint64_t>(depth, requested));
+    }
+
+    job.limits.maxNodes = std::max<uint64_t>(1, nodes);
+    job.limits.timeMs = std::max<int64_t>(0, timeMs);
+    job.limits.maxDepth = std::max(1, depth);
+    job.limits.cancel = &stopping;
+
+    LineServer::addPending(*connection);
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        queue.push_back(std::move(job));
+    }
+    queueChanged.notify_one();
+
+}
+
+void AnalysisService::work() {
+
+    Search search(prototype, tablebases, bitbases);
+    std::vector<Job> batch;
+
+    while (true) {
+
+        // A few jobs at a time, so that a burst of small searches does not queue up on the lock
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueChanged.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (stopping) return;
+            size_t take = std::min<size_t>(queue.size(), SERVICE_BATCH);
+
+            // Leave work for the idle workers rather than take it all
+            take = std::max<size_t>(1, std::min(take, queue.size() / threadCount + 1));
+            batch.assign(std::make_move_iterator(queue.begin()), std::make_move_iterator(queue.begin() + take));
+            queue.erase(queue.begin(), queue.begin() + take);
+        }
+
+        for (Job& job : batch) {
+            if (!job.connection->open) {
+                LineServer::answered(*job.connection);
+                continue;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(statsMutex);
+                searching++;
+            }
+            SearchResult result = search.run(job.position, job.limits);
+            {
+                std::lock_guard<std::mutex> lock(statsMutex);
+                searching--;
+            }
+            if (stopping) return;
+
+            std::string line = job.id.empty() ? "{" : "{\"id\": " + job.id + ", ";
+            line += result.hasMove ? "\"bestmove\": \"" + moveText(result.bestMove) + "\", " : "\"bestmove\": null, ";
+            line += isMateScore(result.score) ? "\"mate\": " + std::to_string(mateInMoves(result.score)) : "\"score\": " + std::to_string(result.score);
+
+            std::string pv;
+            for (const Move& move : result.pv) pv += (pv.empty() ? "" : " ") + moveText(move);
+
+            double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - job.received).count();
+            char timing[96];
+            std::snprintf(timing, sizeof(timing), ", \"search_ms\": %.2f, \"ms\": %.2f}", result.seconds * 1000, milliseconds);
+            line += ", \"depth\": " + std::to_string(result.depth) + ", \"nodes\": " + std::to_string(result.nodes) + ", \"pv\": \"" + pv + "\"" + timing;
+
+            LineServer::send(*job.connection, line);
+            LineServer::answered(*job.connection);
+            recordLatency(milliseconds);
+        }
+    }
+
+}
+
+void AnalysisService::recordLatency(double milliseconds) {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    latencies[latencyCount++ % SERVICE_LATENCY_SAMPLES] = milliseconds;
+    completed++;
+}
+
+std::string AnalysisService::statistics(const std::string& id) {
+
+    size_t queued, clients;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        queued = queue.size();
+    }
+    clients = server.getClientCount();
+
+    std::vector<double> sorted;
+    uint64_t done, failed;
+    int active;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        sorted.assign(latencies.begin(), latencies.begin() + std::min<size_t>(latencyCount, SERVICE_LATENCY_SAMPLES));
+        done = completed;
+        failed = errors;
+        active = searching;
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    auto percentile = [&sorted](double fraction) {
+        return sorted.empty() ? 0.0 : sorted[std::min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()))];
+    };
+
+    char text[384];
+    std::snprintf(text, sizeof(text),
+                  "\"queue\": %zu, \"searching\": %d, \"completed\": %llu, \"errors\": %llu, \"clients\": %zu, "
+                  "\"latency_ms\": {\"p50\": %.2f, \"p90\": %.2f, \"p99\": %.2f, \"max\": %.2f}}",
+                  queued, active, static_cast<unsigned long long>(done), static_cast<unsigned long long>(failed), clients,
+                  percentile(0.5), percentile(0.9), percentile(0.99), sorted.empty() ? 0.0 : sorted.back());
+    return (id.empty() ? "{" : "{\"id\": " + id + ", ") + text;
+
+}
+
+#endif // ANALYSISSERVICE_HPP
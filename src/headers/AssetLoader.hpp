@@ -0,0 +1,182 @@
+#ifndef ASSETLOADER_HPP
+#define ASSETLOADER_HPP
+
+#include <SDL.h>
+#include <SDL_image.h>
+#include <SDL_mixer.h>
+#include <Assets.hpp>
+#include <AudioManager.hpp>
+#include <PieceType.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A decoded image or sound, handed over to the main thread by AssetLoader::collect
+struct LoadedAsset {
+    PieceType piece = PieceType::EMPTY;     // set for images
+    AudioType sound = AudioType::START;     // set for sounds
+    SDL_Surface* surface = nullptr;         // null for sounds or a failed image
+    Mix_Chunk* chunk = nullptr;             // null for images or a failed sound
+};
+
+// Decodes images into surfaces and sounds into chunks on a pool of worker threads. Nothing here touches
+// the renderer: textures must still be created on the main thread, from the surfaces returned by collect.
+// Every finished asset pushes an SDL event of getEventType(), so a loop waiting on events wakes up for it.
+class AssetLoader {
+
+    private:
+        struct Job {
+            std::string path;
+            LoadedAsset asset;
+        };
+
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable available;
+        std::deque<Job> jobs;
+        std::vector<LoadedAsset> finished;
+        int pending;
+        bool stopping;
+        Uint32 eventType;
+
+        void work();
+
+    public:
+        // 0 threads uses every core
+        AssetLoader(int threadCount = 0);
+        ~AssetLoader();
+
+        void loadImage(PieceType piece, const std::string& path);
+
+        // SDL_mixer must already be open, chunks are converted to its output format
+        void loadSound(AudioType sound, const std::string& path);
+
+        // Assets finished since the last call, ownership of the surfaces and chunks passes to the caller
+        std::vector<LoadedAsset> collect();
+
+        // True once every queued asset has been collected
+        bool isDone();
+
+        Uint32 getEventType();
+
+        // Copy constructor and copy assignment operators should not be allowed
+        AssetLoader(const AssetLoader&) = delete;
+        AssetLoader& operator=(const AssetLoader&) = delete;
+
+};
+
+AssetLoader::AssetLoader(int threadCount) : pending(0), stopping(false) {
+
+    // IMG_Init is not thread-safe, so the decoders are set up here rather than lazily by the first IMG_Load
+    if ((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0) {
+        std::cerr << "SDL_image could not initialise PNG support! SDL_image Error: " << IMG_GetError() << std::endl;
+    }
+
+    eventType = SDL_RegisterEvents(1);
+
+    if (threadCount <= 0) threadCount = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    for (int i = 0; i < threadCount; i++) workers.emplace_back(&AssetLoader::work, this);
+
+}
+
+AssetLoader::~AssetLoader() {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        jobs.clear();
+    }
+    available.notify_all();
+    for (std::thread& worker : workers) worker.join();
+
+    // Anything that was never collected
+    for (LoadedAsset& asset : finished) {
+        if (asset.surface) SDL_FreeSurface(asset.surface);
+        if (asset.chunk) Mix_FreeChunk(asset.chunk);
+    }
+
+}
+
+void AssetLoader::work() {
+
+    while (true) {
+
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            available.wait(lock, [&]() { return stopping || !jobs.empty(); });
+            if (stopping) return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        if (job.asset.piece != PieceType::EMPTY) {
+            job.asset.surface = IMG_Load_RW(openAsset(job.path), 1);
+            if (job.asset.surface == NULL) std::cerr << "Unable to load image at " << job.path << "! SDL_Image Error: " << IMG_GetError() << std::endl;
+        } else {
+            job.asset.chunk = Mix_LoadWAV_RW(openAsset(job.path), 1);
+            if (job.asset.chunk == NULL) std::cerr << "Failed to load sound effect at " << job.path << "! SDL_mixer Error: " << Mix_GetError() << std::endl;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.push_back(job.asset);
+        }
+
+        if (eventType != static_cast<Uint32>(-1)) {
+            SDL_Event event;
+            SDL_zero(event);
+            event.type = eventType;
+            SDL_PushEvent(&event);
+        }
+    }
+
+}
+
+void AssetLoader::loadImage(PieceType piece, const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Job job;
+        job.path = path;
+        job.asset.piece = piece;
+        jobs.push_back(job);
+        pending++;
+    }
+    available.notify_one();
+}
+
+void AssetLoader::loadSound(AudioType sound, const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Job job;
+        job.path = path;
+        job.asset.sound = sound;
+        jobs.push_back(job);
+        pending++;
+    }
+    available.notify_one();
+}
+
+std::vector<LoadedAsset> AssetLoader::collect() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<LoadedAsset> assets;
+    assets.swap(finished);
+    pending -= static_cast<int>(assets.size());
+    return assets;
+}
+
+bool AssetLoader::isDone() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending == 0;
+}
+
+Uint32 AssetLoader::getEventType() {
+    return eventType;
+}
+
+#endif // ASSETLOADER_HPP
@@ -0,0 +1,41 @@
+#ifndef ASSETS_HPP
+#define ASSETS_HPP
+
+#include <SDL.h>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// The game build compiles the assets into the binary (see tools/embed_assets.cpp and the Makefile), so it
+// runs from any directory without touching the filesystem. Builds without them, like the tools and tests,
+// read the files relative to the working directory.
+#ifdef CHESS_EMBED_ASSETS
+#include <EmbeddedAssets.hpp>
+#endif
+
+// Setting CHESS_ASSET_DIR to a directory holding src/assets reads the files from there instead, so assets
+// can be edited without rebuilding
+const char* const ASSET_DIR_VARIABLE = "CHESS_ASSET_DIR";
+
+// Opens an asset by its path relative to the repository root, e.g. src/assets/textures/bp.png. The
+// caller owns the returned stream (pass freesrc = 1 to the loader); null if the asset does not exist.
+SDL_RWops* openAsset(const std::string& path) {
+
+    const char* directory = std::getenv(ASSET_DIR_VARIABLE);
+    if (directory && *directory) return SDL_RWFromFile((std::string(directory) + "/" + path).c_str(), "rb");
+
+#ifdef CHESS_EMBED_ASSETS
+    for (size_t i = 0; i < EMBEDDED_ASSET_COUNT; i++) {
+        if (std::strcmp(EMBEDDED_ASSETS[i].path, path.c_str()) == 0) {
+            return SDL_RWFromConstMem(EMBEDDED_ASSETS[i].data, static_cast<int>(EMBEDDED_ASSETS[i].size));
+        }
+    }
+    SDL_SetError("No embedded asset named %s", path.c_str());
+    return nullptr;
+#else
+    return SDL_RWFromFile(path.c_str(), "rb");
+#endif
+
+}
+
+#endif // ASSETS_HPP
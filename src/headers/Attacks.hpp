@@ -0,0 +1,96 @@
+#ifndef ATTACKS_HPP
+#define ATTACKS_HPP
+
+#include <BitOperations.hpp>
+
+// Attacks worked out for whole bitboards at once, with no loop over pieces or squares. Shared by Board
+// (position checks), MoveGenerator, the evaluation, the tablebase generator, the game archive decoder and
+// the batch code in BatchAttacks.hpp.
+
+// Constants to assist with preventing generating moves that 'wrap' around the board
+const U64 RANK_8 = 0xFF00000000000000;
+const U64 RANK_7 = 0x00FF000000000000;
+const U64 RANK_2 = 0x000000000000FF00;
+const U64 RANK_1 = 0x00000000000000FF;
+
+const U64 FILE_A = 0x0101010101010101;
+const U64 FILE_B = 0x0202020202020202;
+const U64 FILE_G = 0x4040404040404040;
+const U64 FILE_H = 0x8080808080808080;
+
+// Kogge-Stone occluded fill along one ray, for every slider in the set at once: the squares attacked, up to
+// and including the first occupied one. Rays towards h8 shift left, the others right; mask keeps a shift
+// from wrapping around the board edge. T is a U64, or a vector of them (see BatchAttacks.hpp).
+template <typename T>
+T fillLeft(T sliders, T empty, int shift, U64 mask) {
+    empty &= mask;
+    sliders |= empty & (sliders << shift);
+    empty &= empty << shift;
+    sliders |= empty & (sliders << (shift * 2));
+    empty &= empty << (shift * 2);
+    sliders |= empty & (sliders << (shift * 4));
+    return (sliders << shift) & mask;
+}
+
+template <typename T>
+T fillRight(T sliders, T empty, int shift, U64 mask) {
+    empty &= mask;
+    sliders |= empty & (sliders >> shift);
+    empty &= empty >> shift;
+    sliders |= empty & (sliders >> (shift * 2));
+    empty &= empty >> (shift * 2);
+    sliders |= empty & (sliders >> (shift * 4));
+    return (sliders >> shift) & mask;
+}
+
+// Squares attacked along ranks and files, and along diagonals, by every slider in the set
+template <typename T>
+T orthogonalAttacks(T sliders, T empty) {
+    return fillLeft(sliders, empty, 8, ~0ULL) | fillRight(sliders, empty, 8, ~0ULL)
+         | fillLeft(sliders, empty, 1, ~FILE_A) | fillRight(sliders, empty, 1, ~FILE_H);
+}
+
+template <typename T>
+T diagonalAttacks(T sliders, T empty) {
+    return fillLeft(sliders, empty, 9, ~FILE_A) | fillLeft(sliders, empty, 7, ~FILE_H)
+         | fillRight(sliders, empty, 7, ~FILE_A) | fillRight(sliders, empty, 9, ~FILE_H);
+}
+
+// Squares attacked by every pawn, knight or king in the set
+template <typename T>
+T pawnAttacksOf(T pawns, bool isWhite) {
+    return isWhite ? ((pawns << 7) & ~FILE_H) | ((pawns << 9) & ~FILE_A)
+                   : ((pawns >> 9) & ~FILE_H) | ((pawns >> 7) & ~FILE_A);
+}
+
+template <typename T>
+T knightAttacksOf(T knights) {
+    return ((knights << 17) & ~FILE_A) | ((knights << 15) & ~FILE_H) | ((knights << 10) & ~(FILE_A | FILE_B))
+         | ((knights << 6) & ~(FILE_G | FILE_H)) | ((knights >> 6) & ~(FILE_A | FILE_B)) | ((knights >> 10) & ~(FILE_G | FILE_H))
+         | ((knights >> 15) & ~FILE_A) | ((knights >> 17) & ~FILE_H);
+}
+
+template <typename T>
+T kingAttacksOf(T king) {
+    T row = king | ((king << 1) & ~FILE_A) | ((king >> 1) & ~FILE_H);
+    return (row | (row << 8) | (row >> 8)) & ~king;
+}
+
+// Every square one side attacks, from the twelve bitboards of a position in PieceType order. Pawn attacks
+// come apart from the rest since they include empty squares, where a pawn cannot move diagonally.
+template <typename T>
+void sideAttacks(const T* pieces, bool isWhite, T& pawnAttacks, T& pieceAttacks) {
+
+    int first = isWhite ? 6 : 0;
+    T occupied = pieces[0];
+    for (int type = 1; type < 12; type++) occupied |= pieces[type];
+    T empty = ~occupied;
+
+    pawnAttacks = pawnAttacksOf(pieces[first], isWhite);
+    pieceAttacks = knightAttacksOf(pieces[first + 3]) | kingAttacksOf(pieces[first + 5])
+                 | orthogonalAttacks(pieces[first + 1] | pieces[first + 4], empty)
+                 | diagonalAttacks(pieces[first + 2] | pieces[first + 4], empty);
+
+}
+
+#endif // ATTACKS_HPP
@@ -3,14 +3,25 @@
 
 #include <SDL.h>
 #include <SDL_mixer.h>
+#include <Assets.hpp>
 #include <iostream>
 #include <unordered_map>
 #include <string>
+#include <utility>
 
 enum AudioType {
     START, CAPTURE, MOVE, CHECK, CHECKMATE
 };
 
+// Where each sound effect is loaded from, see openAsset
+const std::pair<AudioType, const char*> SOUND_FILES[] = {
+    {AudioType::START, "src/assets/audio/start.wav"},
+    {AudioType::MOVE, "src/assets/audio/move.wav"},
+    {AudioType::CHECK, "src/assets/audio/check.wav"},
+    {AudioType::CHECKMATE, "src/assets/audio/checkmate.wav"},
+    {AudioType::CAPTURE, "src/assets/audio/capture.wav"}
+};
+
 class AudioManager {
 
     private:
@@ -18,13 +29,18 @@ class AudioManager {
         bool loadSound(AudioType name, const std::string& path);
 
     public:
-        AudioManager();
+        // Without loadSounds the sounds are left to be decoded elsewhere (see AssetLoader) and handed over
+        // with addSound; until then playing them does nothing.
+        AudioManager(bool loadSounds = true);
         ~AudioManager();
 
+        // Takes ownership of the chunk
+        void addSound(AudioType name, Mix_Chunk* soundEffect);
+
         void playSound(AudioType name);
 };
 
-AudioManager::AudioManager() {
+AudioManager::AudioManager(bool loadSounds) {
 
     // Initialize SDL_mixer
     if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
@@ -32,11 +48,9 @@ AudioManager::AudioManager() {
     }
 
     // Load all sounds upon initialisation
-    loadSound(AudioType::START, "src/assets/audio/start.wav");
-    loadSound(AudioType::MOVE, "src/assets/audio/move.wav");
-    loadSound(AudioType::CHECK, "src/assets/audio/check.wav");
-    loadSound(AudioType::CHECKMATE, "src/assets/audio/checkmate.wav");
-    loadSound(AudioType::CAPTURE, "src/assets/audio/capture.wav");
+    if (loadSounds) {
+        for (const auto& file : SOUND_FILES) loadSound(file.first, file.second);
+    }
 
 }
 
@@ -50,17 +64,23 @@ AudioManager::~AudioManager() {
 
 bool AudioManager::loadSound(AudioType name, const std::string& path) {
 
-    Mix_Chunk* soundEffect = Mix_LoadWAV(path.c_str());
+    Mix_Chunk* soundEffect = Mix_LoadWAV_RW(openAsset(path), 1);
     if (soundEffect == nullptr) {
         std::cerr << "Failed to load sound effect: " << name << "! SDL_mixer Error: " << Mix_GetError() << std::endl;
         return false;
     }
 
-    soundEffects[name] = soundEffect;
+    addSound(name, soundEffect);
     return true;
 
 }
 
+void AudioManager::addSound(AudioType name, Mix_Chunk* soundEffect) {
+    auto it = soundEffects.find(name);
+    if (it != soundEffects.end()) Mix_FreeChunk(it->second);
+    soundEffects[name] = soundEffect;
+}
+
 void AudioManager::playSound(AudioType name) {
     auto it = soundEffects.find(name);
     if (it != soundEffects.end()) {
@@ -0,0 +1,60 @@
+#ifndef BATCHATTACKS_HPP
+#define BATCHATTACKS_HPP
+
+#include <Board.hpp>
+#include <MoveGenerator.hpp>
+#include <cstdint>
+#include <cstring>
+
+// Attack maps of several unrelated positions at once, for bulk work such as validation or data generation.
+// Each position is one 64-bit lane of a vector, and every piece type is worked set-wise: pawns, knights
+// and kings with a shift per direction, sliders with a Kogge-Stone occluded fill per ray direction, so
+// there is no loop over pieces or squares and every lane does the same work. The work is sideAttacks from
+// Attacks.hpp, which MoveGenerator runs on a single position.
+//
+// The vectors are the compiler's generic vector type, so the same code becomes AVX-512 (8 lanes), AVX2
+// (4 lanes) or SSE2 / NEON (2 lanes) depending on what the build targets (-march=native or -mavx2).
+// A batch is always ATTACK_BATCH positions, handled as many vectors as that takes.
+
+#if defined(__AVX512F__)
+const int ATTACK_VECTOR_LANES = 8;
+#elif defined(__AVX2__)
+const int ATTACK_VECTOR_LANES = 4;
+#else
+const int ATTACK_VECTOR_LANES = 2;
+#endif
+const int ATTACK_BATCH = 8;
+
+typedef U64 AttackLanes __attribute__((vector_size(ATTACK_VECTOR_LANES * sizeof(U64))));
+
+struct AttackBatch {
+    alignas(64) U64 pieces[12][ATTACK_BATCH];       // by PieceType, one lane per position
+
+    // By side, black then white. Every square the side attacks is pawnAttacks | pieceAttacks.
+    alignas(64) U64 pawnAttacks[2][ATTACK_BATCH];
+    alignas(64) U64 pieceAttacks[2][ATTACK_BATCH];  // knights, bishops, rooks, queens and the king
+};
+
+// Puts a position in lane `lane` of the batch
+void setBatchPosition(AttackBatch& batch, int lane, const Position& position) {
+    for (int type = 0; type < 12; type++) batch.pieces[type][lane] = position.bitboards[type];
+}
+
+// Fills in the attacks of both sides for every position of the batch
+void computeBatchAttacks(AttackBatch& batch) {
+
+    for (int lane = 0; lane < ATTACK_BATCH; lane += ATTACK_VECTOR_LANES) {
+        AttackLanes pieces[12];
+        for (int type = 0; type < 12; type++) memcpy(&pieces[type], &batch.pieces[type][lane], sizeof(AttackLanes));
+
+        for (int side = 0; side < 2; side++) {
+            AttackLanes pawnAttacks, pieceAttacks;
+            sideAttacks(pieces, side == 1, pawnAttacks, pieceAttacks);
+            memcpy(&batch.pawnAttacks[side][lane], &pawnAttacks, sizeof(AttackLanes));
+            memcpy(&batch.pieceAttacks[side][lane], &pieceAttacks, sizeof(AttackLanes));
+        }
+    }
+
+}
+
+#endif // BATCHATTACKS_HPP
@@ -3,6 +3,10 @@
 
 #include <cstdint>
 
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
 typedef uint64_t U64;
 
 // Function to first the index of the least significant bit
@@ -11,6 +15,13 @@ int findLSBIndex (U64 value) {
     // No set bits exist
     if (value == 0) return -1; 
 
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(value);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long pos;
+    _BitScanForward64(&pos, value);
+    return static_cast<int>(pos);
+#else
     int pos = 0;
     while (!(value & 1)) {
         value >>= 1; 
@@ -18,6 +29,23 @@ int findLSBIndex (U64 value) {
     }
     
     return pos;
+#endif
+}
+
+
+// Number of set bits
+int countSetBits (U64 value) {
+
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(value);
+#else
+    int count = 0;
+    while (value) {
+        value &= value - 1;
+        count++;
+    }
+    return count;
+#endif
 }
 
 
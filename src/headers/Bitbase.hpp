@@ -0,0 +1,230 @@
+#ifndef BITBASE_HPP
+#define BITBASE_HPP
+
+#include <Board.hpp>
+#include <MappedFile.hpp>
+#include <Tablebase.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// Bitbases keep one bit per position of a tablebase: whether the stronger side wins. They are only written
+// for materials in which the weaker side never wins (KPK, KQK, KRK, ...), so a clear bit is a draw. KPK
+// comes to 32 KB, small enough to leave in the page cache for good.
+//
+// Bitbase files, one per material and named after it (e.g. KPK.bbbb), are mapped and probed in place:
+//   bytes 0-7    "BBBBASE1"
+//   bytes 8-15   material name, null padded (white has the stronger set)
+//   bytes 16-23  positions per side to move (little endian), indexed as tablebaseIndex does
+//   bytes 24-31  reserved
+//   then a bit per position with white to move and then with black to move, set when white wins, each
+//   padded to a multiple of 8 bytes
+const char BITBASE_MAGIC[8] = {'B', 'B', 'B', 'B', 'A', 'S', 'E', '1'};
+const int BITBASE_HEADER_SIZE = 32;
+const char* const BITBASE_EXTENSION = ".bbbb";
+
+// Only one probe in this many is timed, reading the clock costs about as much as the probe itself
+const int BITBASE_TIMING_INTERVAL = 64;
+
+uint64_t bitbaseBytes(uint64_t positions) {
+    return ((positions + 7) / 8 + 7) & ~7ULL;
+}
+
+struct BitbaseCounters {
+    uint64_t probes;                // positions with few enough pieces looked up
+    uint64_t hits;                  // of those, the ones a bitbase had
+    double averageNanoseconds;      // per probe, over the timed ones
+};
+
+// Read-only, memory-mapped bitbase files. Mapping a file reads none of it; the OS pages in the parts the
+// probes touch. Probing is safe from any number of threads.
+class Bitbases {
+
+    private:
+        struct Table {
+            TablebaseMaterial material;
+            MappedFile file;
+            const uint8_t* bits[2];         // white to move, black to move
+        };
+
+        std::unordered_map<std::string, std::unique_ptr<Table>> tables;
+        int maxPieces;
+
+        mutable std::atomic<uint64_t> probes;
+        mutable std::atomic<uint64_t> hits;
+        mutable std::atomic<uint64_t> timedProbes;
+        mutable std::atomic<uint64_t> timedNanoseconds;
+
+        bool lookup(Board& board, const PieceType* types, const int* squares, int count, TablebaseResult& result) const;
+
+    public:
+        Bitbases();
+
+        // Maps every bitbase file in the directory, returns how many were found
+        int open(const std::string& directory);
+        bool addTable(const std::string& path);
+
+        size_t getTableCount() const;
+
+        // Most pieces (kings included) of any bitbase loaded, 0 when there are none
+        int getMaxPieces() const;
+
+        // WIN, DRAW or LOSS for the side to move, with the index worked out straight from the board's
+        // bitboards. False when no bitbase covers the position, which includes positions with castling
+        // rights or an en passant capture on the board.
+        bool probe(Board& board, TablebaseResult& result) const;
+
+        BitbaseCounters getCounters() const;
+        void resetCounters();
+
+        // Copy constructor and copy assignment operators should not be allowed
+        Bitbases(const Bitbases&) = delete;
+        Bitbases& operator=(const Bitbases&) = delete;
+
+};
+
+Bitbases::Bitbases() : maxPieces(0), probes(0), hits(0), timedProbes(0), timedNanoseconds(0) {}
+
+int Bitbases::open(const std::string& directory) {
+
+    std::error_code error;
+    std::filesystem::directory_iterator entries(directory, error);
+    if (error) {
+        std::cerr << "Unable to read bitbase directory " << directory << std::endl;
+        return 0;
+    }
+
+    int found = 0;
+    for (const auto& entry : entries) {
+        if (entry.path().extension() == BITBASE_EXTENSION && addTable(entry.path().string())) found++;
+    }
+    return found;
+
+}
+
+bool Bitbases::addTable(const std::string& path) {
+
+    std::unique_ptr<Table> table(new Table());
+    if (!table->file.open(path)) return false;
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(table->file.getData());
+    size_t size = table->file.getSize();
+
+    bool valid = size >= static_cast<size_t>(BITBASE_HEADER_SIZE) && memcmp(data, BITBASE_MAGIC, sizeof(BITBASE_MAGIC)) == 0;
+
+    uint64_t positions = 0;
+    if (valid) {
+        std::string name(reinterpret_cast<const char*>(data) + 8, strnlen(reinterpret_cast<const char*>(data) + 8, 8));
+        for (int i = 0; i < 8; i++) positions |= static_cast<uint64_t>(data[16 + i]) << (8 * i);
+
+        valid = parseTablebaseMaterial(name, table->material) && table->material.name == name
+                && table->material.positions == positions && size == BITBASE_HEADER_SIZE + 2 * bitbaseBytes(positions);
+    }
+
+    if (!valid) {
+        std::cerr << path << " is not a bitbase" << std::endl;
+        return false;
+    }
+
+    // Probes land all over the file, read-ahead would only bring in pages nobody asked for
+    table->file.adviseRandom();
+    table->bits[0] = data + BITBASE_HEADER_SIZE;
+    table->bits[1] = table->bits[0] + bitbaseBytes(positions);
+
+    maxPieces = std::max(maxPieces, table->material.count);
+    tables[table->material.name] = std::move(table);
+    return true;
+
+}
+
+size_t Bitbases::getTableCount() const {
+    return tables.size();
+}
+
+int Bitbases::getMaxPieces() const {
+    return maxPieces;
+}
+
+bool Bitbases::probe(Board& board, TablebaseResult& result) const {
+
+    if (maxPieces == 0 || board.getCastlingRights()) return false;
+
+    // Most positions in a search have far too many pieces, they are turned away before they count as probes
+    PieceType types[TABLEBASE_MAX_PIECES];
+    int squares[TABLEBASE_MAX_PIECES];
+    int count = 0;
+
+    for (int type = 0; type < 12; type++) {
+        U64 pieces = board.getBitboard(static_cast<PieceType>(type));
+        while (pieces) {
+            if (count == maxPieces) return false;
+            types[count] = static_cast<PieceType>(type);
+            squares[count++] = findLSBIndex(pieces);
+            pieces &= pieces - 1;
+        }
+    }
+
+    bool found;
+    if (probes.fetch_add(1, std::memory_order_relaxed) % BITBASE_TIMING_INTERVAL == 0) {
+        auto start = std::chrono::steady_clock::now();
+        found = lookup(board, types, squares, count, result);
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        timedProbes.fetch_add(1, std::memory_order_relaxed);
+        timedNanoseconds.fetch_add(static_cast<uint64_t>(elapsed.count()), std::memory_order_relaxed);
+    } else {
+        found = lookup(board, types, squares, count, result);
+    }
+
+    if (found) hits.fetch_add(1, std::memory_order_relaxed);
+    return found;
+
+}
+
+bool Bitbases::lookup(Board& board, const PieceType* types, const int* squares, int count, TablebaseResult& result) const {
+
+    bool whiteToMove = board.isWhiteToMove();
+
+    // Bitbases hold no en passant rights, so they only answer if the capture is not actually on
+    int enPassantSquare = board.getEnPassantSquare();
+    if (enPassantSquare >= 0) {
+        int pawnSquare = whiteToMove ? enPassantSquare - 8 : enPassantSquare + 8;
+        int file = enPassantSquare % 8;
+        U64 capturers = (file > 0 ? 1ULL << (pawnSquare - 1) : 0) | (file < 7 ? 1ULL << (pawnSquare + 1) : 0);
+        if (board.getBitboard(whiteToMove ? PieceType::WP : PieceType::BP) & capturers) return false;
+    }
+
+    bool flipped;
+    auto found = tables.find(tablebaseMaterialName(types, count, flipped));
+    if (found == tables.end()) return false;
+    const Table& table = *found->second;
+
+    int slotSquares[TABLEBASE_MAX_PIECES];
+    tablebaseSlotSquares(table.material, types, squares, count, flipped, slotSquares);
+    uint64_t index = tablebaseIndex(table.material, slotSquares);
+    bool strongerToMove = whiteToMove != flipped;
+
+    bool strongerWins = (table.bits[strongerToMove ? 0 : 1][index / 8] >> (index % 8)) & 1;
+    result = !strongerWins ? TablebaseResult::DRAW : strongerToMove ? TablebaseResult::WIN : TablebaseResult::LOSS;
+    return true;
+
+}
+
+BitbaseCounters Bitbases::getCounters() const {
+    uint64_t timed = timedProbes.load(std::memory_order_relaxed);
+    double average = timed ? static_cast<double>(timedNanoseconds.load(std::memory_order_relaxed)) / timed : 0;
+    return {probes.load(std::memory_order_relaxed), hits.load(std::memory_order_relaxed), average};
+}
+
+void Bitbases::resetCounters() {
+    probes = 0;
+    hits = 0;
+    timedProbes = 0;
+    timedNanoseconds = 0;
+}
+
+#endif // BITBASE_HPP
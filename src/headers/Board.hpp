@@ -2,37 +2,110 @@
 #define BOARD_H
 
 #include <cstdint>
+#include <cstddef>
 #include <PieceType.hpp>
 #include <unordered_map>
 #include <iostream>
-#include <AudioManager.hpp>
+#include <string>
+#include <BitOperations.hpp>
+#include <Attacks.hpp>
+#include <cstdlib>
 
 using namespace std;
 typedef uint64_t U64;
 
+// Castling right flags (stored together as a bitmask)
+const int CASTLE_WK = 1;
+const int CASTLE_WQ = 2;
+const int CASTLE_BK = 4;
+const int CASTLE_BQ = 8;
+
+// Upper bound on the length of a serialised FEN (including the terminating null)
+const int FEN_MAX_LENGTH = 96;
+
+const char* const START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+enum class GameResult {
+    WHITE_WIN, BLACK_WIN, DRAW, UNKNOWN
+};
+
+// Plain copy of everything needed to restore a Board, cheap to store in bulk
+struct Position {
+    U64 bitboards[12];
+    bool whiteToMove;
+    int8_t castlingRights;
+    int8_t enPassantSquare;
+    uint16_t halfmoveClock;
+    uint16_t fullmoveNumber;
+};
+
 class Board{
 
     private:
         unordered_map<PieceType, U64> currentBoard;
-        AudioManager& audioManager;
+
+        // The piece on each square (a PieceType, EMPTY for none), kept in step with the bitboards so that
+        // getPieceAtPosition is a single load. Every change to the bitboards goes through the members
+        // below; building with -DCHESS_CHECK_BOARD checks the two agree after each one.
+        uint8_t mailbox[64];
+
+        // Game state that is not captured by the bitboards themselves
+        bool whiteToMove;
+        int castlingRights;
+        int enPassantSquare;        // -1 when there is no en passant target
+        int halfmoveClock;
+        int fullmoveNumber;
+
+        // Moves on with every change to the position, so that what is worked out from a position can be
+        // cached against it (see MoveGenerator). A copy of the board starts from the same version.
+        uint64_t version;
 
         void initialiseBoard();
+        void rebuildMailbox();
+        void checkMailbox();
 
         // Move Helpers
         void movePiece(PieceType type, int fromPos, int toPos);
         void capturePiece(PieceType type, int position);
+        void updateGameState(PieceType movedPiece, int fromPos, int toPos, bool isCapture);
 
     public:
-        Board(AudioManager& audioManager);
+        Board();
 
-        unordered_map<PieceType, U64> getCurrentBoard();
+        // Read only: pieces are changed through the moves and loaders below, which keep the version and the
+        // mailbox in step
+        const unordered_map<PieceType, U64>& getCurrentBoard() const;
+        U64 getBitboard(PieceType type) const;
         PieceType getPieceAtPosition (int position);
         bool isOpponentPiece(PieceType pieceOne, PieceType pieceTwo);
 
-        void executeMove(PieceType selectedPiece, int fromPos, int toPos);
-        void simulateExecuteMove (PieceType selectedPiece, int fromPos, int toPos);
+        // Castling (king moving two files), en passant and promotion are handled here as well.
+        // A pawn reaching the last rank becomes a queen unless another promotion piece is given.
+        // Returns true if the move captured a piece, e.g. for the move sound (see MoveEvents.hpp).
+        bool executeMove(PieceType selectedPiece, int fromPos, int toPos, PieceType promotion = PieceType::EMPTY);
+        void simulateExecuteMove (PieceType selectedPiece, int fromPos, int toPos, PieceType promotion = PieceType::EMPTY);
+
+        void savePosition(Position& position);
+        void loadPosition(const Position& position);
+
+        // FEN
+        // loadFEN leaves the board untouched and returns false if the input is malformed.
+        // The halfmove and fullmove fields may be omitted (as in EPD), defaulting to 0 and 1. Castling rights
+        // whose king or rook is not on its home square are dropped.
+        bool loadFEN(const char* fen, size_t length);
+        bool loadFEN(const string& fen);
+        size_t writeFEN(char* buffer);      // buffer must hold FEN_MAX_LENGTH chars, returns length
+        string getFEN();
+
+        bool isWhiteToMove();
+        int getCastlingRights();
+        int getEnPassantSquare();
+        int getHalfmoveClock();
+        int getFullmoveNumber();
+        uint64_t getVersion();
                 
         // Testing functions
+        bool isMailboxConsistent();         // reports every square where the mailbox and bitboards differ
         void clearBoard();
         void printU64(U64 board);
         void addPiece(PieceType type, int position);
@@ -42,57 +115,154 @@ class Board{
 
 void Board::addPiece (PieceType type, int position) {
     currentBoard[type] |= (1ULL << position);
+    mailbox[position] = static_cast<uint8_t>(type);
+    version++;
+    checkMailbox();
 }
 
 void Board::removePiece (PieceType type, int position) {
-    currentBoard[type] && ~(1ULL << position);
+    currentBoard[type] &= ~(1ULL << position);
+    if (mailbox[position] == static_cast<uint8_t>(type)) mailbox[position] = static_cast<uint8_t>(PieceType::EMPTY);
+    version++;
+    checkMailbox();
 }
 
-Board::Board(AudioManager& a) : audioManager(a) {
+Board::Board() : version(0) {
     initialiseBoard();
-    a.playSound(AudioType::START);
 }
 
-void Board::executeMove (PieceType selectedPiece, int fromPos, int toPos) {
+bool Board::executeMove (PieceType selectedPiece, int fromPos, int toPos, PieceType promotion) {
 
-    // Check if move is a capture move
+    // Check if move is a capture move (including en passant) before the board changes
     PieceType capturedPiece = getPieceAtPosition(toPos);
-    if (capturedPiece != PieceType::EMPTY && isOpponentPiece(selectedPiece, capturedPiece)) {
-        capturePiece(capturedPiece, toPos);
-        movePiece(selectedPiece, fromPos, toPos);
-        audioManager.playSound(AudioType::CAPTURE);
-    } else {
-        movePiece(selectedPiece, fromPos, toPos);
-        audioManager.playSound(AudioType::MOVE);
-    }
+    bool isPawn = selectedPiece == PieceType::WP || selectedPiece == PieceType::BP;
+    bool isCapture = (capturedPiece != PieceType::EMPTY && isOpponentPiece(selectedPiece, capturedPiece))
+                     || (isPawn && toPos == enPassantSquare && (toPos - fromPos) % 8 != 0);
+
+    simulateExecuteMove(selectedPiece, fromPos, toPos, promotion);
+    return isCapture;
 
 }
 
-void Board::simulateExecuteMove (PieceType selectedPiece, int fromPos, int toPos) {
+void Board::simulateExecuteMove (PieceType selectedPiece, int fromPos, int toPos, PieceType promotion) {
+
+    bool isWhite = isWhitePiece(selectedPiece);
+    bool isPawn = selectedPiece == PieceType::WP || selectedPiece == PieceType::BP;
+    bool isKing = selectedPiece == PieceType::WK || selectedPiece == PieceType::BK;
+    bool isCapture = false;
 
     // Check if move is a capture move
     PieceType capturedPiece = getPieceAtPosition(toPos);
     if (capturedPiece != PieceType::EMPTY && isOpponentPiece(selectedPiece, capturedPiece)) {
         capturePiece(capturedPiece, toPos);
-        movePiece(selectedPiece, fromPos, toPos);
-    } else {
-        movePiece(selectedPiece, fromPos, toPos);
+        isCapture = true;
+    }
+
+    // En passant, a pawn moving diagonally onto the en passant target takes the pawn behind it
+    else if (isPawn && toPos == enPassantSquare && (toPos - fromPos) % 8 != 0) {
+        capturePiece(isWhite ? PieceType::BP : PieceType::WP, isWhite ? toPos - 8 : toPos + 8);
+        isCapture = true;
+    }
+
+    movePiece(selectedPiece, fromPos, toPos);
+
+    // Promotion
+    if (isPawn && (toPos >= 56 || toPos < 8)) {
+        if (promotion == PieceType::EMPTY) promotion = isWhite ? PieceType::WQ : PieceType::BQ;
+        capturePiece(selectedPiece, toPos);
+        addPiece(promotion, toPos);
+    }
+
+    // Castling, the rook jumps over to the square the king passed through
+    if (isKing && (toPos - fromPos == 2 || fromPos - toPos == 2)) {
+        PieceType rook = isWhite ? PieceType::WR : PieceType::BR;
+        int rookFrom = toPos > fromPos ? fromPos + 3 : fromPos - 4;
+        movePiece(rook, rookFrom, (fromPos + toPos) / 2);
     }
 
+    updateGameState(selectedPiece, fromPos, toPos, isCapture);
+    version++;
+    checkMailbox();
+
+}
+
+void Board::savePosition(Position& position) {
+
+    for (int i = 0; i < 12; i++) {
+        position.bitboards[i] = currentBoard[static_cast<PieceType>(i)];
+    }
+    position.whiteToMove = whiteToMove;
+    position.castlingRights = castlingRights;
+    position.enPassantSquare = enPassantSquare;
+    position.halfmoveClock = halfmoveClock;
+    position.fullmoveNumber = fullmoveNumber;
+
+}
+
+void Board::loadPosition(const Position& position) {
+
+    for (int i = 0; i < 12; i++) {
+        currentBoard[static_cast<PieceType>(i)] = position.bitboards[i];
+    }
+    whiteToMove = position.whiteToMove;
+    castlingRights = position.castlingRights;
+    enPassantSquare = position.enPassantSquare;
+    halfmoveClock = position.halfmoveClock;
+    fullmoveNumber = position.fullmoveNumber;
+    rebuildMailbox();
+    version++;
+    checkMailbox();
+
 }
 
 PieceType Board::getPieceAtPosition (int position) {
+    return static_cast<PieceType>(mailbox[position]);
+}
 
-    U64 location = 1ULL << position;
+void Board::rebuildMailbox() {
 
-    // Iterate through each board type
-    for (const auto& [type, bitboard] : currentBoard) {
-        if (bitboard & location) {
-            return type;
+    for (uint8_t& square : mailbox) square = static_cast<uint8_t>(PieceType::EMPTY);
+
+    for (int type = 0; type < 12; type++) {
+        for (U64 pieces = currentBoard[static_cast<PieceType>(type)]; pieces; pieces &= pieces - 1) {
+            mailbox[findLSBIndex(pieces)] = static_cast<uint8_t>(type);
+        }
+    }
+
+}
+
+bool Board::isMailboxConsistent() {
+
+    bool consistent = true;
+    for (int square = 0; square < 64; square++) {
+
+        // Exactly the mailbox's piece has the square set, and no other
+        PieceType expected = PieceType::EMPTY;
+        int owners = 0;
+        for (int type = 0; type < 12; type++) {
+            if (currentBoard[static_cast<PieceType>(type)] & (1ULL << square)) {
+                expected = static_cast<PieceType>(type);
+                owners++;
+            }
+        }
+
+        if (owners > 1 || static_cast<PieceType>(mailbox[square]) != expected) {
+            std::cerr << "Square " << square << ": mailbox has " << pieceTypeToString(static_cast<PieceType>(mailbox[square]))
+                      << ", bitboards have " << (owners > 1 ? std::to_string(owners) + " pieces" : pieceTypeToString(expected)) << std::endl;
+            consistent = false;
         }
     }
+    return consistent;
+
+}
 
-    return PieceType::EMPTY;
+void Board::checkMailbox() {
+#ifdef CHESS_CHECK_BOARD
+    if (!isMailboxConsistent()) {
+        std::cerr << "Board out of step with its mailbox at " << getFEN() << std::endl;
+        std::abort();
+    }
+#endif
 }
 
 void Board::clearBoard(){
@@ -100,16 +270,15 @@ void Board::clearBoard(){
     for(auto& [type, bitboard] : currentBoard){
         bitboard = 0;
     }
+    for (uint8_t& square : mailbox) square = static_cast<uint8_t>(PieceType::EMPTY);
+    version++;
+    checkMailbox();
 
 }
 
 bool Board::isOpponentPiece(PieceType pieceOne, PieceType pieceTwo){
 
-    // Obtain types of pieces through helper function
-    char colourOne = pieceTypeToString(pieceOne)[0];
-    char colourTwo = pieceTypeToString(pieceTwo)[0];
-
-    return colourOne != colourTwo;
+    return isWhitePiece(pieceOne) != isWhitePiece(pieceTwo);
     
 }
 
@@ -120,8 +289,16 @@ void Board::capturePiece(PieceType type, int position){
         U64& bitboard = currentBoard[type];
         U64 mask = 1ULL << position;
         
-        // Clear the bit at the position
+#ifdef CHESS_CHECK_BOARD
+        if (!(bitboard & mask) || mailbox[position] != static_cast<uint8_t>(type)) {
+            std::cerr << "Capture of " << pieceTypeToChar(type) << " on " << position << " that is not there in " << getFEN() << std::endl;
+            std::abort();
+        }
+#endif
+
+        // Clear the bit at the position, and the square if it held that piece (as removePiece does)
         bitboard &= ~mask;
+        if (mailbox[position] == static_cast<uint8_t>(type)) mailbox[position] = static_cast<uint8_t>(PieceType::EMPTY);
     }
 }
 
@@ -136,6 +313,300 @@ void Board::movePiece(PieceType type, int fromPos, int toPos){
 
     // Set the bit at the new location
     bitboard |= toMask;
+
+    mailbox[fromPos] = static_cast<uint8_t>(PieceType::EMPTY);
+    mailbox[toPos] = static_cast<uint8_t>(type);
+}
+
+// Keep side to move, castling rights, en passant target and move clocks in step with the bitboards
+void Board::updateGameState(PieceType movedPiece, int fromPos, int toPos, bool isCapture) {
+
+    bool isPawn = movedPiece == PieceType::WP || movedPiece == PieceType::BP;
+
+    // Moving the king, or moving / capturing on a rook's home square, loses the right to castle there
+    if (movedPiece == PieceType::WK) castlingRights &= ~(CASTLE_WK | CASTLE_WQ);
+    if (movedPiece == PieceType::BK) castlingRights &= ~(CASTLE_BK | CASTLE_BQ);
+    if (fromPos == 0  || toPos == 0)  castlingRights &= ~CASTLE_WQ;
+    if (fromPos == 7  || toPos == 7)  castlingRights &= ~CASTLE_WK;
+    if (fromPos == 56 || toPos == 56) castlingRights &= ~CASTLE_BQ;
+    if (fromPos == 63 || toPos == 63) castlingRights &= ~CASTLE_BK;
+
+    // A double pawn push leaves the skipped square as the en passant target
+    if (isPawn && (toPos - fromPos == 16 || fromPos - toPos == 16)) enPassantSquare = (fromPos + toPos) / 2;
+    else enPassantSquare = -1;
+
+    if (isPawn || isCapture) halfmoveClock = 0;
+    else halfmoveClock++;
+
+    if (!whiteToMove) fullmoveNumber++;
+    whiteToMove = !whiteToMove;
+
+}
+
+bool Board::loadFEN(const string& fen) {
+    return loadFEN(fen.data(), fen.size());
+}
+
+// Parse a FEN record directly into the bitboards.
+// Everything is validated before the board is modified, so a rejected FEN has no side effects.
+bool Board::loadFEN(const char* fen, size_t length) {
+
+    const char* p = fen;
+    const char* end = fen + length;
+
+    U64 boards[12] = {0};
+
+    // 1. Piece placement, rank 8 first and file a first within each rank
+    int rank = 7, file = 0;
+    bool lastWasDigit = false;
+
+    while (true) {
+        if (p == end) return false;
+        char c = *p++;
+
+        if (c >= '1' && c <= '8') {
+            // Two digits in a row ("44") are not a valid encoding
+            if (lastWasDigit) return false;
+            file += c - '0';
+            if (file > 8) return false;
+            lastWasDigit = true;
+            continue;
+        }
+
+        lastWasDigit = false;
+
+        if (c == '/') {
+            if (file != 8 || rank == 0) return false;
+            rank--;
+            file = 0;
+        }
+        else if (c == ' ') {
+            if (file != 8 || rank != 0) return false;
+            break;
+        }
+        else {
+            PieceType type = pieceTypeFromChar(c);
+            if (type == PieceType::EMPTY || file > 7) return false;
+            boards[static_cast<int>(type)] |= 1ULL << (rank * 8 + file);
+            file++;
+        }
+    }
+
+    // Exactly one king per side, and no pawns on the back ranks
+    U64 whiteKing = boards[static_cast<int>(PieceType::WK)];
+    U64 blackKing = boards[static_cast<int>(PieceType::BK)];
+    if (!whiteKing || (whiteKing & (whiteKing - 1))) return false;
+    if (!blackKing || (blackKing & (blackKing - 1))) return false;
+    if ((boards[static_cast<int>(PieceType::WP)] | boards[static_cast<int>(PieceType::BP)]) & 0xFF000000000000FFULL) return false;
+
+    // 2. Side to move
+    if (end - p < 2) return false;
+    bool white;
+    if (*p == 'w') white = true;
+    else if (*p == 'b') white = false;
+    else return false;
+    p++;
+    if (*p++ != ' ') return false;
+
+    // 3. Castling rights, at least one letter or '-'
+    int castling = 0;
+    if (p == end || *p == ' ') return false;
+    if (*p == '-') {
+        p++;
+    } else {
+        while (p != end && *p != ' ') {
+            int flag;
+            switch (*p) {
+                case 'K': flag = CASTLE_WK; break;
+                case 'Q': flag = CASTLE_WQ; break;
+                case 'k': flag = CASTLE_BK; break;
+                case 'q': flag = CASTLE_BQ; break;
+                default: return false;
+            }
+            if (castling & flag) return false;
+            castling |= flag;
+            p++;
+        }
+    }
+    if (p == end || *p++ != ' ') return false;
+
+    // A right whose king or rook has left its home square cannot be used, so it is dropped
+    U64 whiteRooks = boards[static_cast<int>(PieceType::WR)], blackRooks = boards[static_cast<int>(PieceType::BR)];
+    if (!(whiteKing & (1ULL << 4)) || !(whiteRooks & (1ULL << 7)))   castling &= ~CASTLE_WK;
+    if (!(whiteKing & (1ULL << 4)) || !(whiteRooks & (1ULL << 0)))   castling &= ~CASTLE_WQ;
+    if (!(blackKing & (1ULL << 60)) || !(blackRooks & (1ULL << 63))) castling &= ~CASTLE_BK;
+    if (!(blackKing & (1ULL << 60)) || !(blackRooks & (1ULL << 56))) castling &= ~CASTLE_BQ;
+
+    // 4. En passant target, which must sit behind a pawn that has just double pushed: the target and the
+    // square the pawn came from are empty, and the pawn of the side that just moved is in front of it
+    int enPassant = -1;
+    if (p == end) return false;
+    if (*p == '-') {
+        p++;
+    } else {
+        if (end - p < 2) return false;
+        char epFile = p[0], epRank = p[1];
+        if (epFile < 'a' || epFile > 'h') return false;
+        if (epRank != (white ? '6' : '3')) return false;
+        enPassant = (epRank - '1') * 8 + (epFile - 'a');
+        p += 2;
+
+        U64 occupied = 0;
+        for (U64 board : boards) occupied |= board;
+        int pawnSquare = white ? enPassant - 8 : enPassant + 8;
+        int originSquare = white ? enPassant + 8 : enPassant - 8;
+        U64 movedPawns = boards[static_cast<int>(white ? PieceType::BP : PieceType::WP)];
+        if ((occupied & ((1ULL << enPassant) | (1ULL << originSquare))) || !(movedPawns & (1ULL << pawnSquare))) return false;
+    }
+
+    // The side that has just moved cannot have left its king in check
+    U64 pawnAttacks, pieceAttacks;
+    sideAttacks(boards, white, pawnAttacks, pieceAttacks);
+    if ((pawnAttacks | pieceAttacks) & (white ? blackKing : whiteKing)) return false;
+
+    // 5 & 6. Halfmove clock and fullmove number (optional)
+    int halfmove = 0, fullmove = 1;
+    auto isSpace = [](char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; };
+    auto parseNumber = [&](int& value) {
+        const char* start = p;
+        value = 0;
+        while (p != end && *p >= '0' && *p <= '9' && p - start < 6) value = value * 10 + (*p++ - '0');
+        return p != start && (p == end || isSpace(*p));
+    };
+
+    if (p != end && *p == ' ' && p + 1 != end && p[1] >= '0' && p[1] <= '9') {
+        p++;
+        if (!parseNumber(halfmove)) return false;
+        if (p == end || *p++ != ' ') return false;
+        if (!parseNumber(fullmove) || fullmove < 1) return false;
+    }
+
+    // Only trailing whitespace may follow
+    while (p != end) {
+        if (!isSpace(*p++)) return false;
+    }
+
+    // Commit
+    for (int i = 0; i < 12; i++) {
+        currentBoard[static_cast<PieceType>(i)] = boards[i];
+    }
+    whiteToMove = white;
+    castlingRights = castling;
+    enPassantSquare = enPassant;
+    halfmoveClock = halfmove;
+    fullmoveNumber = fullmove;
+    rebuildMailbox();
+    version++;
+    checkMailbox();
+
+    return true;
+
+}
+
+// Serialise the board into buffer as a null terminated FEN, returns the number of characters written
+size_t Board::writeFEN(char* buffer) {
+
+    char* p = buffer;
+
+    // Build a square -> piece letter lookup
+    char squares[64];
+    for (int i = 0; i < 64; i++) squares[i] = 0;
+    for (const auto& [type, bitboard] : currentBoard) {
+        U64 pieces = bitboard;
+        while (pieces) {
+            int index = findLSBIndex(pieces);
+            pieces &= pieces - 1;
+            squares[index] = pieceTypeToChar(type);
+        }
+    }
+
+    // 1. Piece placement
+    for (int rank = 7; rank >= 0; rank--) {
+        int emptyCount = 0;
+        for (int file = 0; file < 8; file++) {
+            char c = squares[rank * 8 + file];
+            if (!c) {
+                emptyCount++;
+                continue;
+            }
+            if (emptyCount) *p++ = '0' + emptyCount;
+            emptyCount = 0;
+            *p++ = c;
+        }
+        if (emptyCount) *p++ = '0' + emptyCount;
+        if (rank) *p++ = '/';
+    }
+
+    // 2. Side to move
+    *p++ = ' ';
+    *p++ = whiteToMove ? 'w' : 'b';
+
+    // 3. Castling rights
+    *p++ = ' ';
+    if (!castlingRights) *p++ = '-';
+    if (castlingRights & CASTLE_WK) *p++ = 'K';
+    if (castlingRights & CASTLE_WQ) *p++ = 'Q';
+    if (castlingRights & CASTLE_BK) *p++ = 'k';
+    if (castlingRights & CASTLE_BQ) *p++ = 'q';
+
+    // 4. En passant target
+    *p++ = ' ';
+    if (enPassantSquare < 0) {
+        *p++ = '-';
+    } else {
+        *p++ = 'a' + enPassantSquare % 8;
+        *p++ = '1' + enPassantSquare / 8;
+    }
+
+    // 5 & 6. Move clocks
+    auto writeNumber = [&](int value) {
+        char digits[12];
+        int count = 0;
+        do {
+            digits[count++] = '0' + value % 10;
+            value /= 10;
+        } while (value && count < 10);
+        while (count) *p++ = digits[--count];
+    };
+
+    *p++ = ' ';
+    writeNumber(halfmoveClock);
+    *p++ = ' ';
+    writeNumber(fullmoveNumber);
+
+    *p = '\0';
+    return p - buffer;
+
+}
+
+string Board::getFEN() {
+    char buffer[FEN_MAX_LENGTH];
+    size_t length = writeFEN(buffer);
+    return string(buffer, length);
+}
+
+bool Board::isWhiteToMove() {
+    return whiteToMove;
+}
+
+int Board::getCastlingRights() {
+    return castlingRights;
+}
+
+int Board::getEnPassantSquare() {
+    return enPassantSquare;
+}
+
+int Board::getHalfmoveClock() {
+    return halfmoveClock;
+}
+
+int Board::getFullmoveNumber() {
+    return fullmoveNumber;
+}
+
+uint64_t Board::getVersion() {
+    return version;
 }
 
 // Print the board (debugging purposes)
@@ -172,12 +643,40 @@ void Board::initialiseBoard(){
     defaultBoard[PieceType::BK] = 0x10ULL << 8 * 7;
 
     currentBoard = defaultBoard;
+    rebuildMailbox();
+    version++;
+
+    whiteToMove = true;
+    castlingRights = CASTLE_WK | CASTLE_WQ | CASTLE_BK | CASTLE_BQ;
+    enPassantSquare = -1;
+    halfmoveClock = 0;
+    fullmoveNumber = 1;
 
 }
 
-unordered_map<PieceType, U64> Board::getCurrentBoard(){
+const unordered_map<PieceType, U64>& Board::getCurrentBoard() const {
     return currentBoard;
 }
 
+U64 Board::getBitboard(PieceType type) const {
+    auto found = currentBoard.find(type);
+    return found == currentBoard.end() ? 0 : found->second;
+}
+
+// Bare kings, or a lone bishop or knight
+bool hasInsufficientMaterial(const Board& board) {
+    U64 heavy = board.getBitboard(PieceType::WP) | board.getBitboard(PieceType::BP) | board.getBitboard(PieceType::WR)
+                | board.getBitboard(PieceType::BR) | board.getBitboard(PieceType::WQ) | board.getBitboard(PieceType::BQ);
+    U64 minors = board.getBitboard(PieceType::WB) | board.getBitboard(PieceType::BB) | board.getBitboard(PieceType::WN)
+                 | board.getBitboard(PieceType::BN);
+    return !heavy && countSetBits(minors) <= 1;
+}
+
+// The draws the game ends on without a claim from either side: fifty moves, the same position a third time
+// (repetitions counts its occurrences, this one included) or too little material to mate
+bool isDrawnByRule(Board& board, int repetitions) {
+    return board.getHalfmoveClock() >= 100 || repetitions >= 3 || hasInsufficientMaterial(board);
+}
+
 
 #endif // BOARD_H
\ No newline at end of file
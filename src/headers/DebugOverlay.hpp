@@ -0,0 +1,96 @@
+#ifndef DEBUGOVERLAY_HPP
+#define DEBUGOVERLAY_HPP
+
+#include <SDL.h>
+#include <PixelFont.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+// Frame timing shown in the top left corner of the window, toggled at runtime
+class DebugOverlay {
+
+    private:
+        static const int HISTORY = 60;
+        static const int PIXEL = 2;
+
+        SDL_Renderer* renderer;
+        bool visible;
+
+        double frameTimes[HISTORY];
+        int frameIndex;
+        int frameCount;
+        int lastSquares;
+
+        std::vector<SDL_Rect> pixels;
+
+    public:
+        DebugOverlay(SDL_Renderer* r);
+
+        void toggle();
+        bool isVisible();
+
+        // Time taken to render and present a frame, and how many squares it had to redraw
+        void recordFrame(double seconds, int squaresRedrawn);
+
+        void draw();
+
+        // Copy constructor and copy assignment operators should not be allowed
+        DebugOverlay(const DebugOverlay&) = delete;
+        DebugOverlay& operator=(const DebugOverlay&) = delete;
+
+};
+
+DebugOverlay::DebugOverlay(SDL_Renderer* r) : renderer(r), visible(false), frameIndex(0), frameCount(0), lastSquares(0) {
+    for (int i = 0; i < HISTORY; i++) frameTimes[i] = 0;
+}
+
+void DebugOverlay::toggle() {
+    visible = !visible;
+}
+
+bool DebugOverlay::isVisible() {
+    return visible;
+}
+
+void DebugOverlay::recordFrame(double seconds, int squaresRedrawn) {
+    frameTimes[frameIndex] = seconds;
+    frameIndex = (frameIndex + 1) % HISTORY;
+    frameCount = std::min(frameCount + 1, HISTORY);
+    lastSquares = squaresRedrawn;
+}
+
+void DebugOverlay::draw() {
+
+    if (!visible) return;
+
+    double last = frameTimes[(frameIndex + HISTORY - 1) % HISTORY];
+    double total = 0, worst = 0;
+    for (int i = 0; i < frameCount; i++) {
+        total += frameTimes[i];
+        worst = std::max(worst, frameTimes[i]);
+    }
+    double average = frameCount ? total / frameCount : 0;
+
+    char lines[4][32];
+    std::snprintf(lines[0], sizeof(lines[0]), "FRAME %.2f MS", last * 1000);
+    std::snprintf(lines[1], sizeof(lines[1]), "AVG %.2f MS", average * 1000);
+    std::snprintf(lines[2], sizeof(lines[2]), "MAX %.2f MS", worst * 1000);
+    std::snprintf(lines[3], sizeof(lines[3]), "SQ %d", lastSquares);
+
+    pixels.clear();
+    for (int i = 0; i < 4; i++) addPixelText(pixels, lines[i], 6, 6 + i * 7 * PIXEL, PIXEL);
+
+    // Translucent backing so the text stays readable on both square colours
+    SDL_Rect background = {2, 2, 14 * 4 * PIXEL + 6, 4 * 7 * PIXEL + 6};
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 160);
+    SDL_RenderFillRect(renderer, &background);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    SDL_RenderFillRects(renderer, pixels.data(), static_cast<int>(pixels.size()));
+
+}
+
+#endif // DEBUGOVERLAY_HPP
@@ -0,0 +1,147 @@
+#ifndef ENGINEPLAYER_HPP
+#define ENGINEPLAYER_HPP
+
+#include <Board.hpp>
+#include <Search.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Plays one side of a game. Each move is searched on a worker thread within the configured limits; the
+// game loop picks the move up with takeMove and plays it on its own board, so it never waits on the search.
+class EnginePlayer {
+
+    private:
+        Search search;
+        SearchLimits limits;
+        std::thread worker;
+
+        // Called on the worker thread when a move is ready, e.g. to wake up the game loop
+        std::function<void()> onMoveReady;
+
+        std::mutex mutex;
+        std::condition_variable changed;
+        Position requested;
+        uint64_t requestedGeneration;
+        uint64_t searchedGeneration;
+        bool hasResult;
+        SearchResult result;
+        bool stopping;
+
+        // Raised to abandon the search in progress, cleared when the worker takes the next position
+        std::atomic<bool> cancel;
+
+        void work();
+
+    public:
+        EnginePlayer(Board& prototype, const SearchLimits& searchLimits, const std::function<void()>& onMoveReady = nullptr,
+                     const Tablebases* tablebases = nullptr, const Bitbases* bitbases = nullptr);
+        ~EnginePlayer();
+
+        // Starts searching the board's current position, for the side to move
+        void think(Board& current);
+
+        // True from think until the move has been taken, or the search aborted
+        bool isThinking();
+
+        // The engine's move once the search has finished, without waiting. A result without a move
+        // means the engine has no legal moves (checkmate or stalemate).
+        bool takeMove(SearchResult& move);
+
+        // Abandons the search in progress, its move is never handed out
+        void abort();
+
+        // Copy constructor and copy assignment operators should not be allowed
+        EnginePlayer(const EnginePlayer&) = delete;
+        EnginePlayer& operator=(const EnginePlayer&) = delete;
+
+};
+
+EnginePlayer::EnginePlayer(Board& prototype, const SearchLimits& searchLimits, const std::function<void()>& callback,
+                           const Tablebases* tablebases, const Bitbases* bitbases)
+    : search(prototype, tablebases, bitbases), limits(searchLimits), onMoveReady(callback), requestedGeneration(0), searchedGeneration(0),
+      hasResult(false), stopping(false), cancel(false) {
+    worker = std::thread(&EnginePlayer::work, this);
+}
+
+EnginePlayer::~EnginePlayer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        cancel = true;
+    }
+    changed.notify_all();
+    worker.join();
+}
+
+void EnginePlayer::think(Board& current) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        current.savePosition(requested);
+        requestedGeneration++;
+        hasResult = false;
+        cancel = true;
+    }
+    changed.notify_all();
+}
+
+bool EnginePlayer::isThinking() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return searchedGeneration != requestedGeneration || hasResult;
+}
+
+bool EnginePlayer::takeMove(SearchResult& move) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!hasResult) return false;
+    move = result;
+    hasResult = false;
+    return true;
+}
+
+void EnginePlayer::abort() {
+    std::lock_guard<std::mutex> lock(mutex);
+    searchedGeneration = requestedGeneration;
+    hasResult = false;
+    cancel = true;
+}
+
+void EnginePlayer::work() {
+
+    while (true) {
+
+        Position position;
+        uint64_t generation;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&]() { return stopping || searchedGeneration != requestedGeneration; });
+            if (stopping) return;
+            generation = requestedGeneration;
+            position = requested;
+            cancel = false;
+        }
+
+        SearchLimits searchLimits = limits;
+        searchLimits.cancel = &cancel;
+        SearchResult searched = search.run(position, searchLimits);
+
+        // Only handed out if nobody asked for something else in the meantime
+        bool isCurrent;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            isCurrent = !cancel && generation == requestedGeneration && searchedGeneration != requestedGeneration;
+            if (isCurrent) {
+                result = searched;
+                hasResult = true;
+                searchedGeneration = generation;
+            }
+        }
+
+        if (isCurrent && onMoveReady) onMoveReady();
+    }
+
+}
+
+#endif // ENGINEPLAYER_HPP
@@ -0,0 +1,131 @@
+#ifndef EVALUATION_HPP
+#define EVALUATION_HPP
+
+#include <Attacks.hpp>
+#include <Board.hpp>
+#include <BitOperations.hpp>
+#include <EvaluationParameters.hpp>
+#include <MoveGenerator.hpp>
+#include <PieceType.hpp>
+#include <cstdint>
+#include <vector>
+
+// Evaluation in centipawns: material and piece-square tables, mobility and king safety. Tables are written
+// from white's point of view with rank 8 on the first line, so a white piece on square s (a1 = 0) reads
+// entry s ^ 56 and a black piece reads entry s.
+//
+// Every term is a weight from EvaluationParameters.hpp times a count, so the evaluation is a dot product
+// of the weights with the counts of the position. The tuner works on that form: the weights laid out one
+// after another, in the order below, and each position as the counts that are not zero.
+const int EVAL_PIECE_VALUES = 0;
+const int EVAL_PIECE_SQUARE_TABLES = EVAL_PIECE_VALUES + 6;
+const int EVAL_MOBILITY = EVAL_PIECE_SQUARE_TABLES + 6 * 64;
+const int EVAL_KING_SHIELD = EVAL_MOBILITY + 6;
+const int EVAL_KING_ATTACK = EVAL_KING_SHIELD + 2;
+const int EVAL_PARAMETER_COUNT = EVAL_KING_ATTACK + 1;
+
+struct EvaluationFeature {
+    uint16_t parameter;
+    int16_t count;          // white's count minus black's
+};
+
+// The counts of every term for one side: pieces on their squares, mobility, king shield and king attacks.
+// add(parameter, count) is called for each.
+template <typename Add>
+void evaluationCounts(const U64* pieces, bool isWhite, Add add) {
+
+    int first = isWhite ? 6 : 0, enemy = isWhite ? 0 : 6;
+    U64 own = 0, occupied = 0;
+    for (int type = 0; type < 12; type++) occupied |= pieces[type];
+    for (int type = first; type < first + 6; type++) own |= pieces[type];
+    U64 enemyKing = pieces[enemy + 5];
+    U64 enemyKingZone = enemyKing | kingAttacksOf(enemyKing);
+
+    int mobility[6] = {0, 0, 0, 0, 0, 0};
+    int kingAttacks = 0;
+
+    for (int kind = 0; kind < 6; kind++) {
+        for (U64 remaining = pieces[first + kind]; remaining; remaining &= remaining - 1) {
+            int square = findLSBIndex(remaining);
+            add(EVAL_PIECE_VALUES + kind, 1);
+            add(EVAL_PIECE_SQUARE_TABLES + kind * 64 + (isWhite ? square ^ 56 : square), 1);
+
+            if (kind == 0 || kind == 5) continue;
+            U64 piece = 1ULL << square;
+            U64 attacks = kind == 3 ? knightAttacksOf(piece)
+                        : kind == 1 ? orthogonalAttacks(piece, ~occupied)
+                        : kind == 2 ? diagonalAttacks(piece, ~occupied)
+                        : orthogonalAttacks(piece, ~occupied) | diagonalAttacks(piece, ~occupied);
+            mobility[kind] += countSetBits(attacks & ~own);
+            kingAttacks += countSetBits(attacks & enemyKingZone);
+        }
+    }
+
+    for (int kind = 1; kind < 5; kind++) {
+        if (mobility[kind]) add(EVAL_MOBILITY + kind, mobility[kind]);
+    }
+    if (kingAttacks) add(EVAL_KING_ATTACK, kingAttacks);
+
+    // Own pawns on the three files around the king, one and two ranks ahead of it
+    U64 king = pieces[first + 5];
+    U64 row = king | ((king << 1) & ~FILE_A) | ((king >> 1) & ~FILE_H);
+    U64 pawns = pieces[first];
+    for (int i = 0; i < 2; i++) {
+        row = isWhite ? row << 8 : row >> 8;
+        int shield = countSetBits(row & pawns);
+        if (shield) add(EVAL_KING_SHIELD + i, shield);
+    }
+
+}
+
+// Every weight, in the layout above
+std::vector<int> evaluationWeights() {
+    std::vector<int> weights;
+    weights.insert(weights.end(), PIECE_VALUES, PIECE_VALUES + 6);
+    for (int kind = 0; kind < 6; kind++) weights.insert(weights.end(), PIECE_SQUARE_TABLES[kind], PIECE_SQUARE_TABLES[kind] + 64);
+    weights.insert(weights.end(), MOBILITY_WEIGHTS, MOBILITY_WEIGHTS + 6);
+    weights.insert(weights.end(), KING_SHIELD_WEIGHTS, KING_SHIELD_WEIGHTS + 2);
+    weights.push_back(KING_ATTACK_WEIGHT);
+    return weights;
+}
+
+const std::vector<int> EVAL_WEIGHTS = evaluationWeights();
+
+// Score from white's point of view
+int evaluateWhite(Board& board) {
+
+    U64 pieces[12];
+    for (int type = 0; type < 12; type++) pieces[type] = board.getBitboard(static_cast<PieceType>(type));
+
+    const int* weights = EVAL_WEIGHTS.data();
+    int score = 0;
+    evaluationCounts(pieces, true, [&score, weights](int parameter, int count) { score += weights[parameter] * count; });
+    evaluationCounts(pieces, false, [&score, weights](int parameter, int count) { score -= weights[parameter] * count; });
+    return score;
+
+}
+
+// Score from the side to move's point of view, as used by the search
+int evaluate(Board& board) {
+    int score = evaluateWhite(board);
+    return board.isWhiteToMove() ? score : -score;
+}
+
+// The position as the tuner sees it: evaluateWhite is the sum of each feature's count times its weight
+void evaluationFeatures(Board& board, std::vector<EvaluationFeature>& features) {
+
+    U64 pieces[12];
+    for (int type = 0; type < 12; type++) pieces[type] = board.getBitboard(static_cast<PieceType>(type));
+
+    int counts[EVAL_PARAMETER_COUNT] = {};
+    evaluationCounts(pieces, true, [&counts](int parameter, int count) { counts[parameter] += count; });
+    evaluationCounts(pieces, false, [&counts](int parameter, int count) { counts[parameter] -= count; });
+
+    features.clear();
+    for (int parameter = 0; parameter < EVAL_PARAMETER_COUNT; parameter++) {
+        if (counts[parameter]) features.push_back({static_cast<uint16_t>(parameter), static_cast<int16_t>(counts[parameter])});
+    }
+
+}
+
+#endif // EVALUATION_HPP
@@ -0,0 +1,811 @@
+#ifndef GAMEARCHIVE_HPP
+#define GAMEARCHIVE_HPP
+
+#include <Attacks.hpp>
+#include <Board.hpp>
+#include <MappedFile.hpp>
+#include <Move.hpp>
+#include <PackedPosition.hpp>
+#include <zlib.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Binary game archive
+//
+// File layout (all integers little endian):
+//   header  "BBARCHV1"
+//   blocks  zlib compressed runs of game records (stored as is when compression does not help)
+//   index   one 32 byte entry per block: offset u64, compressed size u32, raw size u32,
+//           first game u64, game count u32, reserved u32
+//   footer  index offset u64, block count u64, game count u64, "BBARCHV1"
+//
+// Game record (inside a block):
+//   u8      flags: bits 0-1 GameResult, bit 2 start position follows
+//   [32]    packed start position (only when it is not the initial position)
+//   varint  number of plies
+//   varint  length of the move bitstream in bytes
+//   bytes   move bitstream, least significant bit first. Each move is written as two indices into
+//           the pseudo-legal move list of the side to move, split by moving piece:
+//             - which piece moves, counting the side's pieces in PieceType then square order
+//             - which of that piece's destinations it moves to, in square order (times 4 plus the
+//               promotion piece Q/R/B/N for promotions)
+//           Each index uses just enough bits to cover its count, so a decoder only has to generate
+//           the moves of one piece per ply.
+//
+// A lone position can be stored as a game with no plies.
+//
+// The codec replays games on the bitboards of a Position with the set-wise attacks of Attacks.hpp rather
+// than on a Board, since a decoder needs no more than one piece's destinations and the next position per
+// ply. The destinations are the ones MoveGenerator::generatePiecePseudoLegalMoves gives, so both agree on
+// every archive.
+
+const char ARCHIVE_MAGIC[8] = {'B', 'B', 'A', 'R', 'C', 'H', 'V', '1'};
+const size_t ARCHIVE_BLOCK_SIZE = 64 * 1024;
+const size_t ARCHIVE_INDEX_ENTRY_SIZE = 32;
+const size_t ARCHIVE_FOOTER_SIZE = 32;
+
+struct ArchivedGame {
+    GameResult result;
+    std::vector<Move> moves;
+    std::vector<Position> positions;    // positions[0] is the start, positions[i + 1] follows moves[i]
+};
+
+// Little endian and varint helpers
+void appendU32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+void appendU64(std::vector<uint8_t>& out, uint64_t value) {
+    for (int i = 0; i < 8; i++) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+void appendVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint32_t readU32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint64_t readU64(const uint8_t* p) {
+    return readU32(p) | (static_cast<uint64_t>(readU32(p + 4)) << 32);
+}
+
+// Returns false if the varint runs past end
+bool readVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; p != end && shift < 64; shift += 7) {
+        uint8_t byte = *p++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// Number of bits needed to store an index into a list of the given size
+int bitsForCount(size_t count) {
+    int bits = 0;
+    while ((static_cast<size_t>(1) << bits) < count) bits++;
+    return bits;
+}
+
+// Encodes and decodes single game records, one instance per thread
+class GameCodec {
+
+    private:
+        Position position;
+        int pieceCounts[12];            // of position, by PieceType
+        Position initialPosition;
+        std::vector<uint8_t> bitstream;
+
+        // Bitstream state
+        uint64_t bitBuffer;
+        int bitCount;
+        const uint8_t* readPointer;
+        const uint8_t* readEnd;
+
+        void writeBits(uint64_t value, int width);
+        bool readBits(int width, uint64_t& value);
+
+        void setPosition(const Position& start);
+
+        // Pseudo-legal destinations of the piece on fromPos, including en passant and castling
+        U64 generateDestinations(PieceType piece, int fromPos);
+
+        // Plays the move on the position, as Board::simulateExecuteMove does on a board
+        void playMove(PieceType piece, int fromPos, int toPos, PieceType promotion);
+
+    public:
+        GameCodec();
+
+        // Appends the record to out, returns false (leaving out untouched) if a move is not playable
+        bool encode(const Position& start, const std::vector<Move>& moves, GameResult result, std::vector<uint8_t>& out);
+
+        // Decodes the record at p, advancing p past it
+        bool decode(const uint8_t*& p, const uint8_t* end, ArchivedGame& game);
+
+        // Advances p past the record at p without replaying it
+        static bool skip(const uint8_t*& p, const uint8_t* end);
+
+};
+
+GameCodec::GameCodec() {
+    Board board;
+    board.savePosition(initialPosition);
+    setPosition(initialPosition);
+}
+
+void GameCodec::writeBits(uint64_t value, int width) {
+    bitBuffer |= value << bitCount;
+    bitCount += width;
+    while (bitCount >= 8) {
+        bitstream.push_back(static_cast<uint8_t>(bitBuffer));
+        bitBuffer >>= 8;
+        bitCount -= 8;
+    }
+}
+
+bool GameCodec::readBits(int width, uint64_t& value) {
+    while (bitCount < width) {
+        if (readPointer == readEnd) return false;
+        bitBuffer |= static_cast<uint64_t>(*readPointer++) << bitCount;
+        bitCount += 8;
+    }
+    value = bitBuffer & ((1ULL << width) - 1);
+    bitBuffer >>= width;
+    bitCount -= width;
+    return true;
+}
+
+void GameCodec::setPosition(const Position& start) {
+    position = start;
+    for (int t = 0; t < 12; t++) pieceCounts[t] = countSetBits(position.bitboards[t]);
+}
+
+U64 GameCodec::generateDestinations(PieceType piece, int fromPos) {
+
+    const U64* pieces = position.bitboards;
+    bool isWhite = isWhitePiece(piece);
+    U64 white = 0, black = 0;
+    for (int t = 0; t < 6; t++) {
+        black |= pieces[t];
+        white |= pieces[t + 6];
+    }
+    U64 own = isWhite ? white : black;
+    U64 opponent = isWhite ? black : white;
+    U64 occupied = white | black;
+    U64 empty = ~occupied;
+    U64 from = 1ULL << fromPos;
+
+    switch (piece) {
+        case PieceType::WP: case PieceType::BP: {
+            // Pushes, the double one only through an empty square, and captures including en passant
+            U64 single = (isWhite ? from << 8 : from >> 8) & empty;
+            U64 twice = (isWhite ? (single & (RANK_2 << 8)) << 8 : (single & (RANK_7 >> 8)) >> 8) & empty;
+            U64 targets = opponent;
+            if (position.enPassantSquare != -1) targets |= 1ULL << position.enPassantSquare;
+            return single | twice | (pawnAttacksOf(from, isWhite) & targets);
+        }
+        case PieceType::WN: case PieceType::BN:
+            return knightAttacksOf(from) & ~own;
+        case PieceType::WB: case PieceType::BB:
+            return diagonalAttacks(from, empty) & ~own;
+        case PieceType::WR: case PieceType::BR:
+            return orthogonalAttacks(from, empty) & ~own;
+        case PieceType::WQ: case PieceType::BQ:
+            return (orthogonalAttacks(from, empty) | diagonalAttacks(from, empty)) & ~own;
+        case PieceType::WK: case PieceType::BK: {
+            U64 destinations = kingAttacksOf(from) & ~own;
+
+            // Castling, through empty squares with the rook still in its corner (as MoveGenerator)
+            int home = isWhite ? 4 : 60;
+            int rights = position.castlingRights & (isWhite ? (CASTLE_WK | CASTLE_WQ) : (CASTLE_BK | CASTLE_BQ));
+            if (fromPos == home && rights) {
+                U64 rooks = pieces[static_cast<int>(isWhite ? PieceType::WR : PieceType::BR)];
+                if ((rights & (CASTLE_WK | CASTLE_BK)) && (rooks & (1ULL << (home + 3))) && !(occupied & (3ULL << (home + 1)))) {
+                    destinations |= 1ULL << (home + 2);
+                }
+                if ((rights & (CASTLE_WQ | CASTLE_BQ)) && (rooks & (1ULL << (home - 4))) && !(occupied & (7ULL << (home - 3)))) {
+                    destinations |= 1ULL << (home - 2);
+                }
+            }
+            return destinations;
+        }
+        default:
+            return 0;
+    }
+
+}
+
+void GameCodec::playMove(PieceType piece, int fromPos, int toPos, PieceType promotion) {
+
+    U64* pieces = position.bitboards;
+    bool isWhite = isWhitePiece(piece);
+    bool isPawn = piece == PieceType::WP || piece == PieceType::BP;
+    bool isKing = piece == PieceType::WK || piece == PieceType::BK;
+    int opponentFirst = isWhite ? 0 : 6;
+    U64 to = 1ULL << toPos;
+
+    // Captures, en passant taking the pawn behind the target square
+    bool isCapture = false;
+    for (int t = opponentFirst; t < opponentFirst + 6; t++) {
+        if (pieces[t] & to) {
+            pieces[t] &= ~to;
+            pieceCounts[t]--;
+            isCapture = true;
+        }
+    }
+    if (!isCapture && isPawn && toPos == position.enPassantSquare && (toPos - fromPos) % 8 != 0) {
+        int pawn = static_cast<int>(isWhite ? PieceType::BP : PieceType::WP);
+        pieces[pawn] &= ~(1ULL << (isWhite ? toPos - 8 : toPos + 8));
+        pieceCounts[pawn]--;
+        isCapture = true;
+    }
+
+    pieces[static_cast<int>(piece)] ^= (1ULL << fromPos) | to;
+
+    if (isPawn && (toPos >= 56 || toPos < 8)) {
+        if (promotion == PieceType::EMPTY) promotion = isWhite ? PieceType::WQ : PieceType::BQ;
+        pieces[static_cast<int>(piece)] &= ~to;
+        pieces[static_cast<int>(promotion)] |= to;
+        pieceCounts[static_cast<int>(piece)]--;
+        pieceCounts[static_cast<int>(promotion)]++;
+    }
+
+    // Castling, the rook jumps over to the square the king passed through
+    if (isKing && (toPos - fromPos == 2 || fromPos - toPos == 2)) {
+        int rookFrom = toPos > fromPos ? fromPos + 3 : fromPos - 4;
+        pieces[static_cast<int>(isWhite ? PieceType::WR : PieceType::BR)] ^= (1ULL << rookFrom) | (1ULL << ((fromPos + toPos) / 2));
+    }
+
+    // The rest follows Board::updateGameState
+    if (piece == PieceType::WK) position.castlingRights &= ~(CASTLE_WK | CASTLE_WQ);
+    if (piece == PieceType::BK) position.castlingRights &= ~(CASTLE_BK | CASTLE_BQ);
+    if (fromPos == 0  || toPos == 0)  position.castlingRights &= ~CASTLE_WQ;
+    if (fromPos == 7  || toPos == 7)  position.castlingRights &= ~CASTLE_WK;
+    if (fromPos == 56 || toPos == 56) position.castlingRights &= ~CASTLE_BQ;
+    if (fromPos == 63 || toPos == 63) position.castlingRights &= ~CASTLE_BK;
+
+    if (isPawn && (toPos - fromPos == 16 || fromPos - toPos == 16)) position.enPassantSquare = (fromPos + toPos) / 2;
+    else position.enPassantSquare = -1;
+
+    if (isPawn || isCapture) position.halfmoveClock = 0;
+    else position.halfmoveClock++;
+
+    if (!position.whiteToMove) position.fullmoveNumber++;
+    position.whiteToMove = !position.whiteToMove;
+
+}
+
+bool GameCodec::encode(const Position& start, const std::vector<Move>& moves, GameResult result, std::vector<uint8_t>& out) {
+
+    setPosition(start);
+    bitstream.clear();
+    bitBuffer = 0;
+    bitCount = 0;
+
+
+    for (const Move& move : moves) {
+
+        bool isWhite = position.whiteToMove;
+        if (isWhitePiece(move.piece) != isWhite) return false;
+
+        // Which piece moves
+        int firstType = static_cast<int>(isWhite ? PieceType::WP : PieceType::BP);
+        int pieceCount = 0, pieceIndex = -1;
+        for (int t = firstType; t < firstType + 6; t++) {
+            U64 pieces = position.bitboards[t];
+            if (static_cast<PieceType>(t) == move.piece) {
+                if (!(pieces & (1ULL << move.fromPos))) return false;
+                pieceIndex = pieceCount + countSetBits(pieces & ((1ULL << move.fromPos) - 1));
+            }
+            pieceCount += countSetBits(pieces);
+        }
+
+        // Where it moves to
+        U64 destinations = generateDestinations(move.piece, move.fromPos);
+        if (!(destinations & (1ULL << move.toPos))) return false;
+
+        int destinationCount = countSetBits(destinations);
+        int destinationIndex = countSetBits(destinations & ((1ULL << move.toPos) - 1));
+
+        bool isPromotion = (move.piece == PieceType::WP || move.piece == PieceType::BP) && (move.toPos >= 56 || move.toPos < 8);
+        if (isPromotion) {
+            int promotionIndex;
+            switch (move.promotion) {
+                case PieceType::WQ: case PieceType::BQ: case PieceType::EMPTY: promotionIndex = 0; break;
+                case PieceType::WR: case PieceType::BR: promotionIndex = 1; break;
+                case PieceType::WB: case PieceType::BB: promotionIndex = 2; break;
+                default: promotionIndex = 3; break;
+            }
+            destinationCount *= 4;
+            destinationIndex = destinationIndex * 4 + promotionIndex;
+        }
+
+        writeBits(pieceIndex, bitsForCount(pieceCount));
+        writeBits(destinationIndex, bitsForCount(destinationCount));
+
+        playMove(move.piece, move.fromPos, move.toPos, move.promotion);
+    }
+    if (bitCount) bitstream.push_back(static_cast<uint8_t>(bitBuffer));
+
+    // Only store the start position when it differs from the initial position
+    const Position& initial = initialPosition;
+    bool customStart = memcmp(&initial.bitboards, &start.bitboards, sizeof(start.bitboards)) != 0
+                       || initial.whiteToMove != start.whiteToMove || initial.castlingRights != start.castlingRights
+                       || initial.enPassantSquare != start.enPassantSquare || initial.halfmoveClock != start.halfmoveClock
+                       || initial.fullmoveNumber != start.fullmoveNumber;
+
+    out.push_back(static_cast<uint8_t>(static_cast<int>(result) | (customStart ? 4 : 0)));
+    if (customStart) {
+        uint8_t packed[PACKED_POSITION_SIZE];
+        packPosition(start, packed);
+        out.insert(out.end(), packed, packed + PACKED_POSITION_SIZE);
+    }
+    appendVarint(out, moves.size());
+    appendVarint(out, bitstream.size());
+    out.insert(out.end(), bitstream.begin(), bitstream.end());
+
+    return true;
+
+}
+
+bool GameCodec::decode(const uint8_t*& p, const uint8_t* end, ArchivedGame& game) {
+
+    game.moves.clear();
+    game.positions.clear();
+
+    if (p == end) return false;
+    uint8_t flags = *p++;
+    game.result = static_cast<GameResult>(flags & 3);
+
+    if (flags & 4) {
+        if (end - p < PACKED_POSITION_SIZE) return false;
+        Position start;
+        unpackPosition(p, start);
+        p += PACKED_POSITION_SIZE;
+        setPosition(start);
+    } else {
+        setPosition(initialPosition);
+    }
+    game.positions.push_back(position);
+
+    uint64_t plies, byteCount;
+    if (!readVarint(p, end, plies) || !readVarint(p, end, byteCount)) return false;
+    if (static_cast<uint64_t>(end - p) < byteCount) return false;
+
+    readPointer = p;
+    readEnd = p + byteCount;
+    bitBuffer = 0;
+    bitCount = 0;
+    p += byteCount;
+
+    for (uint64_t ply = 0; ply < plies; ply++) {
+
+        bool isWhite = position.whiteToMove;
+        int firstType = static_cast<int>(isWhite ? PieceType::WP : PieceType::BP);
+
+        // Which piece moves
+        const U64* pieceBoards = position.bitboards + firstType;
+        const int* counts = pieceCounts + firstType;
+        int pieceCount = counts[0] + counts[1] + counts[2] + counts[3] + counts[4] + counts[5];
+
+        uint64_t pieceIndex;
+        if (!readBits(bitsForCount(pieceCount), pieceIndex) || static_cast<int>(pieceIndex) >= pieceCount) return false;
+
+        int t = 0;
+        while (static_cast<int>(pieceIndex) >= counts[t]) pieceIndex -= counts[t++];
+
+        U64 pieces = pieceBoards[t];
+        for (uint64_t i = 0; i < pieceIndex; i++) pieces &= pieces - 1;
+
+        PieceType piece = static_cast<PieceType>(firstType + t);
+        int fromPos = findLSBIndex(pieces);
+
+        // Where it moves to
+        U64 destinations = generateDestinations(piece, fromPos);
+        int destinationCount = countSetBits(destinations);
+
+        bool isPawn = piece == PieceType::WP || piece == PieceType::BP;
+        bool isPromotion = isPawn && (destinations & (isWhite ? RANK_8 : RANK_1));
+        if (isPromotion) destinationCount *= 4;
+
+        uint64_t destinationIndex;
+        if (destinationCount == 0 || !readBits(bitsForCount(destinationCount), destinationIndex)
+            || static_cast<int>(destinationIndex) >= destinationCount) return false;
+
+        PieceType promotion = PieceType::EMPTY;
+        if (isPromotion) {
+            const PieceType promotions[] = {
+                isWhite ? PieceType::WQ : PieceType::BQ,
+                isWhite ? PieceType::WR : PieceType::BR,
+                isWhite ? PieceType::WB : PieceType::BB,
+                isWhite ? PieceType::WN : PieceType::BN
+            };
+            promotion = promotions[destinationIndex % 4];
+            destinationIndex /= 4;
+        }
+
+        for (uint64_t i = 0; i < destinationIndex; i++) destinations &= destinations - 1;
+        int toPos = findLSBIndex(destinations);
+
+        playMove(piece, fromPos, toPos, promotion);
+        game.moves.push_back({piece, fromPos, toPos, promotion});
+        game.positions.push_back(position);
+    }
+
+    return true;
+
+}
+
+bool GameCodec::skip(const uint8_t*& p, const uint8_t* end) {
+
+    if (p == end) return false;
+    uint8_t flags = *p++;
+    if (flags & 4) {
+        if (end - p < PACKED_POSITION_SIZE) return false;
+        p += PACKED_POSITION_SIZE;
+    }
+
+    uint64_t plies, byteCount;
+    if (!readVarint(p, end, plies) || !readVarint(p, end, byteCount)) return false;
+    if (static_cast<uint64_t>(end - p) < byteCount) return false;
+    p += byteCount;
+    return true;
+
+}
+
+class GameArchiveWriter {
+
+    private:
+        FILE* file;
+        GameCodec codec;
+        std::vector<uint8_t> record;
+        std::vector<uint8_t> block;
+        std::vector<uint8_t> compressed;
+        std::vector<uint8_t> index;
+        uint64_t offset;
+        uint64_t gameCount;
+        uint64_t blockFirstGame;
+        uint64_t blockCount;
+
+        bool flushBlock();
+
+    public:
+        GameArchiveWriter();
+        ~GameArchiveWriter();
+
+        bool open(const std::string& path);
+
+        bool addGame(const Position& start, const std::vector<Move>& moves, GameResult result);
+
+        // Adds a record produced by a GameCodec on another thread
+        bool addRecord(const uint8_t* record, size_t length);
+
+        // Writes the index and footer, the archive is unusable until this is called
+        bool close();
+
+        uint64_t getGameCount();
+
+        // Copy constructor and copy assignment operators should not be allowed
+        GameArchiveWriter(const GameArchiveWriter&) = delete;
+        GameArchiveWriter& operator=(const GameArchiveWriter&) = delete;
+
+};
+
+GameArchiveWriter::GameArchiveWriter()
+    : file(nullptr), offset(0), gameCount(0), blockFirstGame(0), blockCount(0) {}
+
+GameArchiveWriter::~GameArchiveWriter() {
+    close();
+}
+
+bool GameArchiveWriter::open(const std::string& path) {
+
+    close();
+
+    file = fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Unable to create " << path << std::endl;
+        return false;
+    }
+
+    block.clear();
+    index.clear();
+    gameCount = blockFirstGame = blockCount = 0;
+
+    offset = fwrite(ARCHIVE_MAGIC, 1, sizeof(ARCHIVE_MAGIC), file);
+    return offset == sizeof(ARCHIVE_MAGIC);
+
+}
+
+bool GameArchiveWriter::addGame(const Position& start, const std::vector<Move>& moves, GameResult result) {
+
+    record.clear();
+    if (!codec.encode(start, moves, result, record)) return false;
+    return addRecord(record.data(), record.size());
+
+}
+
+bool GameArchiveWriter::addRecord(const uint8_t* record, size_t length) {
+
+    if (!file) return false;
+
+    // Start a new block rather than split a record across two
+    if (!block.empty() && block.size() + length > ARCHIVE_BLOCK_SIZE && !flushBlock()) return false;
+
+    block.insert(block.end(), record, record + length);
+    gameCount++;
+    return true;
+
+}
+
+bool GameArchiveWriter::flushBlock() {
+
+    if (block.empty()) return true;
+
+    uLongf compressedSize = compressBound(block.size());
+    compressed.resize(compressedSize);
+
+    const uint8_t* data = block.data();
+    size_t size = block.size();
+    if (compress2(compressed.data(), &compressedSize, block.data(), block.size(), Z_DEFAULT_COMPRESSION) == Z_OK
+        && compressedSize < block.size()) {
+        data = compressed.data();
+        size = compressedSize;
+    }
+
+    if (fwrite(data, 1, size, file) != size) return false;
+
+    appendU64(index, offset);
+    appendU32(index, static_cast<uint32_t>(size));
+    appendU32(index, static_cast<uint32_t>(block.size()));
+    appendU64(index, blockFirstGame);
+    appendU32(index, static_cast<uint32_t>(gameCount - blockFirstGame));
+    appendU32(index, 0);
+
+    offset += size;
+    blockFirstGame = gameCount;
+    blockCount++;
+    block.clear();
+    return true;
+
+}
+
+bool GameArchiveWriter::close() {
+
+    if (!file) return true;
+
+    bool ok = flushBlock();
+
+    std::vector<uint8_t> footer;
+    appendU64(footer, offset);
+    appendU64(footer, blockCount);
+    appendU64(footer, gameCount);
+    footer.insert(footer.end(), ARCHIVE_MAGIC, ARCHIVE_MAGIC + sizeof(ARCHIVE_MAGIC));
+
+    ok = ok && fwrite(index.data(), 1, index.size(), file) == index.size();
+    ok = ok && fwrite(footer.data(), 1, footer.size(), file) == footer.size();
+    ok = fclose(file) == 0 && ok;
+    file = nullptr;
+
+    return ok;
+
+}
+
+uint64_t GameArchiveWriter::getGameCount() {
+    return gameCount;
+}
+
+// Random access and sequential reading of an archive. Opening only reads the footer, so it is
+// constant time, and blocks are decompressed on demand (the most recent one is kept).
+// Not thread safe, use one reader per thread.
+class GameArchiveReader {
+
+    private:
+        MappedFile file;
+        GameCodec codec;
+        const uint8_t* indexData;
+        uint64_t blockCount;
+        uint64_t gameCount;
+
+        std::vector<uint8_t> block;
+        int64_t loadedBlock;
+
+        bool loadBlock(uint64_t blockIndex);
+        bool inflateBlock(uint64_t blockIndex, std::vector<uint8_t>& out);
+
+    public:
+        GameArchiveReader();
+
+        bool open(const std::string& path);
+
+        uint64_t getGameCount();
+
+        bool readGame(uint64_t gameNumber, ArchivedGame& game);
+
+        // Decode every game in order, returns the number of games decoded
+        uint64_t forEachGame(const std::function<void(const ArchivedGame&)>& callback);
+
+        // Decode every game with threadCount workers (0 uses every core), handing out whole blocks.
+        // The callback runs on the worker threads, with the worker index as its second argument, so
+        // games arrive out of order. Returns the number of games decoded.
+        uint64_t run(const std::function<void(const ArchivedGame&, int)>& callback, int threadCount = 0);
+
+        // Copy constructor and copy assignment operators should not be allowed
+        GameArchiveReader(const GameArchiveReader&) = delete;
+        GameArchiveReader& operator=(const GameArchiveReader&) = delete;
+
+};
+
+GameArchiveReader::GameArchiveReader()
+    : indexData(nullptr), blockCount(0), gameCount(0), loadedBlock(-1) {}
+
+bool GameArchiveReader::open(const std::string& path) {
+
+    indexData = nullptr;
+    blockCount = gameCount = 0;
+    loadedBlock = -1;
+
+    if (!file.open(path)) return false;
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(file.getData());
+    size_t size = file.getSize();
+
+    if (size < sizeof(ARCHIVE_MAGIC) + ARCHIVE_FOOTER_SIZE || memcmp(data, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0
+        || memcmp(data + size - sizeof(ARCHIVE_MAGIC), ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0) {
+        std::cerr << path << " is not a game archive" << std::endl;
+        file.close();
+        return false;
+    }
+
+    const uint8_t* footer = data + size - ARCHIVE_FOOTER_SIZE;
+    uint64_t indexOffset = readU64(footer);
+    blockCount = readU64(footer + 8);
+    gameCount = readU64(footer + 16);
+
+    if (indexOffset + blockCount * ARCHIVE_INDEX_ENTRY_SIZE != size - ARCHIVE_FOOTER_SIZE) {
+        std::cerr << path << " has a corrupt index" << std::endl;
+        file.close();
+        return false;
+    }
+
+    indexData = data + indexOffset;
+    return true;
+
+}
+
+uint64_t GameArchiveReader::getGameCount() {
+    return gameCount;
+}
+
+bool GameArchiveReader::loadBlock(uint64_t blockIndex) {
+
+    if (static_cast<int64_t>(blockIndex) == loadedBlock) return true;
+
+    loadedBlock = -1;
+    if (!inflateBlock(blockIndex, block)) return false;
+
+    loadedBlock = static_cast<int64_t>(blockIndex);
+    return true;
+
+}
+
+bool GameArchiveReader::inflateBlock(uint64_t blockIndex, std::vector<uint8_t>& out) {
+
+    const uint8_t* entry = indexData + blockIndex * ARCHIVE_INDEX_ENTRY_SIZE;
+    uint64_t blockOffset = readU64(entry);
+    uint32_t compressedSize = readU32(entry + 8);
+    uint32_t rawSize = readU32(entry + 12);
+
+    const uint8_t* source = reinterpret_cast<const uint8_t*>(file.getData()) + blockOffset;
+    if (blockOffset + compressedSize > static_cast<uint64_t>(indexData - reinterpret_cast<const uint8_t*>(file.getData()))) return false;
+
+    out.resize(rawSize);
+    if (compressedSize == rawSize) {
+        memcpy(out.data(), source, rawSize);
+        return true;
+    }
+
+    uLongf size = rawSize;
+    return uncompress(out.data(), &size, source, compressedSize) == Z_OK && size == rawSize;
+
+}
+
+bool GameArchiveReader::readGame(uint64_t gameNumber, ArchivedGame& game) {
+
+    if (gameNumber >= gameCount) return false;
+
+    // Binary search for the block holding the game
+    uint64_t low = 0, high = blockCount;
+    while (high - low > 1) {
+        uint64_t middle = (low + high) / 2;
+        if (readU64(indexData + middle * ARCHIVE_INDEX_ENTRY_SIZE + 16) <= gameNumber) low = middle;
+        else high = middle;
+    }
+
+    if (!loadBlock(low)) return false;
+
+    // Skip over the earlier records in the block without replaying them
+    const uint8_t* p = block.data();
+    const uint8_t* end = p + block.size();
+    for (uint64_t i = readU64(indexData + low * ARCHIVE_INDEX_ENTRY_SIZE + 16); i < gameNumber; i++) {
+        if (!GameCodec::skip(p, end)) return false;
+    }
+
+    return codec.decode(p, end, game);
+
+}
+
+uint64_t GameArchiveReader::forEachGame(const std::function<void(const ArchivedGame&)>& callback) {
+
+    ArchivedGame game;
+    uint64_t decoded = 0;
+
+    for (uint64_t i = 0; i < blockCount; i++) {
+
+        if (!loadBlock(i)) break;
+
+        const uint8_t* p = block.data();
+        const uint8_t* end = p + block.size();
+        while (p != end) {
+            if (!codec.decode(p, end, game)) return decoded;
+            callback(game);
+            decoded++;
+        }
+    }
+
+    return decoded;
+
+}
+
+uint64_t GameArchiveReader::run(const std::function<void(const ArchivedGame&, int)>& callback, int threadCount) {
+
+    if (threadCount <= 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    std::atomic<uint64_t> nextBlock{0};
+    std::atomic<uint64_t> decoded{0};
+
+    auto worker = [&](int index) {
+
+        GameCodec localCodec;
+        std::vector<uint8_t> localBlock;
+        ArchivedGame game;
+        uint64_t localDecoded = 0;
+
+        for (uint64_t i = nextBlock++; i < blockCount; i = nextBlock++) {
+
+            if (!inflateBlock(i, localBlock)) continue;
+
+            const uint8_t* p = localBlock.data();
+            const uint8_t* end = p + localBlock.size();
+            while (p != end && localCodec.decode(p, end, game)) {
+                callback(game, index);
+                localDecoded++;
+            }
+        }
+
+        decoded += localDecoded;
+
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threadCount; i++) workers.emplace_back(worker, i);
+    for (std::thread& thread : workers) thread.join();
+
+    return decoded;
+
+}
+
+#endif // GAMEARCHIVE_HPP
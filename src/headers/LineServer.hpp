@@ -0,0 +1,272 @@
+#ifndef LINESERVER_HPP
+#define LINESERVER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Line protocol server on a Unix domain socket, shared by the analysis service and the validation server.
+// Every client gets a reader thread which hands each complete line it receives to the handler; the handler
+// answers on the spot or queues the request for its own workers, which answer later with send().
+//
+// A request taken on for later is counted with addPending() and released with answered(). A client that
+// has only finished writing is kept open until every one of its requests has been answered.
+
+const size_t LINE_SERVER_BUFFER = 16384;
+
+struct LineConnection {
+    int fd;
+    std::mutex writeMutex;
+    std::atomic<bool> open{true};
+    std::atomic<bool> finished{false};      // its reader has returned
+
+    // Requests taken on and not yet answered, under writeMutex
+    int pending = 0;
+    std::condition_variable answered;
+};
+
+// Receives one line, without its newline, and the time it arrived
+typedef std::function<void(const std::shared_ptr<LineConnection>&, const char*, size_t,
+                           std::chrono::steady_clock::time_point)> LineHandler;
+
+class LineServer {
+
+    private:
+        struct Reader {
+            std::shared_ptr<LineConnection> connection;
+            std::thread thread;
+        };
+
+        LineHandler handler;
+        size_t maxLine;
+        std::string tooLongAnswer;
+        int listenFd;
+        std::string socketPath;
+
+        std::atomic<bool> stopping;
+
+        std::vector<Reader> readers;
+        std::mutex connectionsMutex;
+        std::vector<std::shared_ptr<LineConnection>> connections;
+
+        void read(std::shared_ptr<LineConnection> connection);
+
+    public:
+        // A client whose unfinished line grows past maxLine is sent tooLongAnswer and dropped
+        LineServer(LineHandler lineHandler, size_t maxLineLength, const std::string& tooLong);
+        ~LineServer();
+
+        // Creates the socket, replacing a stale one left at the path
+        bool listen(const std::string& path);
+
+        // Accepts clients until stop() is called
+        void serve();
+
+        // Closes every connection, waits for the readers and removes the socket. Workers that may still
+        // answer should be stopped first.
+        void close();
+
+        // Safe from any thread and from a signal handler
+        void stop();
+
+        bool isStopping() { return stopping; }
+        size_t getClientCount();
+
+        static void send(LineConnection& connection, const std::string& line);
+        static void addPending(LineConnection& connection);
+        static void answered(LineConnection& connection);
+
+        // Copy constructor and copy assignment operators should not be allowed
+        LineServer(const LineServer&) = delete;
+        LineServer& operator=(const LineServer&) = delete;
+
+};
+
+LineServer::LineServer(LineHandler lineHandler, size_t maxLineLength, const std::string& tooLong)
+    : handler(lineHandler), maxLine(maxLineLength), tooLongAnswer(tooLong), listenFd(-1), stopping(false) {}
+
+LineServer::~LineServer() {
+    stop();
+    close();
+}
+
+bool LineServer::listen(const std::string& path) {
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path too long: " << path << std::endl;
+        return false;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        std::cerr << "Unable to create a socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    unlink(path.c_str());
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(listenFd, 64) < 0) {
+        std::cerr << "Unable to listen on " << path << ": " << strerror(errno) << std::endl;
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    socketPath = path;
+    return true;
+
+}
+
+void LineServer::stop() {
+    stopping = true;
+}
+
+void LineServer::serve() {
+
+    // Accepting wakes up every so often to notice stop(), which may come from a signal handler
+    pollfd listening = {listenFd, POLLIN, 0};
+    while (!stopping) {
+        int ready = poll(&listening, 1, 200);
+
+        // Readers of clients that have gone are joined here, so that a long run does not pile them up
+        for (size_t i = 0; i < readers.size();) {
+            if (!readers[i].connection->finished) {
+                i++;
+                continue;
+            }
+            readers[i].thread.join();
+            readers.erase(readers.begin() + i);
+        }
+
+        if (ready <= 0 || !(listening.revents & POLLIN)) continue;
+
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) continue;
+
+        std::shared_ptr<LineConnection> connection(new LineConnection());
+        connection->fd = fd;
+        {
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            connections.push_back(connection);
+        }
+        readers.push_back({connection, std::thread(&LineServer::read, this, connection)});
+    }
+
+}
+
+void LineServer::close() {
+
+    // Wake the readers, both on their sockets and waiting for answers
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        for (const std::shared_ptr<LineConnection>& connection : connections) {
+            std::lock_guard<std::mutex> writeLock(connection->writeMutex);
+            shutdown(connection->fd, SHUT_RDWR);
+            connection->answered.notify_all();
+        }
+    }
+    for (Reader& reader : readers) reader.thread.join();
+    readers.clear();
+
+    if (listenFd < 0) return;
+    ::close(listenFd);
+    listenFd = -1;
+    unlink(socketPath.c_str());
+
+}
+
+size_t LineServer::getClientCount() {
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    return connections.size();
+}
+
+void LineServer::read(std::shared_ptr<LineConnection> connection) {
+
+    std::string pending;
+    char buffer[LINE_SERVER_BUFFER];
+
+    bool hungUp = false;
+    while (!stopping) {
+        ssize_t length = recv(connection->fd, buffer, sizeof(buffer), 0);
+        hungUp = length == 0;
+        if (length <= 0) break;
+        auto received = std::chrono::steady_clock::now();
+
+        pending.append(buffer, length);
+        size_t start = 0, end;
+        while ((end = pending.find('\n', start)) != std::string::npos) {
+            handler(connection, pending.data() + start, end - start, received);
+            start = end + 1;
+        }
+        pending.erase(0, start);
+
+        if (pending.size() > maxLine) {
+            send(*connection, tooLongAnswer);
+            break;
+        }
+    }
+
+    // A client that has only finished writing still gets its answers. Otherwise the requests still queued
+    // for it are dropped by the workers, which see it is no longer open.
+    std::unique_lock<std::mutex> lock(connection->writeMutex);
+    if (hungUp) connection->answered.wait(lock, [&]() { return stopping || !connection->open || connection->pending == 0; });
+    connection->open = false;
+    lock.unlock();
+
+    {
+        std::lock_guard<std::mutex> connectionsLock(connectionsMutex);
+        connections.erase(std::remove(connections.begin(), connections.end(), connection), connections.end());
+    }
+    lock.lock();
+    ::close(connection->fd);
+    connection->fd = -1;
+    connection->finished = true;
+
+}
+
+void LineServer::send(LineConnection& connection, const std::string& line) {
+
+    std::lock_guard<std::mutex> lock(connection.writeMutex);
+    if (connection.fd < 0) return;
+
+    std::string data = line + "\n";
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t length = ::send(connection.fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+        if (length <= 0) {
+            connection.open = false;
+            return;
+        }
+        written += length;
+    }
+
+}
+
+void LineServer::addPending(LineConnection& connection) {
+    std::lock_guard<std::mutex> lock(connection.writeMutex);
+    connection.pending++;
+}
+
+void LineServer::answered(LineConnection& connection) {
+    std::lock_guard<std::mutex> lock(connection.writeMutex);
+    connection.pending--;
+    connection.answered.notify_all();
+}
+
+#endif // LINESERVER_HPP
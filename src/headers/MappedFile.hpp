@@ -0,0 +1,168 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file.
+// Pages are brought in by the OS as they are touched, so opening is constant time regardless of file size.
+class MappedFile {
+
+    private:
+        const char* data;
+        size_t size;
+        bool opened;
+
+#ifdef _WIN32
+        HANDLE fileHandle;
+        HANDLE mappingHandle;
+#endif
+
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        bool open(const std::string& path);
+        void close();
+
+        // Hint that the mapping will be read front to back (larger read-ahead)
+        void adviseSequential();
+
+        // Hint that the mapping will be read in scattered places, so only the pages touched are read in
+        void adviseRandom();
+
+        bool isOpen();
+        const char* getData();
+        size_t getSize();
+
+        // Copy constructor and copy assignment operators should not be allowed
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+};
+
+MappedFile::MappedFile() : data(nullptr), size(0), opened(false) {
+#ifdef _WIN32
+    fileHandle = INVALID_HANDLE_VALUE;
+    mappingHandle = NULL;
+#endif
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path) {
+
+    close();
+
+#ifdef _WIN32
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        std::cerr << "Unable to open " << path << std::endl;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(fileHandle, &fileSize);
+    size = static_cast<size_t>(fileSize.QuadPart);
+
+    // Empty files cannot be mapped, but are still valid (and empty) inputs
+    if (size == 0) {
+        opened = true;
+        return true;
+    }
+
+    mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mappingHandle != NULL) data = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Unable to open " << path << std::endl;
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) < 0) {
+        ::close(fd);
+        std::cerr << "Unable to stat " << path << std::endl;
+        return false;
+    }
+    size = static_cast<size_t>(fileStat.st_size);
+
+    // Empty files cannot be mapped, but are still valid (and empty) inputs
+    if (size == 0) {
+        ::close(fd);
+        opened = true;
+        return true;
+    }
+
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping != MAP_FAILED) data = static_cast<const char*>(mapping);
+#endif
+
+    if (data == nullptr) {
+        std::cerr << "Unable to map " << path << std::endl;
+        close();
+        return false;
+    }
+
+    opened = true;
+    return true;
+
+}
+
+void MappedFile::close() {
+
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+    if (mappingHandle != NULL) CloseHandle(mappingHandle);
+    if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+    mappingHandle = NULL;
+    fileHandle = INVALID_HANDLE_VALUE;
+#else
+    if (data) munmap(const_cast<char*>(data), size);
+#endif
+
+    data = nullptr;
+    size = 0;
+    opened = false;
+
+}
+
+void MappedFile::adviseSequential() {
+#ifndef _WIN32
+    if (data) madvise(const_cast<char*>(data), size, MADV_SEQUENTIAL);
+#endif
+}
+
+void MappedFile::adviseRandom() {
+#ifndef _WIN32
+    if (data) madvise(const_cast<char*>(data), size, MADV_RANDOM);
+#endif
+}
+
+bool MappedFile::isOpen() {
+    return opened;
+}
+
+const char* MappedFile::getData() {
+    return data;
+}
+
+size_t MappedFile::getSize() {
+    return size;
+}
+
+#endif // MAPPEDFILE_HPP
@@ -0,0 +1,17 @@
+#ifndef MOVE_HPP
+#define MOVE_HPP
+
+#include <PieceType.hpp>
+
+struct Move {
+    PieceType piece;
+    int fromPos;
+    int toPos;
+    PieceType promotion;        // EMPTY unless a pawn reaches the last rank
+};
+
+bool operator== (const Move& a, const Move& b) {
+    return a.piece == b.piece && a.fromPos == b.fromPos && a.toPos == b.toPos && a.promotion == b.promotion;
+}
+
+#endif // MOVE_HPP
@@ -0,0 +1,43 @@
+#ifndef MOVEEVENTS_HPP
+#define MOVEEVENTS_HPP
+
+#include <Move.hpp>
+#include <PieceType.hpp>
+#include <deque>
+
+// Things that happen in a game which the front end reacts to (sounds, for now). The board itself knows
+// nothing about them: the game loop queues them as it plays moves and drains the queue once per frame.
+enum class MoveEventType {
+    GAME_START, MOVE, CAPTURE, CHECK, CHECKMATE, STALEMATE
+};
+
+struct MoveEvent {
+    MoveEventType type;
+    Move move;              // the move that caused it, empty for GAME_START
+};
+
+class MoveEventQueue {
+
+    private:
+        std::deque<MoveEvent> events;
+
+    public:
+        void push(MoveEventType type, const Move& move = {PieceType::EMPTY, 0, 0, PieceType::EMPTY});
+
+        // Oldest event not yet handled, false once the queue is empty
+        bool pop(MoveEvent& event);
+
+};
+
+void MoveEventQueue::push(MoveEventType type, const Move& move) {
+    events.push_back({type, move});
+}
+
+bool MoveEventQueue::pop(MoveEvent& event) {
+    if (events.empty()) return false;
+    event = events.front();
+    events.pop_front();
+    return true;
+}
+
+#endif // MOVEEVENTS_HPP
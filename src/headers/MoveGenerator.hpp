@@ -4,31 +4,29 @@
 #include <unordered_map>
 #include <PieceType.hpp>
 #include <Board.hpp>
+#include <Attacks.hpp>
 #include <BitOperations.hpp>
+#include <Move.hpp>
 #include <utility>
 #include <vector>
 
-// Constants to assist with preventing generating moves that 'wrap' around the board
-const U64 RANK_8 = 0xFF00000000000000;
-const U64 RANK_7 = 0x00FF000000000000;
-const U64 RANK_2 = 0x000000000000FF00;
-const U64 RANK_1 = 0x00000000000000FF;
-
-const U64 FILE_A = 0x0101010101010101;
-const U64 FILE_B = 0x0202020202020200;
-const U64 FILE_G = 0x4040404040404040;
-const U64 FILE_H = 0x8080808080808080;
-
 class MoveGenerator{
 
     private:
         Board& chessBoard;
         U64 whitePieces, blackPieces;
-        
-        // // Use a cache to prevent multiple recalculations of the same attacks upon each move
-        // U64 moveCache;
-        // U64 attackCache;
-        // bool cacheUpToDate = false;
+
+        // What the legality checks need to know about the current position, worked out at most once per
+        // position (the board's version) and shared by every query until the board changes
+        struct AttackInfo {
+            uint64_t version;           // of the board it was worked out for, 0 for none yet
+            U64 attacks[2];             // every square each side attacks, black then white
+            U64 kingDanger;             // opponent's attacks with the side to move's king off the board
+            U64 checkers;               // opponent pieces giving check to the side to move
+            U64 pinned;                 // side to move's pieces pinned to their king
+        };
+        AttackInfo attackInfo;
+        const AttackInfo& getAttackInfo();
 
         // Move Generation
         // Returned BitBoard will include all possible locations that piece can be moved to.
@@ -41,6 +39,7 @@ class MoveGenerator{
 
         U64 generatePieceMovesOrAttacks (PieceType pieceType, int position, bool attack);
         U64 generateAllMovesOrAttacks (bool isWhite, bool attack, Board& board);
+        U64 generatePieceCandidateMoves (PieceType pieceType, int position);
 
         // includeblocker  -> return squares the piece can attack
         // !includeblocker -> return only the valid move squares
@@ -50,6 +49,8 @@ class MoveGenerator{
         U64 generateLineOfAttack(int checkingPiecePosition, int kingPosition);
         void updatePieces(Board& board);
         bool isKingInCheck (bool isWhite, Board& currentBoard);
+        bool isMoveSafe (PieceType pieceType, int fromPos, int toPos);
+        void generateMoveList (std::vector<Move>& moves, bool legalOnly);
 
     public:
         MoveGenerator(Board& board);
@@ -57,6 +58,28 @@ class MoveGenerator{
         void updatePieces();
         bool isKingInCheck (bool isWhite);
         U64 generatePieceValidMoves (PieceType pieceType, int position);
+
+        // Checks a single move without generating every destination of the piece
+        bool isLegalMove (PieceType pieceType, int fromPos, int toPos);
+
+        // Every square the given side attacks. Pawns only count where they could capture something.
+        U64 generateAttacks (bool isWhite);
+
+        // The squares a single piece attacks, walking its rays square by square rather than with the
+        // set-wise fills generateAttacks uses, which makes it a reference to check those against
+        U64 generatePieceAttacks (PieceType pieceType, int position);
+
+        // Whether the side to move has any legal move, stopping at the first one found. Cheaper than
+        // generating them all when only mate and stalemate are of interest.
+        bool hasLegalMove ();
+
+        // All legal moves for the side to move. The order is fixed (piece type, then from square,
+        // then to square, then promotion piece Q/R/B/N) so a move's index in the list is reproducible.
+        void generateLegalMoves (std::vector<Move>& moves);
+
+        // Same order as above, but without the (expensive) check for leaving the king in check
+        void generatePseudoLegalMoves (std::vector<Move>& moves);
+        U64 generatePiecePseudoLegalMoves (PieceType pieceType, int position);
         
 };
 
@@ -64,48 +87,217 @@ U64 MoveGenerator::generatePieceValidMoves(PieceType pieceType, int position) {
 
     updatePieces();
 
-    // Determine is the king is currently in check
     U64 validMoves = 0;
-    U64 isWhite = pieceTypeToString(pieceType)[0] == 'W';
-    U64 opponentPieces = isWhite ? blackPieces : whitePieces;
-    bool kingInCheck = isKingInCheck(isWhite);
 
     // Generate all the currently possible moves
+    U64 possibleMovesAndAttacks = generatePieceCandidateMoves(pieceType, position);
+
+    // Iterate through all possible moves, and check whether the move leaves the king in check.
+    // This includes king moves while in check, since the attack map of the current board does
+    // not cover squares behind the king on the checking piece's line.
+    while (possibleMovesAndAttacks) {
+
+        // Find LSB and clear
+        int toPos = findLSBIndex(possibleMovesAndAttacks);
+        possibleMovesAndAttacks &= ~(1ULL << toPos);
+
+        if (isMoveSafe(pieceType, position, toPos)) validMoves |= (1ULL << toPos);
+
+    }
+
+    return validMoves;
+
+}
+
+bool MoveGenerator::isLegalMove (PieceType pieceType, int fromPos, int toPos) {
+
+    if (!(chessBoard.getBitboard(pieceType) & (1ULL << fromPos))) return false;
+
+    updatePieces();
+    if (!(generatePieceCandidateMoves(pieceType, fromPos) & (1ULL << toPos))) return false;
+
+    return isMoveSafe(pieceType, fromPos, toPos);
+
+}
+
+U64 MoveGenerator::generateAttacks (bool isWhite) {
+    updatePieces();
+    return generateAllMovesOrAttacks(isWhite, true, chessBoard);
+}
+
+U64 MoveGenerator::generatePieceAttacks (PieceType pieceType, int position) {
+    updatePieces();
+    return generatePieceMovesOrAttacks(pieceType, position, true);
+}
+
+bool MoveGenerator::hasLegalMove () {
+
+    updatePieces();
+    bool isWhite = chessBoard.isWhiteToMove();
+    int firstType = static_cast<int>(isWhite ? PieceType::WP : PieceType::BP);
+
+    // King first: in check, it is the piece most likely to have a way out
+    for (int t = firstType + 5; t >= firstType; t--) {
+
+        PieceType type = static_cast<PieceType>(t);
+        for (U64 pieces = chessBoard.getBitboard(type); pieces; pieces &= pieces - 1) {
+            int fromPos = findLSBIndex(pieces);
+
+            for (U64 destinations = generatePieceCandidateMoves(type, fromPos); destinations; destinations &= destinations - 1) {
+                if (isMoveSafe(type, fromPos, findLSBIndex(destinations))) return true;
+            }
+        }
+    }
+
+    return false;
+
+}
+
+void MoveGenerator::generateLegalMoves (std::vector<Move>& moves) {
+    generateMoveList(moves, true);
+}
+
+void MoveGenerator::generatePseudoLegalMoves (std::vector<Move>& moves) {
+    generateMoveList(moves, false);
+}
+
+U64 MoveGenerator::generatePiecePseudoLegalMoves (PieceType pieceType, int position) {
+    updatePieces();
+    return generatePieceCandidateMoves(pieceType, position);
+}
+
+void MoveGenerator::generateMoveList (std::vector<Move>& moves, bool legalOnly) {
+
+    moves.clear();
+    updatePieces();
+
+    bool isWhite = chessBoard.isWhiteToMove();
+    int firstType = static_cast<int>(isWhite ? PieceType::WP : PieceType::BP);
+
+    const PieceType promotions[] = {
+        isWhite ? PieceType::WQ : PieceType::BQ,
+        isWhite ? PieceType::WR : PieceType::BR,
+        isWhite ? PieceType::WB : PieceType::BB,
+        isWhite ? PieceType::WN : PieceType::BN
+    };
+
+    // Piece types are visited in enum order rather than map order, as the map order is unspecified
+    for (int t = firstType; t < firstType + 6; t++) {
+
+        PieceType type = static_cast<PieceType>(t);
+        bool isPawn = type == PieceType::WP || type == PieceType::BP;
+        U64 pieces = chessBoard.getBitboard(type);
+
+        while (pieces) {
+            int fromPos = findLSBIndex(pieces);
+            pieces &= pieces - 1;
+
+            U64 destinations = legalOnly ? generatePieceValidMoves(type, fromPos) : generatePieceCandidateMoves(type, fromPos);
+            while (destinations) {
+                int toPos = findLSBIndex(destinations);
+                destinations &= destinations - 1;
+
+                if (isPawn && (toPos >= 56 || toPos < 8)) {
+                    for (PieceType promotion : promotions) moves.push_back({type, fromPos, toPos, promotion});
+                } else {
+                    moves.push_back({type, fromPos, toPos, PieceType::EMPTY});
+                }
+            }
+        }
+    }
+
+}
+
+// Pseudo-legal destinations of a single piece, including en passant and castling
+U64 MoveGenerator::generatePieceCandidateMoves (PieceType pieceType, int position) {
+
+    bool isWhite = isWhitePiece(pieceType);
+    U64 opponentPieces = isWhite ? blackPieces : whitePieces;
+
     U64 possibleMoves = generatePieceMovesOrAttacks(pieceType, position, false);
-    U64 possibleMovesAndAttacks = (generatePieceMovesOrAttacks(pieceType, position, true) & opponentPieces) | possibleMoves;
+    U64 candidates = (generatePieceMovesOrAttacks(pieceType, position, true) & opponentPieces) | possibleMoves;
+
+    // En passant, the target square is empty so it is not picked up by the pawn captures above
+    int enPassantSquare = chessBoard.getEnPassantSquare();
+    if ((pieceType == PieceType::WP || pieceType == PieceType::BP) && enPassantSquare != -1) {
+        int rankDiff = enPassantSquare / 8 - position / 8;
+        int fileDiff = enPassantSquare % 8 - position % 8;
+        if ((fileDiff == 1 || fileDiff == -1) && rankDiff == (isWhite ? 1 : -1)) candidates |= 1ULL << enPassantSquare;
+    }
 
-    // King Specific Logic
+    // Castling, through empty squares with the rook still in its corner.
+    // Not castling out of or through check is left to isMoveSafe.
     if (pieceType == PieceType::WK || pieceType == PieceType::BK) {
-        if(kingInCheck) {
-            U64 opponentAttacks = generateAllMovesOrAttacks(!isWhite, true, this->chessBoard);
-            return possibleMovesAndAttacks & ~opponentAttacks;
+
+        int home = isWhite ? 4 : 60;
+        int rights = chessBoard.getCastlingRights() & (isWhite ? (CASTLE_WK | CASTLE_WQ) : (CASTLE_BK | CASTLE_BQ));
+
+        if (position == home && rights) {
+
+            U64 occupied = whitePieces | blackPieces;
+            U64 rooks = chessBoard.getBitboard(isWhite ? PieceType::WR : PieceType::BR);
+
+            // King side: f and g files empty, h file rook
+            if ((rights & (CASTLE_WK | CASTLE_BK)) && (rooks & (1ULL << (home + 3))) && !(occupied & (3ULL << (home + 1)))) {
+                candidates |= 1ULL << (home + 2);
+            }
+
+            // Queen side: b, c and d files empty, a file rook
+            if ((rights & (CASTLE_WQ | CASTLE_BQ)) && (rooks & (1ULL << (home - 4))) && !(occupied & (7ULL << (home - 3)))) {
+                candidates |= 1ULL << (home - 2);
+            }
         }
     }
 
-    // Iterate through all possible moves, and check whether the move leaves the king in check. 
-    while (possibleMovesAndAttacks) {
+    return candidates;
 
-        // Find LSB and clear
-        int toPos = findLSBIndex(possibleMovesAndAttacks);
-        possibleMovesAndAttacks &= ~(1ULL << toPos);
+}
 
-        U64 oldWhitePieces = whitePieces;
-        U64 oldBlackPieces = blackPieces;
+// Check that the move does not leave the own king in check
+bool MoveGenerator::isMoveSafe (PieceType pieceType, int fromPos, int toPos) {
+
+    bool isWhite = isWhitePiece(pieceType);
+    bool isKing = pieceType == PieceType::WK || pieceType == PieceType::BK;
+    bool isCastling = isKing && (toPos - fromPos == 2 || fromPos - toPos == 2);
+    bool isEnPassant = (pieceType == PieceType::WP || pieceType == PieceType::BP) && toPos == chessBoard.getEnPassantSquare()
+                       && (toPos - fromPos) % 8 != 0;
+
+    // For the side to move, the position's attacks, checkers and pins settle most moves. A king may go
+    // anywhere the opponent does not attack, and castle when not in check or passing an attacked square.
+    // Any other piece is free to move when there is no check and it is not pinned, except for en passant,
+    // which takes two pieces off the same rank.
+    if (isWhite == chessBoard.isWhiteToMove()) {
+        const AttackInfo& info = getAttackInfo();
+        if (isKing) {
+            if (isCastling && (info.checkers || (info.kingDanger & (1ULL << ((fromPos + toPos) / 2))))) return false;
+            return !(info.kingDanger & (1ULL << toPos));
+        }
+        if (!info.checkers && !(info.pinned & (1ULL << fromPos)) && !isEnPassant) return true;
+    }
 
-        // Simulate the move being executed
-        Board tempBoard = chessBoard;
-        tempBoard.simulateExecuteMove(pieceType, position, toPos);
-        updatePieces(tempBoard);
-        
-        if (!isKingInCheck(isWhite, tempBoard)) validMoves |= (1ULL << toPos);
-        
-        // Reset move execution
-        whitePieces = oldWhitePieces;
-        blackPieces = oldBlackPieces;
+    // Castling is also illegal out of check, or through the square the rook lands on
+    else if (isCastling) {
+        if (isKingInCheck(isWhite) || !isMoveSafe(pieceType, fromPos, (fromPos + toPos) / 2)) return false;
+    }
+
+    // Play the move on the bare bitboards and look at the opponent's attacks on the king, every piece type
+    // set-wise. The king cannot shelter behind itself on a slider's line, and a taken piece attacks nothing.
+    U64 pieces[12];
+    for (int type = 0; type < 12; type++) pieces[type] = chessBoard.getBitboard(static_cast<PieceType>(type)) & ~(1ULL << toPos);
+    pieces[static_cast<int>(pieceType)] ^= (1ULL << fromPos) | (1ULL << toPos);
 
+    // En passant takes the pawn behind the target square, and castling moves the rook
+    if (isEnPassant) {
+        pieces[static_cast<int>(isWhite ? PieceType::BP : PieceType::WP)] &= ~(1ULL << (isWhite ? toPos - 8 : toPos + 8));
+    }
+    if (isCastling) {
+        int rookFrom = toPos > fromPos ? fromPos + 3 : fromPos - 4;
+        pieces[static_cast<int>(isWhite ? PieceType::WR : PieceType::BR)] ^= (1ULL << rookFrom) | (1ULL << ((fromPos + toPos) / 2));
     }
 
-    return validMoves;
+    U64 pawnAttacks, pieceAttacks;
+    sideAttacks(pieces, !isWhite, pawnAttacks, pieceAttacks);
+    return !((pawnAttacks | pieceAttacks) & pieces[static_cast<int>(isWhite ? PieceType::WK : PieceType::BK)]);
 
 }
 
@@ -183,12 +375,10 @@ U64 MoveGenerator::generateLineOfAttack(int checkingPiecePosition, int kingPosit
 std::vector<pair<PieceType, int>> MoveGenerator::findCheckingPieces(bool isWhite, Board& board) {
 
     std::vector<pair<PieceType, int>> checkingPieces;
-    U64 kingBoard = isWhite ? board.getCurrentBoard()[PieceType::WK] : board.getCurrentBoard()[PieceType::BK];
-
-    char sign = isWhite ? 'W' : 'B';
+    U64 kingBoard = isWhite ? board.getBitboard(PieceType::WK) : board.getBitboard(PieceType::BK);
 
     for (const auto& [type, bitboard] : board.getCurrentBoard()) {
-        if (pieceTypeToString(type)[0] == sign) continue;
+        if (isWhitePiece(type) == isWhite) continue;
 
         U64 allPieces = bitboard;
 
@@ -211,12 +401,25 @@ std::vector<pair<PieceType, int>> MoveGenerator::findCheckingPieces(bool isWhite
 
 U64 MoveGenerator::generateAllMovesOrAttacks (bool isWhite, bool attack, Board& board) {
 
+    // Attacks are found for every piece of a type at once. Pawns count only where they could capture,
+    // as in generatePawnMoves.
+    if (attack) {
+        U64 pieces[12], opponentPieces = 0;
+        for (int type = 0; type < 12; type++) {
+            pieces[type] = board.getBitboard(static_cast<PieceType>(type));
+            if (isWhitePiece(static_cast<PieceType>(type)) != isWhite) opponentPieces |= pieces[type];
+        }
+
+        U64 pawnAttacks, pieceAttacks;
+        sideAttacks(pieces, isWhite, pawnAttacks, pieceAttacks);
+        return pieceAttacks | (pawnAttacks & opponentPieces);
+    }
+
     U64 moves = 0;
-    char sign = isWhite ? 'W' : 'B';
 
     // Iterate through every board
     for (const auto& [type, bitboard] : board.getCurrentBoard()) {
-        if (pieceTypeToString(type)[0] != sign) continue;
+        if (isWhitePiece(type) != isWhite) continue;
         
         U64 allPieces = bitboard;
         
@@ -282,14 +485,75 @@ bool MoveGenerator::isKingInCheck (bool isWhite, Board& currentBoard){
 
     // Obtain all the possible attacks from the opposition
     U64 opponentAttacks = generateAllMovesOrAttacks(!isWhite, true, currentBoard);
-    U64 kingBoard = isWhite ? currentBoard.getCurrentBoard()[PieceType::WK] : currentBoard.getCurrentBoard()[PieceType::BK];
+    U64 kingBoard = isWhite ? currentBoard.getBitboard(PieceType::WK) : currentBoard.getBitboard(PieceType::BK);
 
     return opponentAttacks & kingBoard;
 }
 
-// Default implementation of above function (for current board)
+// Default implementation of above function (for current board), from the position's cached attacks
 bool MoveGenerator::isKingInCheck (bool isWhite) {
-    return isKingInCheck (isWhite, this->chessBoard);
+    U64 king = chessBoard.getBitboard(isWhite ? PieceType::WK : PieceType::BK);
+    return getAttackInfo().attacks[isWhite ? 0 : 1] & king;
+}
+
+const MoveGenerator::AttackInfo& MoveGenerator::getAttackInfo () {
+
+    if (attackInfo.version == chessBoard.getVersion()) return attackInfo;
+    attackInfo.version = chessBoard.getVersion();
+
+    U64 pieces[12], occupied = 0;
+    for (int type = 0; type < 12; type++) {
+        pieces[type] = chessBoard.getBitboard(static_cast<PieceType>(type));
+        occupied |= pieces[type];
+    }
+
+    U64 pawnAttacks, pieceAttacks;
+    for (int side = 0; side < 2; side++) {
+        sideAttacks(pieces, side == 1, pawnAttacks, pieceAttacks);
+        attackInfo.attacks[side] = pawnAttacks | pieceAttacks;
+    }
+
+    bool isWhite = chessBoard.isWhiteToMove();
+    int own = isWhite ? 6 : 0, enemy = isWhite ? 0 : 6;
+    U64 king = pieces[own + 5];
+    U64 ownPieces = 0;
+    for (int type = own; type < own + 6; type++) ownPieces |= pieces[type];
+
+    // The king cannot shelter behind itself on a slider's line
+    pieces[own + 5] = 0;
+    sideAttacks(pieces, !isWhite, pawnAttacks, pieceAttacks);
+    attackInfo.kingDanger = pawnAttacks | pieceAttacks;
+    pieces[own + 5] = king;
+
+    // Checkers, looking out from the king as each kind of piece
+    U64 empty = ~occupied;
+    U64 orthogonal = pieces[enemy + 1] | pieces[enemy + 4];
+    U64 diagonal = pieces[enemy + 2] | pieces[enemy + 4];
+    attackInfo.checkers = (pawnAttacksOf(king, isWhite) & pieces[enemy]) | (knightAttacksOf(king) & pieces[enemy + 3])
+                        | (orthogonalAttacks(king, empty) & orthogonal) | (diagonalAttacks(king, empty) & diagonal);
+
+    // Pins, along each ray from the king: an own piece first and an enemy slider of the ray's kind behind it
+    U64 pinned = 0;
+    auto pinLeft = [&](int shift, U64 mask, U64 sliders) {
+        U64 blocker = fillLeft(king, empty, shift, mask) & ownPieces;
+        if (blocker && (fillLeft(king, empty | blocker, shift, mask) & sliders)) pinned |= blocker;
+    };
+    auto pinRight = [&](int shift, U64 mask, U64 sliders) {
+        U64 blocker = fillRight(king, empty, shift, mask) & ownPieces;
+        if (blocker && (fillRight(king, empty | blocker, shift, mask) & sliders)) pinned |= blocker;
+    };
+    pinLeft(8, ~0ULL, orthogonal);
+    pinRight(8, ~0ULL, orthogonal);
+    pinLeft(1, ~FILE_A, orthogonal);
+    pinRight(1, ~FILE_H, orthogonal);
+    pinLeft(9, ~FILE_A, diagonal);
+    pinLeft(7, ~FILE_H, diagonal);
+    pinRight(7, ~FILE_A, diagonal);
+    pinRight(9, ~FILE_H, diagonal);
+    attackInfo.pinned = pinned;
+
+    return attackInfo;
+
 }
 
 // Check where this has been implemented for future.... calling each time is def not efficient.  
@@ -300,9 +564,7 @@ void MoveGenerator::updatePieces() {
 
     // Iterate through every board and append to whitePieces or blackPieces
     for(const auto& [type, bitboard] : chessBoard.getCurrentBoard()) {
-        char colour = pieceTypeToString(type)[0];
-
-        if (colour == 'W') whitePieces |= bitboard;
+        if (isWhitePiece(type)) whitePieces |= bitboard;
         else blackPieces |= bitboard;
     }
 
@@ -315,9 +577,7 @@ void MoveGenerator::updatePieces(Board& board) {
 
     // Iterate through every board and append to whitePieces or blackPieces
     for(const auto& [type, bitboard] : board.getCurrentBoard()) {
-        char colour = pieceTypeToString(type)[0];
-
-        if (colour == 'W') whitePieces |= bitboard;
+        if (isWhitePiece(type)) whitePieces |= bitboard;
         else blackPieces |= bitboard;
     }
 
@@ -325,14 +585,14 @@ void MoveGenerator::updatePieces(Board& board) {
 
 MoveGenerator::MoveGenerator(Board& board) : chessBoard(board) {
 
+    attackInfo.version = 0;
+
     // Initialise white pieces board and black pieces board.
     U64 white = 0, black = 0;
 
     for(const auto& [type, bitb] : board.getCurrentBoard()){
 
-        char colour = pieceTypeToString(type)[0];
-
-        if(colour == 'W') white |= bitb;
+        if(isWhitePiece(type)) white |= bitb;
         else black |= bitb;
 
     }
@@ -372,10 +632,10 @@ U64 MoveGenerator::generatePawnMoves (int position, bool isWhite, bool includeBl
         U64 doublePush = singlePush ? ((currentPawn & RANK_7) >> (8 * 2)) & ~blackPieces & ~whitePieces : 0ULL;
 
         // Capture left, downwards - (only possible if not on the first file)
-        U64 captureLeft = ((currentPawn & ~FILE_A) >> 7) & ~blackPieces & whitePieces;
+        U64 captureLeft = ((currentPawn & ~FILE_A) >> 9) & ~blackPieces & whitePieces;
 
         // Capture right, downwards (only possible if not on the eigth file)
-        U64 captureRight = ((currentPawn & ~FILE_H) >> 9) & ~blackPieces & whitePieces;
+        U64 captureRight = ((currentPawn & ~FILE_H) >> 7) & ~blackPieces & whitePieces;
 
         if (includeBlocker) moves = captureLeft | captureRight;
         else moves = singlePush | doublePush;
@@ -517,11 +777,11 @@ U64 MoveGenerator::generateKingMoves (int position, bool isWhite, bool includeBl
     moves |= ((currentKing & ~RANK_8) << 8);               // Up
     moves |= ((currentKing & ~RANK_1) >> 8);               // Down
     
-    moves |= ((currentKing & ~FILE_A) << 1);               // Left
-    moves |= ((currentKing & ~FILE_H) >> 1);               // Right
+    moves |= ((currentKing & ~FILE_A) >> 1);               // Left
+    moves |= ((currentKing & ~FILE_H) << 1);               // Right
     
-    moves |= ((currentKing & ~(FILE_A | RANK_8)) << 9);   // Up Left
-    moves |= ((currentKing & ~(FILE_H | RANK_8)) << 7);   // Up Right
+    moves |= ((currentKing & ~(FILE_A | RANK_8)) << 7);   // Up Left
+    moves |= ((currentKing & ~(FILE_H | RANK_8)) << 9);   // Up Right
     
     moves |= ((currentKing & ~(FILE_A | RANK_1)) >> 9);   // Down Left
     moves |= ((currentKing & ~(FILE_H | RANK_1)) >> 7);   // Down Right
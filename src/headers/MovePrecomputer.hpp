@@ -0,0 +1,125 @@
+#ifndef MOVEPRECOMPUTER_HPP
+#define MOVEPRECOMPUTER_HPP
+
+#include <Board.hpp>
+#include <MoveGenerator.hpp>
+#include <BitOperations.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Works out the legal destinations of every piece of the side to move on a worker thread, as soon as the
+// position changes, so that picking up a piece is a table lookup rather than a move generation.
+class MovePrecomputer {
+
+    private:
+        // The worker's own copy of the board, it never touches the one being played on
+        Board board;
+        MoveGenerator moveGenerator;
+        std::thread worker;
+
+        std::mutex mutex;
+        std::condition_variable changed;
+        Position requested;
+        uint64_t requestedGeneration;       // bumped by every request
+        uint64_t readyGeneration;           // generation the table below belongs to
+        bool stopping;
+
+        // Legal destinations of the piece on each square, 0 for empty squares and the opponent's pieces
+        U64 destinations[64];
+
+        void work();
+
+    public:
+        // Starts straight away on the prototype's position
+        MovePrecomputer(Board& prototype);
+        ~MovePrecomputer();
+
+        // Starts on the board's current position, abandoning any older one still being worked on
+        void request(Board& current);
+
+        // Legal destinations of the piece on square in the last requested position, waiting for the
+        // worker if it has not got there yet
+        U64 getValidMoves(int square);
+
+        // Copy constructor and copy assignment operators should not be allowed
+        MovePrecomputer(const MovePrecomputer&) = delete;
+        MovePrecomputer& operator=(const MovePrecomputer&) = delete;
+
+};
+
+MovePrecomputer::MovePrecomputer(Board& prototype) : board(prototype), moveGenerator(board), requestedGeneration(0), readyGeneration(0), stopping(false) {
+    for (int i = 0; i < 64; i++) destinations[i] = 0;
+    worker = std::thread(&MovePrecomputer::work, this);
+    request(prototype);
+}
+
+MovePrecomputer::~MovePrecomputer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    worker.join();
+}
+
+void MovePrecomputer::request(Board& current) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        current.savePosition(requested);
+        requestedGeneration++;
+    }
+    changed.notify_all();
+}
+
+U64 MovePrecomputer::getValidMoves(int square) {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [&]() { return readyGeneration == requestedGeneration; });
+    return destinations[square];
+}
+
+void MovePrecomputer::work() {
+
+    uint64_t generation = 0;
+    U64 table[64];
+
+    while (true) {
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&]() { return stopping || requestedGeneration != generation; });
+            if (stopping) return;
+            generation = requestedGeneration;
+            board.loadPosition(requested);
+        }
+
+        for (int i = 0; i < 64; i++) table[i] = 0;
+
+        // Only the side to move's pieces, one square at a time so a newer request can cut it short
+        int first = board.isWhiteToMove() ? static_cast<int>(PieceType::WP) : static_cast<int>(PieceType::BP);
+        bool isStale = false;
+        for (int type = first; type < first + 6 && !isStale; type++) {
+            for (U64 pieces = board.getBitboard(static_cast<PieceType>(type)); pieces && !isStale; pieces &= pieces - 1) {
+                int square = findLSBIndex(pieces);
+                table[square] = moveGenerator.generatePieceValidMoves(static_cast<PieceType>(type), square);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                isStale = stopping || requestedGeneration != generation;
+            }
+        }
+
+        if (isStale) continue;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (requestedGeneration != generation) continue;
+            for (int i = 0; i < 64; i++) destinations[i] = table[i];
+            readyGeneration = generation;
+        }
+        changed.notify_all();
+    }
+
+}
+
+#endif // MOVEPRECOMPUTER_HPP
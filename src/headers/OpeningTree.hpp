@@ -0,0 +1,493 @@
+#ifndef OPENINGTREE_HPP
+#define OPENINGTREE_HPP
+
+#include <Board.hpp>
+#include <MappedFile.hpp>
+#include <Move.hpp>
+#include <PolyglotBook.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// How often a move was played from a position and how those games ended, from the point of view of
+// the side playing the move. Games without a result only count towards count.
+struct MoveStats {
+    uint32_t count;
+    uint32_t wins;
+    uint32_t draws;
+    uint32_t losses;
+};
+
+// One move of the tree, keyed by the Polyglot key of the position and the Polyglot encoding of the move
+struct TreeRecord {
+    U64 key;
+    uint16_t move;
+    MoveStats stats;
+};
+
+bool operator<(const TreeRecord& a, const TreeRecord& b) {
+    return a.key != b.key ? a.key < b.key : a.move < b.move;
+}
+
+// Opening tree files (also used for the sorted runs while building):
+//   bytes 0-7   "BBTREE01"
+//   bytes 8-15  record count (little endian)
+//   then the records sorted by key and move, 32 bytes each, little endian:
+//     key u64, move u16, reserved u16, count u32, wins u32, draws u32, losses u32, reserved u32
+const char OPENING_TREE_MAGIC[8] = {'B', 'B', 'T', 'R', 'E', 'E', '0', '1'};
+const int OPENING_TREE_HEADER_SIZE = 16;
+const int TREE_RECORD_SIZE = 32;
+
+void writeTreeRecord(const TreeRecord& record, uint8_t* out) {
+
+    for (int i = 0; i < TREE_RECORD_SIZE; i++) out[i] = 0;
+
+    const uint32_t fields[4] = {record.stats.count, record.stats.wins, record.stats.draws, record.stats.losses};
+
+    for (int i = 0; i < 8; i++) out[i] = static_cast<uint8_t>(record.key >> (8 * i));
+    out[8] = static_cast<uint8_t>(record.move);
+    out[9] = static_cast<uint8_t>(record.move >> 8);
+    for (int field = 0; field < 4; field++) {
+        for (int i = 0; i < 4; i++) out[12 + 4 * field + i] = static_cast<uint8_t>(fields[field] >> (8 * i));
+    }
+
+}
+
+void readTreeRecord(const uint8_t* in, TreeRecord& record) {
+
+    uint32_t fields[4] = {0, 0, 0, 0};
+
+    record.key = 0;
+    for (int i = 0; i < 8; i++) record.key |= static_cast<U64>(in[i]) << (8 * i);
+    record.move = static_cast<uint16_t>(in[8] | (in[9] << 8));
+    for (int field = 0; field < 4; field++) {
+        for (int i = 0; i < 4; i++) fields[field] |= static_cast<uint32_t>(in[12 + 4 * field + i]) << (8 * i);
+    }
+
+    record.stats = {fields[0], fields[1], fields[2], fields[3]};
+
+}
+
+struct OpeningTreeOptions {
+    int maxPlies = 30;                          // only the first maxPlies positions of each game are counted
+    uint32_t minCount = 2;                      // moves played fewer times are pruned from the output
+    size_t memoryBudget = 256 * 1024 * 1024;    // bytes of hash map before spilling sorted runs to disk
+    std::string tempDirectory = ".";
+    int threadCount = 1;                        // number of shards, one per worker thread
+};
+
+struct OpeningTreeStats {
+    uint64_t games;
+    uint64_t positions;
+    uint64_t runs;
+    uint64_t mergedRecords;
+    uint64_t writtenRecords;
+};
+
+// Aggregates games into position -> move -> MoveStats.
+// Every worker owns a shard (a hash map keyed by Zobrist key and move), so adding games needs no locking.
+// A shard that outgrows its share of the memory budget is sorted and spilled to disk as a run; the runs
+// are then merged externally, so memory stays bounded however many games go in.
+class OpeningTreeBuilder {
+
+    private:
+        struct TreeKey {
+            U64 key;
+            uint16_t move;
+            bool operator==(const TreeKey& other) const { return key == other.key && move == other.move; }
+        };
+
+        struct TreeKeyHash {
+            size_t operator()(const TreeKey& treeKey) const { return treeKey.key ^ (treeKey.move * 0x9E3779B97F4A7C15ULL); }
+        };
+
+        typedef std::unordered_map<TreeKey, MoveStats, TreeKeyHash> Shard;
+
+        OpeningTreeOptions options;
+        std::vector<std::unique_ptr<Shard>> shards;
+        size_t shardLimit;
+
+        std::vector<std::string> runFiles;
+        std::mutex runMutex;
+        std::string runPrefix;
+
+        std::atomic<uint64_t> games;
+        std::atomic<uint64_t> positions;
+        uint64_t runCount;
+        uint64_t mergedRecords;
+        uint64_t writtenRecords;
+        std::atomic<bool> spillFailed;
+
+        bool spill(Shard& shard);
+        uint64_t merge(const std::function<void(const TreeRecord&)>& callback);
+
+    public:
+        OpeningTreeBuilder(const OpeningTreeOptions& options);
+        ~OpeningTreeBuilder();
+
+        // positions[i] is the position moves[i] was played from. Safe to call concurrently for different workers.
+        bool addGame(const std::vector<Move>& moves, const std::vector<Position>& positions, GameResult result, int worker);
+
+        // Spills what is left in the shards and merges every run into a Polyglot book (weights from the
+        // score of each move) or an opening tree file. Returns false on I/O errors.
+        bool writePolyglot(const std::string& path);
+        bool writeTree(const std::string& path);
+
+        OpeningTreeStats getStats();
+
+        // Copy constructor and copy assignment operators should not be allowed
+        OpeningTreeBuilder(const OpeningTreeBuilder&) = delete;
+        OpeningTreeBuilder& operator=(const OpeningTreeBuilder&) = delete;
+
+};
+
+OpeningTreeBuilder::OpeningTreeBuilder(const OpeningTreeOptions& options)
+    : options(options), games(0), positions(0), runCount(0), mergedRecords(0), writtenRecords(0), spillFailed(false) {
+
+    int shardCount = std::max(1, options.threadCount);
+    for (int i = 0; i < shardCount; i++) shards.emplace_back(new Shard());
+
+    // Rough cost of an unordered_map node plus its bucket
+    const size_t bytesPerEntry = sizeof(TreeKey) + sizeof(MoveStats) + 48;
+    shardLimit = std::max<size_t>(1024, options.memoryBudget / shardCount / bytesPerEntry);
+
+    runPrefix = options.tempDirectory + "/opening_tree." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+
+}
+
+OpeningTreeBuilder::~OpeningTreeBuilder() {
+    for (const std::string& run : runFiles) std::remove(run.c_str());
+}
+
+bool OpeningTreeBuilder::addGame(const std::vector<Move>& moves, const std::vector<Position>& gamePositions, GameResult result, int worker) {
+
+    Shard& shard = *shards[worker];
+    size_t plies = std::min<size_t>(moves.size(), options.maxPlies);
+
+    for (size_t ply = 0; ply < plies && ply < gamePositions.size(); ply++) {
+
+        const Position& position = gamePositions[ply];
+        MoveStats& stats = shard[{polyglotKey(position), encodePolyglotMove(moves[ply])}];
+        stats.count++;
+
+        if (result == GameResult::DRAW) stats.draws++;
+        else if (result == GameResult::WHITE_WIN) (position.whiteToMove ? stats.wins : stats.losses)++;
+        else if (result == GameResult::BLACK_WIN) (position.whiteToMove ? stats.losses : stats.wins)++;
+    }
+
+    games++;
+    positions += plies;
+
+    if (shard.size() >= shardLimit) return spill(shard);
+    return true;
+
+}
+
+bool OpeningTreeBuilder::spill(Shard& shard) {
+
+    if (shard.empty()) return true;
+
+    std::vector<TreeRecord> records;
+    records.reserve(shard.size());
+    for (const auto& entry : shard) records.push_back({entry.first.key, entry.first.move, entry.second});
+    Shard().swap(shard);
+
+    std::sort(records.begin(), records.end());
+
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(runMutex);
+        path = runPrefix + "." + std::to_string(runCount++) + ".run";
+        runFiles.push_back(path);
+    }
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Unable to create " << path << std::endl;
+        spillFailed = true;
+        return false;
+    }
+
+    uint8_t header[OPENING_TREE_HEADER_SIZE];
+    memcpy(header, OPENING_TREE_MAGIC, sizeof(OPENING_TREE_MAGIC));
+    for (int i = 0; i < 8; i++) header[8 + i] = static_cast<uint8_t>(static_cast<uint64_t>(records.size()) >> (8 * i));
+    bool written = std::fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+    // Buffered in blocks rather than one fwrite per record
+    std::vector<uint8_t> buffer(4096 * TREE_RECORD_SIZE);
+    for (size_t i = 0; i < records.size() && written; i += 4096) {
+        size_t count = std::min<size_t>(4096, records.size() - i);
+        for (size_t j = 0; j < count; j++) writeTreeRecord(records[i + j], buffer.data() + j * TREE_RECORD_SIZE);
+        written = std::fwrite(buffer.data(), TREE_RECORD_SIZE, count, file) == count;
+    }
+
+    if (std::fclose(file) != 0 || !written) {
+        std::cerr << "Failed to write " << path << std::endl;
+        spillFailed = true;
+        return false;
+    }
+    return true;
+
+}
+
+uint64_t OpeningTreeBuilder::merge(const std::function<void(const TreeRecord&)>& callback) {
+
+    // Whatever is still in memory becomes one last run per shard
+    for (std::unique_ptr<Shard>& shard : shards) spill(*shard);
+
+    struct RunCursor {
+        MappedFile file;
+        const uint8_t* next;
+        const uint8_t* end;
+    };
+
+    std::vector<std::unique_ptr<RunCursor>> cursors;
+    for (const std::string& run : runFiles) {
+        std::unique_ptr<RunCursor> cursor(new RunCursor());
+        if (!cursor->file.open(run)) {
+            spillFailed = true;
+            continue;
+        }
+        cursor->file.adviseSequential();
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(cursor->file.getData());
+        cursor->next = data + OPENING_TREE_HEADER_SIZE;
+        cursor->end = data + cursor->file.getSize();
+        cursors.push_back(std::move(cursor));
+    }
+
+    // k-way merge, the heap holds the next record of every run
+    typedef std::pair<TreeRecord, size_t> HeapEntry;
+    auto later = [](const HeapEntry& a, const HeapEntry& b) { return b.first < a.first; };
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, decltype(later)> heap(later);
+
+    auto advance = [&](size_t index) {
+        RunCursor& cursor = *cursors[index];
+        if (cursor.end - cursor.next < TREE_RECORD_SIZE) return;
+        TreeRecord record;
+        readTreeRecord(cursor.next, record);
+        cursor.next += TREE_RECORD_SIZE;
+        heap.push({record, index});
+    };
+
+    for (size_t i = 0; i < cursors.size(); i++) advance(i);
+
+    uint64_t emitted = 0;
+    bool pending = false;
+    TreeRecord current = {};
+
+    while (!heap.empty()) {
+
+        HeapEntry top = heap.top();
+        heap.pop();
+        advance(top.second);
+        mergedRecords++;
+
+        if (pending && current.key == top.first.key && current.move == top.first.move) {
+            current.stats.count += top.first.stats.count;
+            current.stats.wins += top.first.stats.wins;
+            current.stats.draws += top.first.stats.draws;
+            current.stats.losses += top.first.stats.losses;
+            continue;
+        }
+
+        if (pending && current.stats.count >= options.minCount) {
+            callback(current);
+            emitted++;
+        }
+        current = top.first;
+        pending = true;
+    }
+
+    if (pending && current.stats.count >= options.minCount) {
+        callback(current);
+        emitted++;
+    }
+
+    for (const std::string& run : runFiles) std::remove(run.c_str());
+    runFiles.clear();
+
+    writtenRecords = emitted;
+    return emitted;
+
+}
+
+bool OpeningTreeBuilder::writeTree(const std::string& path) {
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Unable to create " << path << std::endl;
+        return false;
+    }
+
+    // The record count is only known after the merge, so the header is written last
+    uint8_t header[OPENING_TREE_HEADER_SIZE] = {};
+    bool written = std::fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+    uint8_t buffer[TREE_RECORD_SIZE];
+    uint64_t count = merge([&](const TreeRecord& record) {
+        writeTreeRecord(record, buffer);
+        written = written && std::fwrite(buffer, 1, sizeof(buffer), file) == sizeof(buffer);
+    });
+
+    memcpy(header, OPENING_TREE_MAGIC, sizeof(OPENING_TREE_MAGIC));
+    for (int i = 0; i < 8; i++) header[8 + i] = static_cast<uint8_t>(count >> (8 * i));
+    written = written && std::fseek(file, 0, SEEK_SET) == 0 && std::fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+    if (std::fclose(file) != 0 || !written || spillFailed) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return false;
+    }
+    return true;
+
+}
+
+bool OpeningTreeBuilder::writePolyglot(const std::string& path) {
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Unable to create " << path << std::endl;
+        return false;
+    }
+
+    bool written = true;
+    std::vector<TreeRecord> group;
+
+    // Weights are the score of the move in half points, scaled down when they would not fit in 16 bits.
+    // Entries of a position are written best first, as Polyglot books usually are.
+    auto flush = [&]() {
+
+        uint64_t best = 0;
+        for (const TreeRecord& record : group) best = std::max<uint64_t>(best, 2ULL * record.stats.wins + record.stats.draws);
+
+        std::stable_sort(group.begin(), group.end(), [](const TreeRecord& a, const TreeRecord& b) {
+            return 2ULL * a.stats.wins + a.stats.draws > 2ULL * b.stats.wins + b.stats.draws;
+        });
+
+        for (const TreeRecord& record : group) {
+            uint64_t score = 2ULL * record.stats.wins + record.stats.draws;
+            uint16_t weight = static_cast<uint16_t>(best > 65535 ? score * 65535 / best : score);
+
+            uint8_t entry[POLYGLOT_ENTRY_SIZE] = {};
+            for (int i = 0; i < 8; i++) entry[i] = static_cast<uint8_t>(record.key >> (56 - 8 * i));
+            entry[8] = static_cast<uint8_t>(record.move >> 8);
+            entry[9] = static_cast<uint8_t>(record.move);
+            entry[10] = static_cast<uint8_t>(weight >> 8);
+            entry[11] = static_cast<uint8_t>(weight);
+            written = written && std::fwrite(entry, 1, sizeof(entry), file) == sizeof(entry);
+        }
+        group.clear();
+
+    };
+
+    merge([&](const TreeRecord& record) {
+        if (!group.empty() && group.front().key != record.key) flush();
+        group.push_back(record);
+    });
+    flush();
+
+    if (std::fclose(file) != 0 || !written || spillFailed) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return false;
+    }
+    return true;
+
+}
+
+OpeningTreeStats OpeningTreeBuilder::getStats() {
+    return {games, positions, runCount, mergedRecords, writtenRecords};
+}
+
+// Read-only, memory-mapped opening tree written by OpeningTreeBuilder::writeTree
+class OpeningTree {
+
+    private:
+        MappedFile file;
+        const uint8_t* records;
+        uint64_t recordCount;
+
+    public:
+        OpeningTree();
+
+        bool open(const std::string& path);
+        uint64_t getRecordCount();
+
+        // Moves stored for the position key, in move order
+        size_t findMoves(U64 key, std::vector<TreeRecord>& moves);
+
+        // Copy constructor and copy assignment operators should not be allowed
+        OpeningTree(const OpeningTree&) = delete;
+        OpeningTree& operator=(const OpeningTree&) = delete;
+
+};
+
+OpeningTree::OpeningTree() : records(nullptr), recordCount(0) {}
+
+bool OpeningTree::open(const std::string& path) {
+
+    records = nullptr;
+    recordCount = 0;
+    if (!file.open(path)) return false;
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(file.getData());
+    size_t size = file.getSize();
+
+    uint64_t count = 0;
+    if (size >= static_cast<size_t>(OPENING_TREE_HEADER_SIZE)) {
+        for (int i = 0; i < 8; i++) count |= static_cast<uint64_t>(data[8 + i]) << (8 * i);
+    }
+
+    if (size < static_cast<size_t>(OPENING_TREE_HEADER_SIZE) || memcmp(data, OPENING_TREE_MAGIC, sizeof(OPENING_TREE_MAGIC)) != 0
+        || count != (size - OPENING_TREE_HEADER_SIZE) / TREE_RECORD_SIZE) {
+        std::cerr << path << " is not an opening tree" << std::endl;
+        file.close();
+        return false;
+    }
+
+    records = data + OPENING_TREE_HEADER_SIZE;
+    recordCount = count;
+    return true;
+
+}
+
+uint64_t OpeningTree::getRecordCount() {
+    return recordCount;
+}
+
+size_t OpeningTree::findMoves(U64 key, std::vector<TreeRecord>& moves) {
+
+    moves.clear();
+
+    // Lower bound on the key, comparing the key bytes in place
+    auto keyAt = [&](uint64_t index) {
+        U64 value = 0;
+        for (int i = 0; i < 8; i++) value |= static_cast<U64>(records[index * TREE_RECORD_SIZE + i]) << (8 * i);
+        return value;
+    };
+
+    uint64_t low = 0, high = recordCount;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        if (keyAt(middle) < key) low = middle + 1;
+        else high = middle;
+    }
+
+    for (uint64_t i = low; i < recordCount && keyAt(i) == key; i++) {
+        TreeRecord record;
+        readTreeRecord(records + i * TREE_RECORD_SIZE, record);
+        moves.push_back(record);
+    }
+    return moves.size();
+
+}
+
+#endif // OPENINGTREE_HPP
@@ -0,0 +1,74 @@
+#ifndef PACKEDPOSITION_HPP
+#define PACKEDPOSITION_HPP
+
+#include <Board.hpp>
+#include <cstdint>
+
+// 32 byte on-disk form of a Position, independent of host endianness:
+//   bytes  0-7  occupancy bitboard (little endian)
+//   bytes  8-23 one nibble per occupied square in square order, holding the PieceType (low nibble first)
+//   byte   24   bit 0 white to move, bits 1-4 castling rights
+//   byte   25   en passant square, 0xFF when there is none
+//   byte   26   halfmove clock (saturates at 255)
+//   bytes 27-28 fullmove number (little endian)
+//   bytes 29-31 zero
+const int PACKED_POSITION_SIZE = 32;
+
+void packPosition(const Position& position, uint8_t* out) {
+
+    for (int i = 0; i < PACKED_POSITION_SIZE; i++) out[i] = 0;
+
+    U64 occupancy = 0;
+    for (int i = 0; i < 12; i++) occupancy |= position.bitboards[i];
+
+    for (int i = 0; i < 8; i++) out[i] = static_cast<uint8_t>(occupancy >> (8 * i));
+
+    // Piece list, at most 32 pieces fit in the 16 nibble bytes
+    int count = 0;
+    U64 remaining = occupancy;
+    while (remaining && count < 32) {
+        int square = findLSBIndex(remaining);
+        remaining &= remaining - 1;
+
+        U64 mask = 1ULL << square;
+        int type = 0;
+        while (type < 11 && !(position.bitboards[type] & mask)) type++;
+
+        out[8 + count / 2] |= static_cast<uint8_t>(type << (4 * (count % 2)));
+        count++;
+    }
+
+    out[24] = static_cast<uint8_t>((position.whiteToMove ? 1 : 0) | (position.castlingRights << 1));
+    out[25] = position.enPassantSquare < 0 ? 0xFF : static_cast<uint8_t>(position.enPassantSquare);
+    out[26] = position.halfmoveClock > 255 ? 255 : static_cast<uint8_t>(position.halfmoveClock);
+    out[27] = static_cast<uint8_t>(position.fullmoveNumber);
+    out[28] = static_cast<uint8_t>(position.fullmoveNumber >> 8);
+
+}
+
+void unpackPosition(const uint8_t* in, Position& position) {
+
+    for (int i = 0; i < 12; i++) position.bitboards[i] = 0;
+
+    U64 occupancy = 0;
+    for (int i = 0; i < 8; i++) occupancy |= static_cast<U64>(in[i]) << (8 * i);
+
+    int count = 0;
+    while (occupancy && count < 32) {
+        int square = findLSBIndex(occupancy);
+        occupancy &= occupancy - 1;
+
+        int type = (in[8 + count / 2] >> (4 * (count % 2))) & 0xF;
+        if (type < 12) position.bitboards[type] |= 1ULL << square;
+        count++;
+    }
+
+    position.whiteToMove = in[24] & 1;
+    position.castlingRights = (in[24] >> 1) & 0xF;
+    position.enPassantSquare = in[25] == 0xFF ? -1 : static_cast<int8_t>(in[25] & 63);
+    position.halfmoveClock = in[26];
+    position.fullmoveNumber = static_cast<uint16_t>(in[27] | (in[28] << 8));
+
+}
+
+#endif // PACKEDPOSITION_HPP
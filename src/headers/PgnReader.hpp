@@ -0,0 +1,401 @@
+#ifndef PGNREADER_HPP
+#define PGNREADER_HPP
+
+#include <Board.hpp>
+#include <MoveGenerator.hpp>
+#include <MappedFile.hpp>
+#include <Move.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// A single game handed to the PgnReader callback.
+// The string views point into the mapped file and stay valid for as long as the reader is open.
+struct PgnGame {
+    std::string_view tags;              // raw tag pair section
+    GameResult result;
+    std::vector<Move> moves;
+    std::vector<Position> positions;    // positions[0] is the start, positions[i + 1] follows moves[i]
+    bool complete;                      // false if a move could not be resolved, the sequence stops before it
+};
+
+struct PgnStats {
+    size_t games;
+    size_t incompleteGames;
+    size_t plies;
+    size_t bytes;
+    double seconds;
+};
+
+// Value of a tag ("White", "Result", "FEN", ...) within a tag section, empty if the tag is missing
+std::string_view findPgnTag(std::string_view tags, std::string_view name);
+
+// Resolve a SAN token ("Nbd7", "exd6", "O-O", "e8=Q+") against the legal moves of the side to move
+bool resolveSAN(std::string_view san, Board& board, MoveGenerator& moveGenerator, Move& move);
+
+class PgnReader {
+
+    private:
+        MappedFile file;
+        Board prototype;
+
+        size_t findGameStart(size_t offset);
+        const char* parseGame(const char* p, const char* end, Board& board, MoveGenerator& moveGenerator, PgnGame& game);
+
+    public:
+        PgnReader();
+
+        bool open(const std::string& path);
+
+        // Replay every game in the file, splitting it at game boundaries across threadCount workers
+        // (0 uses every core). The callback runs on the worker threads, with the worker index as its
+        // second argument, so it must be safe to call concurrently for different workers.
+        PgnStats run(const std::function<void(const PgnGame&, int)>& callback, int threadCount = 0);
+
+        // Copy constructor and copy assignment operators should not be allowed
+        PgnReader(const PgnReader&) = delete;
+        PgnReader& operator=(const PgnReader&) = delete;
+
+};
+
+PgnReader::PgnReader() {}
+
+bool PgnReader::open(const std::string& path) {
+    if (!file.open(path)) return false;
+    file.adviseSequential();
+    return true;
+}
+
+PgnStats PgnReader::run(const std::function<void(const PgnGame&, int)>& callback, int threadCount) {
+
+    if (threadCount <= 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    const char* data = file.getData();
+    size_t size = file.getSize();
+
+    // Several chunks per worker so that uneven game lengths still balance out
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount * 8, size / (64 * 1024)));
+
+    std::vector<size_t> boundaries = {0};
+    for (size_t i = 1; i < chunkCount; i++) {
+        size_t boundary = findGameStart(i * (size / chunkCount));
+        if (boundary > boundaries.back() && boundary < size) boundaries.push_back(boundary);
+    }
+    boundaries.push_back(size);
+
+    std::atomic<size_t> nextChunk{0};
+    std::atomic<size_t> games{0}, incompleteGames{0}, plies{0};
+
+    auto worker = [&](int index) {
+
+        Board board = prototype;
+        MoveGenerator moveGenerator(board);
+        PgnGame game;
+        size_t localGames = 0, localIncomplete = 0, localPlies = 0;
+
+        for (size_t chunk = nextChunk++; chunk + 1 < boundaries.size(); chunk = nextChunk++) {
+
+            const char* p = data + boundaries[chunk];
+            const char* chunkEnd = data + boundaries[chunk + 1];
+
+            // Games are owned by the chunk they start in, and may run on past its end
+            while (true) {
+                while (p < chunkEnd && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+                if (p >= chunkEnd) break;
+
+                const char* next = parseGame(p, data + size, board, moveGenerator, game);
+                if (next == p) break;
+                p = next;
+
+                if (game.tags.empty() && game.moves.empty()) continue;
+                localGames++;
+                localPlies += game.moves.size();
+                if (!game.complete) localIncomplete++;
+                callback(game, index);
+            }
+        }
+
+        games += localGames;
+        incompleteGames += localIncomplete;
+        plies += localPlies;
+
+    };
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threadCount; i++) workers.emplace_back(worker, i);
+    for (std::thread& thread : workers) thread.join();
+
+    PgnStats stats;
+    stats.games = games;
+    stats.incompleteGames = incompleteGames;
+    stats.plies = plies;
+    stats.bytes = size;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+
+}
+
+// First game (a line starting with "[Event ") at or after offset, or the file size if there is none
+size_t PgnReader::findGameStart(size_t offset) {
+
+    const char* data = file.getData();
+    size_t size = file.getSize();
+    const char tag[] = "\n[Event ";
+    const size_t tagLength = sizeof(tag) - 1;
+
+    while (offset < size) {
+        const char* newline = static_cast<const char*>(memchr(data + offset, '\n', size - offset));
+        if (!newline) break;
+        offset = newline - data;
+        if (size - offset >= tagLength && memcmp(newline, tag, tagLength) == 0) return offset + 1;
+        offset++;
+    }
+
+    return size;
+
+}
+
+// Parse a single game starting at p, returning a pointer just past it
+const char* PgnReader::parseGame(const char* p, const char* end, Board& board, MoveGenerator& moveGenerator, PgnGame& game) {
+
+    auto isSpace = [](char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; };
+    auto skipLine = [&](const char* q) {
+        const char* newline = static_cast<const char*>(memchr(q, '\n', end - q));
+        return newline ? newline + 1 : end;
+    };
+
+    game.moves.clear();
+    game.positions.clear();
+    game.result = GameResult::UNKNOWN;
+    game.complete = true;
+
+    while (p != end && isSpace(*p)) p++;
+    const char* gameStart = p;
+
+    // Tag pair section, one "[Name "Value"]" per line
+    const char* tagsBegin = p;
+    while (p != end && *p == '[') {
+        p = skipLine(p);
+        while (p != end && isSpace(*p)) p++;
+    }
+    game.tags = std::string_view(tagsBegin, p - tagsBegin);
+
+    // Start position, normally the initial position unless a FEN tag says otherwise
+    std::string_view fen = findPgnTag(game.tags, "FEN");
+    bool loaded = fen.empty() ? board.loadFEN(START_FEN, strlen(START_FEN)) : board.loadFEN(fen.data(), fen.size());
+    if (loaded) {
+        Position position;
+        board.savePosition(position);
+        game.positions.push_back(position);
+    } else {
+        game.complete = false;
+    }
+
+    // Movetext
+    while (p != end) {
+
+        char c = *p;
+
+        if (isSpace(c)) {
+            p++;
+        }
+
+        // The next game's tags, when the previous game has no termination marker
+        else if (c == '[' && p != gameStart && p[-1] == '\n') {
+            break;
+        }
+
+        // Comments and escaped lines
+        else if (c == '{') {
+            const char* close = static_cast<const char*>(memchr(p, '}', end - p));
+            p = close ? close + 1 : end;
+        }
+        else if (c == ';' || (c == '%' && p != gameStart && p[-1] == '\n')) {
+            p = skipLine(p);
+        }
+
+        // Variations (which may nest, and may contain comments)
+        else if (c == '(') {
+            int depth = 0;
+            while (p != end) {
+                if (*p == '(') depth++;
+                else if (*p == ')' && --depth == 0) { p++; break; }
+                else if (*p == '{') {
+                    const char* close = static_cast<const char*>(memchr(p, '}', end - p));
+                    if (!close) { p = end; break; }
+                    p = close;
+                }
+                p++;
+            }
+        }
+
+        // Numeric annotation glyphs
+        else if (c == '$') {
+            p++;
+            while (p != end && *p >= '0' && *p <= '9') p++;
+        }
+
+        // Game termination markers
+        else if (c == '*') {
+            p++;
+            break;
+        }
+        else if (end - p >= 3 && (memcmp(p, "1-0", 3) == 0 || memcmp(p, "0-1", 3) == 0)) {
+            game.result = p[0] == '1' ? GameResult::WHITE_WIN : GameResult::BLACK_WIN;
+            p += 3;
+            break;
+        }
+        else if (end - p >= 7 && memcmp(p, "1/2-1/2", 7) == 0) {
+            game.result = GameResult::DRAW;
+            p += 7;
+            break;
+        }
+
+        // Move numbers ("12." or "12..."), castling written with zeros is left to the SAN branch
+        else if (c >= '1' && c <= '9') {
+            while (p != end && ((*p >= '0' && *p <= '9') || *p == '.')) p++;
+        }
+
+        // SAN move
+        else {
+            const char* tokenStart = p;
+            while (p != end && !isSpace(*p) && !strchr("{}();$", *p)) p++;
+            if (p == tokenStart) p++;
+
+            // Keep scanning for the termination marker once a move fails to resolve
+            if (!game.complete) continue;
+
+            Move move;
+            if (resolveSAN(std::string_view(tokenStart, p - tokenStart), board, moveGenerator, move)) {
+                board.simulateExecuteMove(move.piece, move.fromPos, move.toPos, move.promotion);
+                Position position;
+                board.savePosition(position);
+                game.moves.push_back(move);
+                game.positions.push_back(position);
+            } else {
+                game.complete = false;
+            }
+        }
+
+    }
+
+    return p;
+
+}
+
+std::string_view findPgnTag(std::string_view tags, std::string_view name) {
+
+    size_t pos = 0;
+    while ((pos = tags.find('[', pos)) != std::string_view::npos) {
+
+        pos++;
+        if (tags.compare(pos, name.size(), name) == 0 && pos + name.size() < tags.size() && tags[pos + name.size()] == ' ') {
+            size_t open = tags.find('"', pos + name.size());
+            if (open == std::string_view::npos) break;
+            size_t close = tags.find('"', open + 1);
+            if (close == std::string_view::npos) break;
+            return tags.substr(open + 1, close - open - 1);
+        }
+
+    }
+
+    return std::string_view();
+
+}
+
+bool resolveSAN(std::string_view san, Board& board, MoveGenerator& moveGenerator, Move& move) {
+
+    // Strip check / mate markers and move annotations
+    size_t length = san.size();
+    while (length && strchr("+#!?", san[length - 1])) length--;
+    if (length < 2) return false;
+
+    const char* s = san.data();
+    bool isWhite = board.isWhiteToMove();
+
+    // Castling (also written with zeros)
+    if (s[0] == 'O' || s[0] == '0') {
+        int fromPos = isWhite ? 4 : 60;
+        int toPos;
+        if (length == 3 && s[1] == '-' && s[2] == s[0]) toPos = fromPos + 2;
+        else if (length == 5 && s[1] == '-' && s[2] == s[0] && s[3] == '-' && s[4] == s[0]) toPos = fromPos - 2;
+        else return false;
+
+        PieceType king = isWhite ? PieceType::WK : PieceType::BK;
+        if (!moveGenerator.isLegalMove(king, fromPos, toPos)) return false;
+        move = {king, fromPos, toPos, PieceType::EMPTY};
+        return true;
+    }
+
+    // Moving piece, pawns have no letter
+    size_t i = 0;
+    PieceType piece = isWhite ? PieceType::WP : PieceType::BP;
+    if (strchr("NBRQK", s[0])) {
+        piece = pieceTypeFromChar(isWhite ? s[0] : s[0] + ('a' - 'A'));
+        i = 1;
+    }
+    bool isPawn = piece == PieceType::WP || piece == PieceType::BP;
+
+    // Promotion suffix ("e8=Q" or "e8Q")
+    PieceType promotion = PieceType::EMPTY;
+    size_t squareEnd = length;
+    if (strchr("NBRQ", s[squareEnd - 1])) {
+        if (!isPawn) return false;
+        promotion = pieceTypeFromChar(isWhite ? s[squareEnd - 1] : s[squareEnd - 1] + ('a' - 'A'));
+        squareEnd--;
+        if (squareEnd && s[squareEnd - 1] == '=') squareEnd--;
+    }
+
+    // Destination square
+    if (squareEnd < i + 2) return false;
+    char toFile = s[squareEnd - 2], toRank = s[squareEnd - 1];
+    if (toFile < 'a' || toFile > 'h' || toRank < '1' || toRank > '8') return false;
+    int toPos = (toRank - '1') * 8 + (toFile - 'a');
+
+    // Disambiguation, capture markers (and the dash of long algebraic notation) are ignored
+    int fromFile = -1, fromRank = -1;
+    for (size_t j = i; j < squareEnd - 2; j++) {
+        char c = s[j];
+        if (c >= 'a' && c <= 'h') fromFile = c - 'a';
+        else if (c >= '1' && c <= '8') fromRank = c - '1';
+        else if (c != 'x' && c != '-') return false;
+    }
+
+    if (isPawn) {
+        // Pawn pushes stay on their file
+        if (fromFile == -1) fromFile = toPos % 8;
+
+        // Only a move to the last rank promotes, anything else marked as one is corrupt
+        if (promotion != PieceType::EMPTY && toPos < 56 && toPos >= 8) return false;
+        if (promotion == PieceType::EMPTY && (toPos >= 56 || toPos < 8)) promotion = isWhite ? PieceType::WQ : PieceType::BQ;
+    }
+
+    U64 candidates = board.getBitboard(piece);
+    if (fromFile != -1) candidates &= FILE_A << fromFile;
+    if (fromRank != -1) candidates &= RANK_1 << (8 * fromRank);
+
+    // Exactly one candidate may be able to make the move
+    int matches = 0;
+    while (candidates) {
+        int fromPos = findLSBIndex(candidates);
+        candidates &= candidates - 1;
+
+        if (moveGenerator.isLegalMove(piece, fromPos, toPos)) {
+            move = {piece, fromPos, toPos, promotion};
+            matches++;
+        }
+    }
+
+    return matches == 1;
+
+}
+
+#endif // PGNREADER_HPP
@@ -33,4 +33,33 @@ std::string pieceTypeToString(PieceType type) {
     }
 }
 
+bool isWhitePiece(PieceType type) {
+    return type >= PieceType::WP && type <= PieceType::WK;
+}
+
+// FEN letter for a piece (upper case for white, lower case for black)
+char pieceTypeToChar(PieceType type) {
+    static const char pieceChars[] = "prbnqkPRBNQK.";
+    return pieceChars[static_cast<int>(type)];
+}
+
+// Inverse of the above, returns EMPTY for any character that is not a piece letter
+PieceType pieceTypeFromChar(char c) {
+    switch (c) {
+        case 'p': return PieceType::BP;
+        case 'r': return PieceType::BR;
+        case 'b': return PieceType::BB;
+        case 'n': return PieceType::BN;
+        case 'q': return PieceType::BQ;
+        case 'k': return PieceType::BK;
+        case 'P': return PieceType::WP;
+        case 'R': return PieceType::WR;
+        case 'B': return PieceType::WB;
+        case 'N': return PieceType::WN;
+        case 'Q': return PieceType::WQ;
+        case 'K': return PieceType::WK;
+        default:  return PieceType::EMPTY;
+    }
+}
+
 #endif // PIECETYPE_H
\ No newline at end of file
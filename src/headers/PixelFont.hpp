@@ -0,0 +1,48 @@
+#ifndef PIXELFONT_HPP
+#define PIXELFONT_HPP
+
+#include <SDL.h>
+#include <cctype>
+#include <vector>
+
+// 3x5 pixel glyphs for the few characters the overlays print, one row per entry, leftmost pixel in bit 2.
+// Lower case letters are drawn as upper case, anything missing as a space.
+struct PixelGlyph {
+    char character;
+    unsigned char rows[5];
+};
+
+const PixelGlyph PIXEL_FONT[] = {
+    {'0', {7, 5, 5, 5, 7}}, {'1', {2, 6, 2, 2, 7}}, {'2', {7, 1, 7, 4, 7}}, {'3', {7, 1, 7, 1, 7}},
+    {'4', {5, 5, 7, 1, 1}}, {'5', {7, 4, 7, 1, 7}}, {'6', {7, 4, 7, 5, 7}}, {'7', {7, 1, 1, 1, 1}},
+    {'8', {7, 5, 7, 5, 7}}, {'9', {7, 5, 7, 1, 7}}, {'.', {0, 0, 0, 0, 2}}, {'+', {0, 2, 7, 2, 0}},
+    {'-', {0, 0, 7, 0, 0}}, {'#', {5, 7, 5, 7, 5}}, {'A', {2, 5, 7, 5, 5}}, {'B', {6, 5, 6, 5, 6}},
+    {'C', {3, 4, 4, 4, 3}}, {'D', {6, 5, 5, 5, 6}}, {'E', {7, 4, 6, 4, 7}}, {'F', {7, 4, 6, 4, 4}},
+    {'G', {3, 4, 5, 5, 3}}, {'H', {5, 5, 7, 5, 5}}, {'K', {5, 5, 6, 5, 5}}, {'M', {5, 7, 7, 5, 5}},
+    {'N', {6, 5, 5, 5, 5}}, {'P', {6, 5, 6, 4, 4}}, {'Q', {2, 5, 5, 6, 3}}, {'R', {6, 5, 6, 5, 5}},
+    {'S', {3, 4, 2, 1, 6}}, {'V', {5, 5, 5, 5, 2}}, {'X', {5, 5, 2, 5, 5}}
+};
+
+// Each character advances 4 font pixels
+const int PIXEL_FONT_ADVANCE = 4;
+const int PIXEL_FONT_HEIGHT = 5;
+
+// Appends one rectangle per lit font pixel of text, drawn at (x, y) with font pixels pixelSize wide
+void addPixelText(std::vector<SDL_Rect>& pixels, const char* text, int x, int y, int pixelSize) {
+
+    for (; *text; text++, x += PIXEL_FONT_ADVANCE * pixelSize) {
+        char character = static_cast<char>(std::toupper(static_cast<unsigned char>(*text)));
+        for (const PixelGlyph& glyph : PIXEL_FONT) {
+            if (glyph.character != character) continue;
+            for (int row = 0; row < PIXEL_FONT_HEIGHT; row++) {
+                for (int col = 0; col < 3; col++) {
+                    if (glyph.rows[row] & (4 >> col)) pixels.push_back({x + col * pixelSize, y + row * pixelSize, pixelSize, pixelSize});
+                }
+            }
+            break;
+        }
+    }
+
+}
+
+#endif // PIXELFONT_HPP
@@ -0,0 +1,288 @@
+#ifndef POLYGLOTBOOK_HPP
+#define POLYGLOTBOOK_HPP
+
+#include <Board.hpp>
+#include <MoveGenerator.hpp>
+#include <MappedFile.hpp>
+#include <Move.hpp>
+#include <PolyglotRandom.hpp>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// Polyglot .bin opening books: a flat array of 16 byte big endian entries sorted by key
+//   bytes  0-7  Polyglot Zobrist key of the position
+//   bytes  8-9  move, bits 0-5 to square, bits 6-11 from square, bits 12-14 promotion (0 none, 1 N, 2 B, 3 R, 4 Q)
+//                castling is stored as the king capturing its own rook (e1h1, e1a1, e8h8, e8a8)
+//   bytes 10-11 weight
+//   bytes 12-15 learning data
+const int POLYGLOT_ENTRY_SIZE = 16;
+
+struct PolyglotEntry {
+    U64 key;
+    uint16_t move;
+    uint16_t weight;
+    uint32_t learn;
+};
+
+struct BookMove {
+    Move move;
+    uint16_t weight;
+};
+
+// Polyglot kind of each PieceType, in PieceType order
+const int POLYGLOT_PIECE_KIND[12] = {0, 6, 4, 2, 8, 10, 1, 7, 5, 3, 9, 11};
+
+// Polyglot key of a position
+U64 polyglotKey(const Position& position) {
+
+    U64 key = 0;
+
+    for (int type = 0; type < 12; type++) {
+        U64 pieces = position.bitboards[type];
+        while (pieces) {
+            key ^= POLYGLOT_RANDOM[POLYGLOT_RANDOM_PIECE + 64 * POLYGLOT_PIECE_KIND[type] + findLSBIndex(pieces)];
+            pieces &= pieces - 1;
+        }
+    }
+
+    // Castling bits are in the same order as the format (white short, white long, black short, black long)
+    for (int i = 0; i < 4; i++) {
+        if (position.castlingRights & (1 << i)) key ^= POLYGLOT_RANDOM[POLYGLOT_RANDOM_CASTLE + i];
+    }
+
+    // The en passant file only counts when a pawn of the side to move can actually capture there
+    if (position.enPassantSquare >= 0) {
+        int pawnSquare = position.whiteToMove ? position.enPassantSquare - 8 : position.enPassantSquare + 8;
+        int file = position.enPassantSquare % 8;
+
+        U64 capturers = 0;
+        if (file > 0) capturers |= 1ULL << (pawnSquare - 1);
+        if (file < 7) capturers |= 1ULL << (pawnSquare + 1);
+
+        U64 pawns = position.bitboards[static_cast<int>(position.whiteToMove ? PieceType::WP : PieceType::BP)];
+        if (pawns & capturers) key ^= POLYGLOT_RANDOM[POLYGLOT_RANDOM_EN_PASSANT + file];
+    }
+
+    if (position.whiteToMove) key ^= POLYGLOT_RANDOM[POLYGLOT_RANDOM_TURN];
+
+    return key;
+
+}
+
+// Polyglot key of the position on the board
+U64 polyglotKey(Board& board) {
+    Position position;
+    board.savePosition(position);
+    return polyglotKey(position);
+}
+
+// Book encoding of a legal move, the inverse of what PolyglotBook reads back
+uint16_t encodePolyglotMove(const Move& move) {
+
+    int toPos = move.toPos;
+
+    // Castling is written as the king taking its own rook
+    bool isKing = move.piece == PieceType::WK || move.piece == PieceType::BK;
+    if (isKing && move.toPos - move.fromPos == 2) toPos = move.fromPos + 3;
+    if (isKing && move.fromPos - move.toPos == 2) toPos = move.fromPos - 4;
+
+    int promotion = 0;
+    switch (move.promotion) {
+        case PieceType::WN: case PieceType::BN: promotion = 1; break;
+        case PieceType::WB: case PieceType::BB: promotion = 2; break;
+        case PieceType::WR: case PieceType::BR: promotion = 3; break;
+        case PieceType::WQ: case PieceType::BQ: promotion = 4; break;
+        default: break;
+    }
+
+    return static_cast<uint16_t>(toPos | (move.fromPos << 6) | (promotion << 12));
+
+}
+
+// Read-only, memory-mapped Polyglot book.
+// Nothing is loaded up front: every probe binary searches the mapping, touching only a handful of pages,
+// so opening a book takes the same time whatever its size.
+class PolyglotBook {
+
+    private:
+        MappedFile file;
+        size_t entryCount;
+        std::mt19937_64 random;
+
+        PolyglotEntry readEntry(size_t index);
+        size_t findFirstEntry(U64 key);
+        bool decodeMove(uint16_t bookMove, Board& board, MoveGenerator& moveGenerator, Move& move);
+
+    public:
+        PolyglotBook();
+
+        bool open(const std::string& path);
+        void close();
+        void seed(uint64_t value);
+
+        bool isOpen();
+        size_t getEntryCount();
+
+        // Raw entries stored for the key, in file order
+        size_t findEntries(U64 key, std::vector<PolyglotEntry>& entries);
+
+        // Book moves for the position on the board, skipping any that are not legal there
+        size_t findMoves(Board& board, MoveGenerator& moveGenerator, std::vector<BookMove>& moves);
+
+        // Picks one of the book moves at random, proportionally to its weight.
+        // Returns false when the position is not in the book or all its moves have zero weight.
+        bool pickMove(Board& board, MoveGenerator& moveGenerator, Move& move);
+
+        // Copy constructor and copy assignment operators should not be allowed
+        PolyglotBook(const PolyglotBook&) = delete;
+        PolyglotBook& operator=(const PolyglotBook&) = delete;
+
+};
+
+PolyglotBook::PolyglotBook() : entryCount(0), random(std::random_device{}()) {}
+
+bool PolyglotBook::open(const std::string& path) {
+
+    close();
+    if (!file.open(path)) return false;
+
+    if (file.getSize() % POLYGLOT_ENTRY_SIZE != 0) {
+        std::cerr << path << " is not a Polyglot book (size is not a multiple of " << POLYGLOT_ENTRY_SIZE << " bytes)" << std::endl;
+        close();
+        return false;
+    }
+
+    entryCount = file.getSize() / POLYGLOT_ENTRY_SIZE;
+    return true;
+
+}
+
+void PolyglotBook::close() {
+    file.close();
+    entryCount = 0;
+}
+
+void PolyglotBook::seed(uint64_t value) {
+    random.seed(value);
+}
+
+bool PolyglotBook::isOpen() {
+    return file.isOpen();
+}
+
+size_t PolyglotBook::getEntryCount() {
+    return entryCount;
+}
+
+PolyglotEntry PolyglotBook::readEntry(size_t index) {
+
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(file.getData()) + index * POLYGLOT_ENTRY_SIZE;
+    PolyglotEntry entry;
+
+    entry.key = 0;
+    for (int i = 0; i < 8; i++) entry.key = (entry.key << 8) | p[i];
+    entry.move = static_cast<uint16_t>((p[8] << 8) | p[9]);
+    entry.weight = static_cast<uint16_t>((p[10] << 8) | p[11]);
+    entry.learn = (static_cast<uint32_t>(p[12]) << 24) | (p[13] << 16) | (p[14] << 8) | p[15];
+
+    return entry;
+
+}
+
+// Index of the first entry whose key is not less than key (lower bound)
+size_t PolyglotBook::findFirstEntry(U64 key) {
+
+    size_t low = 0, high = entryCount;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (readEntry(middle).key < key) low = middle + 1;
+        else high = middle;
+    }
+    return low;
+
+}
+
+size_t PolyglotBook::findEntries(U64 key, std::vector<PolyglotEntry>& entries) {
+
+    entries.clear();
+    for (size_t i = findFirstEntry(key); i < entryCount; i++) {
+        PolyglotEntry entry = readEntry(i);
+        if (entry.key != key) break;
+        entries.push_back(entry);
+    }
+    return entries.size();
+
+}
+
+bool PolyglotBook::decodeMove(uint16_t bookMove, Board& board, MoveGenerator& moveGenerator, Move& move) {
+
+    int toPos = bookMove & 63;
+    int fromPos = (bookMove >> 6) & 63;
+    int promotion = (bookMove >> 12) & 7;
+
+    PieceType piece = board.getPieceAtPosition(fromPos);
+    if (piece == PieceType::EMPTY || isWhitePiece(piece) != board.isWhiteToMove()) return false;
+
+    // King takes own rook is how the format spells castling
+    bool isKing = piece == PieceType::WK || piece == PieceType::BK;
+    if (isKing && (fromPos == 4 || fromPos == 60)) {
+        if (toPos == fromPos + 3) toPos = fromPos + 2;
+        else if (toPos == fromPos - 4) toPos = fromPos - 2;
+    }
+
+    bool isWhite = isWhitePiece(piece);
+    const PieceType promotions[] = {
+        PieceType::EMPTY,
+        isWhite ? PieceType::WN : PieceType::BN,
+        isWhite ? PieceType::WB : PieceType::BB,
+        isWhite ? PieceType::WR : PieceType::BR,
+        isWhite ? PieceType::WQ : PieceType::BQ
+    };
+    if (promotion > 4) return false;
+
+    if (!moveGenerator.isLegalMove(piece, fromPos, toPos)) return false;
+
+    move = {piece, fromPos, toPos, promotions[promotion]};
+    return true;
+
+}
+
+size_t PolyglotBook::findMoves(Board& board, MoveGenerator& moveGenerator, std::vector<BookMove>& moves) {
+
+    moves.clear();
+
+    std::vector<PolyglotEntry> entries;
+    findEntries(polyglotKey(board), entries);
+
+    for (const PolyglotEntry& entry : entries) {
+        Move move;
+        if (decodeMove(entry.move, board, moveGenerator, move)) moves.push_back({move, entry.weight});
+    }
+    return moves.size();
+
+}
+
+bool PolyglotBook::pickMove(Board& board, MoveGenerator& moveGenerator, Move& move) {
+
+    std::vector<BookMove> moves;
+    findMoves(board, moveGenerator, moves);
+
+    uint64_t totalWeight = 0;
+    for (const BookMove& bookMove : moves) totalWeight += bookMove.weight;
+    if (totalWeight == 0) return false;
+
+    uint64_t target = std::uniform_int_distribution<uint64_t>(0, totalWeight - 1)(random);
+    for (const BookMove& bookMove : moves) {
+        if (target < bookMove.weight) {
+            move = bookMove.move;
+            return true;
+        }
+        target -= bookMove.weight;
+    }
+    return false;
+
+}
+
+#endif // POLYGLOTBOOK_HPP
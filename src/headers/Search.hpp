@@ -0,0 +1,497 @@
+#ifndef SEARCH_HPP
+#define SEARCH_HPP
+
+#include <Bitbase.hpp>
+#include <Board.hpp>
+#include <MoveGenerator.hpp>
+#include <Evaluation.hpp>
+#include <Move.hpp>
+#include <Tablebase.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+const int MAX_PLY = 64;
+const int MATE_SCORE = 30000;
+const int INFINITE_SCORE = 32000;
+
+// How often a search given onProgress reports on the depth it is still working on
+const int SEARCH_PROGRESS_MS = 100;
+
+// Longest mate a score can express: found by the search or read from a tablebase below it
+const int MAX_MATE_PLIES = 512;
+
+// Scores within MAX_MATE_PLIES of MATE_SCORE are mates, MATE_SCORE - score plies away
+bool isMateScore(int score) {
+    return std::abs(score) >= MATE_SCORE - MAX_MATE_PLIES;
+}
+
+// A position a bitbase says is won scores this plus its evaluation, well clear of material and still below
+// the mates, so the search takes it over anything but a mate and the evaluation leads it towards one
+const int BITBASE_WIN_SCORE = 20000;
+
+// Moves until mate, positive when the side to move mates
+int mateInMoves(int score) {
+    return score > 0 ? (MATE_SCORE - score + 1) / 2 : -(MATE_SCORE + score) / 2;
+}
+
+// 0 means no limit. The search stops at whichever limit is reached first.
+struct SearchLimits {
+    int maxDepth = MAX_PLY - 1;
+    int64_t timeMs = 0;
+    uint64_t maxNodes = 0;
+
+    // Checked along with stop(), for callers that need to cancel a run before it has even started
+    const std::atomic<bool>* cancel = nullptr;
+};
+
+struct SearchResult {
+    bool hasMove = false;           // false when the side to move has no legal moves
+    Move bestMove = {PieceType::EMPTY, 0, 0, PieceType::EMPTY};
+    int score = 0;                  // centipawns for the side to move, see isMateScore
+    int depth = 0;                  // last fully searched depth
+    uint64_t nodes = 0;
+    double seconds = 0;
+    std::vector<Move> pv;
+};
+
+// Iterative deepening alpha-beta search with quiescence on captures. A Search works on its own copy of
+// the board, so one can run on a worker thread while the game goes on; stop() may be called from any
+// thread.
+class Search {
+
+    private:
+        Board board;
+        MoveGenerator moveGenerator;
+        const Tablebases* tablebases;
+        const Bitbases* bitbases;
+
+        std::atomic<bool> stopRequested;
+        bool stopped;
+        uint64_t nodes;
+        uint64_t maxNodes;
+        const std::atomic<bool>* cancel;
+        bool hasDeadline;
+        std::chrono::steady_clock::time_point deadline;
+
+        // Progress reports from inside an iteration: the last completed one, and the best root move of
+        // the one under way so far with its score
+        const std::function<void(const SearchResult&)>* progressCallback;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::time_point nextProgress;
+        SearchResult* completed;
+        int iterationDepth;
+        int rootScore;
+
+        // Principal variation of every ply, triangular
+        Move pvTable[MAX_PLY][MAX_PLY];
+        int pvLength[MAX_PLY];
+
+        // Reused move lists, one per ply
+        std::vector<Move> moveLists[MAX_PLY + 1];
+
+        // Best move from the previous iteration, searched first
+        std::vector<Move> previousPv;
+
+        // Root moves that keep the result the bitbases give the root, empty when every move is searched
+        std::vector<Move> rootMoves;
+
+        int negamax(int depth, int ply, int alpha, int beta, bool followPv);
+        int quiescence(int ply, int alpha, int beta);
+
+        bool makeMove(const Move& move);
+        void orderMoves(std::vector<Move>& moves, const Move* first);
+        bool isCapture(const Move& move);
+        bool checkLimits();
+        void reportProgress(std::chrono::steady_clock::time_point now);
+
+        // Exact score of a position the tablebases cover, false if they do not
+        bool probeTablebases(int ply, int& score);
+
+        // Won, drawn or lost score of a position the bitbases cover, false if they do not
+        bool probeBitbases(int ply, int& score);
+
+        // Result of the position on the board for the side to move, bare kings being a draw
+        bool probeBitbaseResult(TablebaseResult& result);
+        void filterRootMoves(const std::vector<Move>& legalMoves);
+
+    public:
+        // Positions the tablebases cover, if given, are scored from them instead of being searched. The
+        // bitbases, if given, do the same for positions no tablebase covers, and at the root rule out the
+        // moves that throw away a win or a draw.
+        Search(Board& prototype, const Tablebases* tablebases = nullptr, const Bitbases* bitbases = nullptr);
+
+        // Searches the position until a limit is reached or stop() is called. onIteration, if given, is
+        // called with the result of every completed depth. onProgress, if given, is called from inside the
+        // search every SEARCH_PROGRESS_MS with the best root move found so far at the depth under way, or
+        // the last completed depth's result until there is one; the search waits for it to return.
+        SearchResult run(const Position& position, const SearchLimits& limits,
+                         const std::function<void(const SearchResult&)>& onIteration = nullptr,
+                         const std::function<void(const SearchResult&)>& onProgress = nullptr);
+
+        void stop();
+
+        // Copy constructor and copy assignment operators should not be allowed
+        Search(const Search&) = delete;
+        Search& operator=(const Search&) = delete;
+
+};
+
+Search::Search(Board& prototype, const Tablebases* endgameTablebases, const Bitbases* endgameBitbases)
+    : board(prototype), moveGenerator(board), tablebases(endgameTablebases), bitbases(endgameBitbases), stopRequested(false), stopped(false), nodes(0),
+      maxNodes(0), cancel(nullptr), hasDeadline(false), progressCallback(nullptr), completed(nullptr), iterationDepth(0), rootScore(0) {
+    for (int i = 0; i < MAX_PLY; i++) pvLength[i] = 0;
+}
+
+void Search::stop() {
+    stopRequested = true;
+}
+
+SearchResult Search::run(const Position& position, const SearchLimits& limits,
+                         const std::function<void(const SearchResult&)>& onIteration,
+                         const std::function<void(const SearchResult&)>& onProgress) {
+
+    start = std::chrono::steady_clock::now();
+    stopRequested = false;
+    stopped = false;
+    nodes = 0;
+    maxNodes = limits.maxNodes;
+    cancel = limits.cancel;
+    hasDeadline = limits.timeMs > 0;
+    deadline = start + std::chrono::milliseconds(limits.timeMs);
+    progressCallback = nullptr;
+    nextProgress = start + std::chrono::milliseconds(SEARCH_PROGRESS_MS);
+    previousPv.clear();
+    rootMoves.clear();
+
+    board.loadPosition(position);
+
+    SearchResult result;
+    std::vector<Move>& legalMoves = moveLists[0];
+    moveGenerator.generateLegalMoves(legalMoves);
+
+    // Nothing to search: mate or stalemate
+    if (legalMoves.empty()) {
+        moveGenerator.updatePieces();
+        result.score = moveGenerator.isKingInCheck(board.isWhiteToMove()) ? -MATE_SCORE : 0;
+        return result;
+    }
+
+    filterRootMoves(legalMoves);
+
+    result.hasMove = true;
+    result.bestMove = rootMoves.empty() ? legalMoves[0] : rootMoves[0];
+    size_t rootMoveCount = rootMoves.empty() ? legalMoves.size() : rootMoves.size();
+
+    // Only once there is a move to report
+    if (onProgress) progressCallback = &onProgress;
+    completed = &result;
+
+    int maxDepth = std::max(1, std::min(limits.maxDepth, MAX_PLY - 1));
+    for (int depth = 1; depth <= maxDepth; depth++) {
+
+        iterationDepth = depth;
+        int score = negamax(depth, 0, -INFINITE_SCORE, INFINITE_SCORE, true);
+
+        // An interrupted iteration is thrown away, except that the first one always gives a move
+        if (stopped && depth > 1) break;
+
+        result.depth = depth;
+        result.score = score;
+        result.pv.assign(pvTable[0], pvTable[0] + pvLength[0]);
+        if (!result.pv.empty()) result.bestMove = result.pv[0];
+        result.nodes = nodes;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        previousPv = result.pv;
+
+        if (onIteration) onIteration(result);
+
+        // A forced mate needs no deeper search, nor does a position with a single legal move
+        if (stopped || isMateScore(score) || rootMoveCount == 1) break;
+    }
+
+    progressCallback = nullptr;
+    completed = nullptr;
+    result.nodes = nodes;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+
+}
+
+bool Search::checkLimits() {
+
+    if (stopRequested || (cancel && *cancel) || (maxNodes && nodes >= maxNodes)) stopped = true;
+
+    // The clock is only read every so often
+    if ((hasDeadline || progressCallback) && (nodes & 1023) == 0) {
+        auto now = std::chrono::steady_clock::now();
+        if (hasDeadline && now >= deadline) stopped = true;
+        if (progressCallback && !stopped && now >= nextProgress) {
+            reportProgress(now);
+            nextProgress = now + std::chrono::milliseconds(SEARCH_PROGRESS_MS);
+        }
+    }
+
+    return stopped;
+
+}
+
+void Search::reportProgress(std::chrono::steady_clock::time_point now) {
+
+    // Until a root move has been searched at this depth, the last completed one stands. The root line is
+    // only written at ply 0, so it stays whole while the search is deeper down.
+    SearchResult progress = *completed;
+    if (pvLength[0] > 0) {
+        progress.depth = iterationDepth;
+        progress.score = rootScore;
+        progress.pv.assign(pvTable[0], pvTable[0] + pvLength[0]);
+        progress.bestMove = progress.pv[0];
+    }
+    progress.nodes = nodes;
+    progress.seconds = std::chrono::duration<double>(now - start).count();
+    (*progressCallback)(progress);
+
+}
+
+bool Search::isCapture(const Move& move) {
+
+    U64 target = 1ULL << move.toPos;
+    bool isWhite = isWhitePiece(move.piece);
+
+    for (int type = isWhite ? 0 : 6, last = type + 6; type < last; type++) {
+        if (board.getBitboard(static_cast<PieceType>(type)) & target) return true;
+    }
+
+    // En passant lands on an empty square
+    return (move.piece == PieceType::WP || move.piece == PieceType::BP) && move.toPos == board.getEnPassantSquare();
+
+}
+
+bool Search::probeTablebases(int ply, int& score) {
+
+    if (!tablebases || tablebases->getMaxPieces() == 0) return false;
+
+    Position position;
+    board.savePosition(position);
+    TablebaseEntry entry;
+    if (!tablebases->probe(position, entry)) return false;
+
+    // Mates count from the root, like the ones the search finds itself
+    if (entry.result == TablebaseResult::WIN) score = MATE_SCORE - ply - entry.distance;
+    else if (entry.result == TablebaseResult::LOSS) score = -MATE_SCORE + ply + entry.distance;
+    else score = 0;
+    return true;
+
+}
+
+bool Search::probeBitbases(int ply, int& score) {
+
+    TablebaseResult result;
+    if (!bitbases || !bitbases->probe(board, result)) return false;
+
+    // Won positions are not all alike: the evaluation tells the search which are closer to a mate
+    if (result == TablebaseResult::WIN) score = BITBASE_WIN_SCORE - ply + evaluate(board);
+    else if (result == TablebaseResult::LOSS) score = -BITBASE_WIN_SCORE + ply + evaluate(board);
+    else score = 0;
+    return true;
+
+}
+
+bool Search::probeBitbaseResult(TablebaseResult& result) {
+
+    int pieces = 0;
+    for (int type = 0; type < 12; type++) pieces += countSetBits(board.getBitboard(static_cast<PieceType>(type)));
+
+    if (pieces == 2) {
+        result = TablebaseResult::DRAW;
+        return true;
+    }
+    return bitbases->probe(board, result);
+
+}
+
+// Of the legal root moves, keeps the ones leading to a position that the bitbases say keeps the root's
+// result. Moves into positions they do not cover are kept too, the search sorts those out.
+void Search::filterRootMoves(const std::vector<Move>& legalMoves) {
+
+    TablebaseResult rootResult;
+    if (!bitbases || bitbases->getMaxPieces() == 0 || !probeBitbaseResult(rootResult)) return;
+    if (rootResult == TablebaseResult::LOSS) return;
+
+    // What the opponent is left with after a move that keeps the root's result
+    TablebaseResult kept = rootResult == TablebaseResult::WIN ? TablebaseResult::LOSS : TablebaseResult::DRAW;
+
+    Position saved;
+    board.savePosition(saved);
+
+    for (const Move& move : legalMoves) {
+        board.executeMove(move.piece, move.fromPos, move.toPos, move.promotion);
+        TablebaseResult result;
+        if (!probeBitbaseResult(result) || result == kept) rootMoves.push_back(move);
+        board.loadPosition(saved);
+    }
+
+    // Should the bitbases disagree with themselves, searching everything is the safe choice
+    if (rootMoves.empty() || rootMoves.size() == legalMoves.size()) rootMoves.clear();
+
+}
+
+// Plays a pseudo-legal move on the board, returns false (leaving the board changed) if it is illegal
+bool Search::makeMove(const Move& move) {
+
+    bool isWhite = board.isWhiteToMove();
+
+    // Castling may not start in or pass through check, which the move itself does not show
+    if ((move.piece == PieceType::WK || move.piece == PieceType::BK) && std::abs(move.toPos - move.fromPos) == 2) {
+        if (!moveGenerator.isLegalMove(move.piece, move.fromPos, move.toPos)) return false;
+    }
+
+    board.simulateExecuteMove(move.piece, move.fromPos, move.toPos, move.promotion);
+    moveGenerator.updatePieces();
+    return !moveGenerator.isKingInCheck(isWhite);
+
+}
+
+// Captures first, most valuable victim by least valuable attacker, then quiet moves in generator order.
+// A move given as first (the previous principal variation) goes before everything.
+void Search::orderMoves(std::vector<Move>& moves, const Move* first) {
+
+    std::vector<std::pair<int, Move>> scored;
+    scored.reserve(moves.size());
+
+    for (const Move& move : moves) {
+        int score = 0;
+        if (first && move == *first) {
+            score = 1000000;
+        } else if (isCapture(move)) {
+            PieceType victim = board.getPieceAtPosition(move.toPos);
+            int victimValue = victim == PieceType::EMPTY ? PIECE_VALUES[0] : PIECE_VALUES[static_cast<int>(victim) % 6];
+            score = 10000 + victimValue * 10 - PIECE_VALUES[static_cast<int>(move.piece) % 6] / 10;
+        }
+        if (move.promotion != PieceType::EMPTY) score += PIECE_VALUES[static_cast<int>(move.promotion) % 6];
+        scored.push_back({score, move});
+    }
+
+    std::stable_sort(scored.begin(), scored.end(), [](const std::pair<int, Move>& a, const std::pair<int, Move>& b) {
+        return a.first > b.first;
+    });
+
+    for (size_t i = 0; i < moves.size(); i++) moves[i] = scored[i].second;
+
+}
+
+int Search::negamax(int depth, int ply, int alpha, int beta, bool followPv) {
+
+    pvLength[ply] = 0;
+    if (ply > 0 && checkLimits()) return 0;
+    if (depth <= 0 || ply >= MAX_PLY - 1) return quiescence(ply, alpha, beta);
+
+    nodes++;
+
+    // Fifty move rule
+    if (ply > 0 && board.getHalfmoveClock() >= 100) return 0;
+
+    int tablebaseScore;
+    if (ply > 0 && (probeTablebases(ply, tablebaseScore) || probeBitbases(ply, tablebaseScore))) return tablebaseScore;
+
+    std::vector<Move>& moves = moveLists[ply];
+    moveGenerator.generatePseudoLegalMoves(moves);
+
+    const Move* first = followPv && ply < static_cast<int>(previousPv.size()) ? &previousPv[ply] : nullptr;
+    orderMoves(moves, first);
+
+    Position saved;
+    board.savePosition(saved);
+
+    int legalMoves = 0;
+    for (const Move& move : moves) {
+
+        if (ply == 0 && !rootMoves.empty() && std::find(rootMoves.begin(), rootMoves.end(), move) == rootMoves.end()) continue;
+
+        if (!makeMove(move)) {
+            board.loadPosition(saved);
+            continue;
+        }
+        legalMoves++;
+
+        bool isPvMove = first && move == *first;
+        int score = -negamax(depth - 1, ply + 1, -beta, -alpha, isPvMove);
+        board.loadPosition(saved);
+
+        if (stopped) return 0;
+
+        if (score > alpha) {
+            alpha = score;
+
+            // This move followed by the best line found below it
+            pvTable[ply][0] = move;
+            for (int i = 0; i < pvLength[ply + 1]; i++) pvTable[ply][i + 1] = pvTable[ply + 1][i];
+            pvLength[ply] = pvLength[ply + 1] + 1;
+            if (ply == 0) rootScore = alpha;
+
+            if (alpha >= beta) break;
+        }
+    }
+
+    // No legal move: mated, or stalemate
+    if (legalMoves == 0) {
+        moveGenerator.updatePieces();
+        return moveGenerator.isKingInCheck(board.isWhiteToMove()) ? -MATE_SCORE + ply : 0;
+    }
+
+    return alpha;
+
+}
+
+int Search::quiescence(int ply, int alpha, int beta) {
+
+    pvLength[ply] = 0;
+    if (checkLimits()) return 0;
+    nodes++;
+
+    int tablebaseScore;
+    if (probeTablebases(ply, tablebaseScore) || probeBitbases(ply, tablebaseScore)) return tablebaseScore;
+
+    // Standing pat: the side to move does not have to capture
+    int standPat = evaluate(board);
+    if (standPat >= beta || ply >= MAX_PLY - 1) return standPat;
+    if (standPat > alpha) alpha = standPat;
+
+    std::vector<Move>& moves = moveLists[ply];
+    moveGenerator.generatePseudoLegalMoves(moves);
+
+    // Captures and promotions only
+    size_t kept = 0;
+    for (size_t i = 0; i < moves.size(); i++) {
+        if (moves[i].promotion != PieceType::EMPTY || isCapture(moves[i])) moves[kept++] = moves[i];
+    }
+    moves.resize(kept);
+    orderMoves(moves, nullptr);
+
+    Position saved;
+    board.savePosition(saved);
+
+    for (const Move& move : moves) {
+
+        if (!makeMove(move)) {
+            board.loadPosition(saved);
+            continue;
+        }
+
+        int score = -quiescence(ply + 1, -beta, -alpha);
+        board.loadPosition(saved);
+
+        if (stopped) return 0;
+        if (score >= beta) return score;
+        if (score > alpha) alpha = score;
+    }
+
+    return alpha;
+
+}
+
+#endif // SEARCH_HPP
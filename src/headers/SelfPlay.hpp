@@ -0,0 +1,398 @@
+#ifndef SELFPLAY_HPP
+#define SELFPLAY_HPP
+
+#include <Board.hpp>
+#include <MoveGenerator.hpp>
+#include <MappedFile.hpp>
+#include <Move.hpp>
+#include <PackedPosition.hpp>
+#include <PolyglotBook.hpp>
+#include <Search.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Self-play training data: positions from engine games, each labelled with the search score and the
+// game's result, for tuning the evaluation.
+//
+// File layout (all integers little endian):
+//   header  "BBSELFP1", record size u32, reserved u32
+//   records one per position, the positions of a game written together:
+//     bytes  0-31  packed position (PackedPosition.hpp)
+//     bytes 32-33  search score in centipawns from white's point of view, signed
+//     byte   34    GameResult
+//     byte   35    bit 0 set on the last record of a game
+//     bytes 36-39  game number
+//
+// A game's records are written in one go, so an interrupted run leaves at most one partial game at the
+// end of the file. Reopening the file drops it and carries on with the games not yet played.
+const char SELFPLAY_MAGIC[8] = {'B', 'B', 'S', 'E', 'L', 'F', 'P', '1'};
+const int SELFPLAY_HEADER_SIZE = 16;
+const int SELFPLAY_RECORD_SIZE = 40;
+
+struct SelfPlayRecord {
+    Position position;
+    int score;              // centipawns, white's point of view
+    GameResult result;
+    bool lastOfGame;
+    uint32_t game;
+};
+
+void packSelfPlayRecord(const SelfPlayRecord& record, uint8_t* out) {
+    packPosition(record.position, out);
+    uint16_t score = static_cast<uint16_t>(static_cast<int16_t>(std::max(-32767, std::min(32767, record.score))));
+    out[32] = static_cast<uint8_t>(score);
+    out[33] = static_cast<uint8_t>(score >> 8);
+    out[34] = static_cast<uint8_t>(record.result);
+    out[35] = record.lastOfGame ? 1 : 0;
+    for (int i = 0; i < 4; i++) out[36 + i] = static_cast<uint8_t>(record.game >> (8 * i));
+}
+
+void unpackSelfPlayRecord(const uint8_t* in, SelfPlayRecord& record) {
+    unpackPosition(in, record.position);
+    record.score = static_cast<int16_t>(in[32] | (in[33] << 8));
+    record.result = static_cast<GameResult>(std::min<int>(in[34], static_cast<int>(GameResult::UNKNOWN)));
+    record.lastOfGame = in[35] & 1;
+    record.game = 0;
+    for (int i = 0; i < 4; i++) record.game |= static_cast<uint32_t>(in[36 + i]) << (8 * i);
+}
+
+struct SelfPlaySettings {
+    int threads = 0;                // 0 uses every core, one game per worker
+    uint64_t games = 1000;          // games played when done, counting those already in the file
+    uint64_t nodes = 5000;          // searched per move
+    int randomPlies = 8;            // random moves opening each game, not recorded
+    int maxPlies = 400;             // games still going after this many plies are drawn
+    uint64_t seed = 1;              // a game's opening depends only on this and its number
+};
+
+struct SelfPlayWorkerStats {
+    uint64_t games;
+    uint64_t positions;
+};
+
+// Plays engine games on every core and appends their positions to a self-play file. The opening of game n
+// comes from a generator seeded with the seed and n, and node limited searches play the same moves every
+// time, so a resumed run plays exactly the games it missed. (A game that left no quiet position to record
+// is not in the file and gets played again.)
+class SelfPlayFarm {
+
+    private:
+        struct alignas(64) WorkerCounters {
+            std::atomic<uint64_t> games{0};
+            std::atomic<uint64_t> positions{0};
+        };
+
+        Board prototype;
+        FILE* file;
+        std::mutex fileMutex;
+        bool writeFailed;
+
+        std::vector<bool> finished;         // by game number, games already in the file
+        uint64_t resumedGames;
+        uint64_t resumedPositions;
+
+        std::atomic<uint64_t> nextGame;
+        std::atomic<bool> stopRequested;
+        std::unique_ptr<WorkerCounters[]> counters;
+        int workerCount;
+
+        bool claimGame(uint64_t limit, uint64_t& game);
+
+        // Plays one game and fills in its records, false if it was cut short by stop()
+        bool playGame(uint64_t game, const SelfPlaySettings& settings, Board& board, MoveGenerator& moveGenerator,
+                      Search& search, std::vector<uint8_t>& records);
+
+        bool writeGame(const std::vector<uint8_t>& records);
+
+    public:
+        SelfPlayFarm();
+        ~SelfPlayFarm();
+
+        // Creates the file, or reopens one from an earlier run: a partial game at its end is cut off and
+        // the games in it are not played again
+        bool open(const std::string& path);
+        void close();
+
+        uint64_t getResumedGames();
+        uint64_t getResumedPositions();
+
+        // Plays games until the file holds settings.games of them or stop() is called. onProgress, if
+        // given, is called on the calling thread every reportSeconds with the counts of each worker.
+        bool run(const SelfPlaySettings& settings, const std::function<void(const std::vector<SelfPlayWorkerStats>&)>& onProgress = nullptr,
+                 double reportSeconds = 10);
+
+        // Safe from any thread and from a signal handler: games in progress are dropped, finished ones are kept
+        void stop();
+
+        // Copy constructor and copy assignment operators should not be allowed
+        SelfPlayFarm(const SelfPlayFarm&) = delete;
+        SelfPlayFarm& operator=(const SelfPlayFarm&) = delete;
+
+};
+
+SelfPlayFarm::SelfPlayFarm()
+    : file(nullptr), writeFailed(false), resumedGames(0), resumedPositions(0), nextGame(0), stopRequested(false), workerCount(0) {}
+
+SelfPlayFarm::~SelfPlayFarm() {
+    close();
+}
+
+bool SelfPlayFarm::open(const std::string& path) {
+
+    close();
+    finished.clear();
+    resumedGames = resumedPositions = 0;
+
+    std::error_code error;
+    uintmax_t size = std::filesystem::exists(path, error) ? std::filesystem::file_size(path, error) : 0;
+
+    if (size == 0) {
+        file = fopen(path.c_str(), "wb");
+        if (!file) {
+            std::cerr << "Unable to create " << path << std::endl;
+            return false;
+        }
+        uint8_t header[SELFPLAY_HEADER_SIZE] = {};
+        memcpy(header, SELFPLAY_MAGIC, sizeof(SELFPLAY_MAGIC));
+        header[8] = SELFPLAY_RECORD_SIZE;
+        return fwrite(header, 1, sizeof(header), file) == sizeof(header) && fflush(file) == 0;
+    }
+
+    // Find where the last complete game ends, and which games the file already has
+    size_t keep = SELFPLAY_HEADER_SIZE;
+    {
+        MappedFile existing;
+        if (!existing.open(path)) return false;
+        existing.adviseSequential();
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(existing.getData());
+
+        if (existing.getSize() < static_cast<size_t>(SELFPLAY_HEADER_SIZE) || memcmp(data, SELFPLAY_MAGIC, sizeof(SELFPLAY_MAGIC)) != 0
+            || data[8] != SELFPLAY_RECORD_SIZE) {
+            std::cerr << path << " is not a self-play file" << std::endl;
+            return false;
+        }
+
+        uint64_t positions = 0;
+        for (size_t offset = SELFPLAY_HEADER_SIZE; offset + SELFPLAY_RECORD_SIZE <= existing.getSize(); offset += SELFPLAY_RECORD_SIZE) {
+            const uint8_t* record = data + offset;
+            positions++;
+            if (!(record[35] & 1)) continue;
+
+            uint32_t game = 0;
+            for (int i = 0; i < 4; i++) game |= static_cast<uint32_t>(record[36 + i]) << (8 * i);
+            if (game >= finished.size()) finished.resize(game + 1, false);
+            if (!finished[game]) resumedGames++;
+            finished[game] = true;
+
+            keep = offset + SELFPLAY_RECORD_SIZE;
+            resumedPositions = positions;
+        }
+    }
+
+    if (keep != size) {
+        std::filesystem::resize_file(path, keep, error);
+        if (error) {
+            std::cerr << "Unable to truncate " << path << std::endl;
+            return false;
+        }
+    }
+
+    file = fopen(path.c_str(), "ab");
+    if (!file) std::cerr << "Unable to open " << path << std::endl;
+    return file != nullptr;
+
+}
+
+void SelfPlayFarm::close() {
+    if (file) fclose(file);
+    file = nullptr;
+}
+
+uint64_t SelfPlayFarm::getResumedGames() {
+    return resumedGames;
+}
+
+uint64_t SelfPlayFarm::getResumedPositions() {
+    return resumedPositions;
+}
+
+void SelfPlayFarm::stop() {
+    stopRequested = true;
+}
+
+bool SelfPlayFarm::claimGame(uint64_t limit, uint64_t& game) {
+    for (game = nextGame++; game < limit; game = nextGame++) {
+        if (game >= finished.size() || !finished[game]) return !stopRequested;
+    }
+    return false;
+}
+
+bool SelfPlayFarm::run(const SelfPlaySettings& settings, const std::function<void(const std::vector<SelfPlayWorkerStats>&)>& onProgress,
+                       double reportSeconds) {
+
+    if (!file) return false;
+
+    workerCount = settings.threads > 0 ? settings.threads : std::max(1u, std::thread::hardware_concurrency());
+    counters.reset(new WorkerCounters[workerCount]);
+    nextGame = 0;
+    writeFailed = false;
+
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+    int running = workerCount;
+
+    auto worker = [&](int index) {
+
+        Board board = prototype;
+        MoveGenerator moveGenerator(board);
+        Search search(board);
+        std::vector<uint8_t> records;
+
+        uint64_t game;
+        while (claimGame(settings.games, game)) {
+            if (!playGame(game, settings, board, moveGenerator, search, records)) break;
+            if (!writeGame(records)) break;
+            counters[index].games++;
+            counters[index].positions += records.size() / SELFPLAY_RECORD_SIZE;
+        }
+
+        std::lock_guard<std::mutex> lock(doneMutex);
+        running--;
+        doneCondition.notify_all();
+
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workerCount; i++) threads.emplace_back(worker, i);
+
+    auto snapshot = [this]() {
+        std::vector<SelfPlayWorkerStats> stats(workerCount);
+        for (int i = 0; i < workerCount; i++) stats[i] = {counters[i].games.load(), counters[i].positions.load()};
+        return stats;
+    };
+
+    // The calling thread only reports progress
+    {
+        std::unique_lock<std::mutex> lock(doneMutex);
+        auto interval = std::chrono::duration<double>(reportSeconds);
+        while (!doneCondition.wait_for(lock, interval, [&running]() { return running == 0; })) {
+            if (!onProgress) continue;
+            lock.unlock();
+            onProgress(snapshot());
+            lock.lock();
+        }
+    }
+
+    for (std::thread& thread : threads) thread.join();
+    if (onProgress) onProgress(snapshot());
+    return !writeFailed;
+
+}
+
+bool SelfPlayFarm::playGame(uint64_t game, const SelfPlaySettings& settings, Board& board, MoveGenerator& moveGenerator,
+                            Search& search, std::vector<uint8_t>& records) {
+
+    std::mt19937_64 random(settings.seed * 0x9E3779B97F4A7C15ULL + game);
+    std::vector<Move> moves;
+    std::vector<SelfPlayRecord> positions;
+    std::vector<U64> keys;
+    GameResult result = GameResult::UNKNOWN;
+
+    SearchLimits limits;
+    limits.maxNodes = settings.nodes;
+    limits.cancel = &stopRequested;
+
+    Position start;
+    prototype.savePosition(start);
+
+    // Random openings until one survives them with moves left to play
+    int ply;
+    do {
+        board.loadPosition(start);
+        for (ply = 0; ply < settings.randomPlies; ply++) {
+            moveGenerator.generateLegalMoves(moves);
+            if (moves.empty()) break;
+            const Move& move = moves[random() % moves.size()];
+            board.executeMove(move.piece, move.fromPos, move.toPos, move.promotion);
+        }
+        moveGenerator.generateLegalMoves(moves);
+    } while (moves.empty());
+
+    keys.push_back(polyglotKey(board));
+
+    for (; result == GameResult::UNKNOWN; ply++) {
+
+        moveGenerator.generateLegalMoves(moves);
+        moveGenerator.updatePieces();
+        bool inCheck = moveGenerator.isKingInCheck(board.isWhiteToMove());
+
+        if (moves.empty()) {
+            result = !inCheck ? GameResult::DRAW : board.isWhiteToMove() ? GameResult::BLACK_WIN : GameResult::WHITE_WIN;
+            break;
+        }
+
+        // Fifty moves, threefold repetition, bare kings or a lone minor piece, or a game gone on too long
+        if (isDrawnByRule(board, std::count(keys.begin(), keys.end(), keys.back())) || ply >= settings.maxPlies) {
+            result = GameResult::DRAW;
+            break;
+        }
+
+        Position position;
+        board.savePosition(position);
+        SearchResult searched = search.run(position, limits);
+        if (stopRequested) return false;
+
+        // Quiet positions only: the evaluation is not meant to see through checks and captures
+        const Move& move = searched.bestMove;
+        bool capture = board.getPieceAtPosition(move.toPos) != PieceType::EMPTY
+                       || ((move.piece == PieceType::WP || move.piece == PieceType::BP) && move.toPos == board.getEnPassantSquare());
+        if (!inCheck && !capture && move.promotion == PieceType::EMPTY && !isMateScore(searched.score)) {
+            int score = board.isWhiteToMove() ? searched.score : -searched.score;
+            positions.push_back({position, score, GameResult::UNKNOWN, false, static_cast<uint32_t>(game)});
+        }
+
+        board.executeMove(move.piece, move.fromPos, move.toPos, move.promotion);
+
+        // Repetitions can only reach back to the last capture or pawn move
+        if (board.getHalfmoveClock() == 0) keys.clear();
+        keys.push_back(polyglotKey(board));
+    }
+
+    records.resize(positions.size() * SELFPLAY_RECORD_SIZE);
+    for (size_t i = 0; i < positions.size(); i++) {
+        positions[i].result = result;
+        positions[i].lastOfGame = i + 1 == positions.size();
+        packSelfPlayRecord(positions[i], records.data() + i * SELFPLAY_RECORD_SIZE);
+    }
+    return true;
+
+}
+
+bool SelfPlayFarm::writeGame(const std::vector<uint8_t>& records) {
+
+    std::lock_guard<std::mutex> lock(fileMutex);
+    if (writeFailed) return false;
+
+    // Flushed game by game, so that an interruption loses no more than the games being played
+    if (fwrite(records.data(), 1, records.size(), file) != records.size() || fflush(file) != 0) {
+        std::cerr << "Unable to write self-play records" << std::endl;
+        writeFailed = true;
+    }
+    return !writeFailed;
+
+}
+
+#endif // SELFPLAY_HPP
@@ -0,0 +1,44 @@
+#ifndef SNAPSHOTBUFFER_HPP
+#define SNAPSHOTBUFFER_HPP
+
+#include <atomic>
+
+// Lock-free hand-over of the latest value from one producer thread to one consumer thread (a triple
+// buffer). The producer always has a slot of its own to write into and the consumer always has one to
+// read from, so neither ever waits for the other; values the consumer did not get to in time are simply
+// replaced by newer ones. T should be cheap to copy and must not allocate if publish is to stay lock-free.
+template <typename T>
+class SnapshotBuffer {
+
+    private:
+        static const int FRESH = 4;     // set on the shared slot index while it holds an unread value
+
+        T slots[3];
+        std::atomic<int> shared;        // slot index passed between the two sides, plus FRESH
+        int writing;                    // producer's slot
+        int reading;                    // consumer's slot
+
+    public:
+        SnapshotBuffer() : shared(1), writing(0), reading(2) {}
+
+        // Producer side
+        void publish(const T& value) {
+            slots[writing] = value;
+            writing = shared.exchange(writing | FRESH, std::memory_order_acq_rel) & ~FRESH;
+        }
+
+        // Consumer side: the latest value, or false if nothing was published since the last read
+        bool read(T& value) {
+            if ((shared.load(std::memory_order_relaxed) & FRESH) == 0) return false;
+            reading = shared.exchange(reading, std::memory_order_acq_rel) & ~FRESH;
+            value = slots[reading];
+            return true;
+        }
+
+        // Copy constructor and copy assignment operators should not be allowed
+        SnapshotBuffer(const SnapshotBuffer&) = delete;
+        SnapshotBuffer& operator=(const SnapshotBuffer&) = delete;
+
+};
+
+#endif // SNAPSHOTBUFFER_HPP
@@ -0,0 +1,364 @@
+#ifndef TABLEBASE_HPP
+#define TABLEBASE_HPP
+
+#include <Board.hpp>
+#include <MappedFile.hpp>
+#include <PieceType.hpp>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// Endgame tablebases: win / draw / loss and distance to mate for every position of a material
+// combination with up to TABLEBASE_MAX_PIECES pieces (kings included), written by TablebaseGenerator.
+const int TABLEBASE_MAX_PIECES = 4;
+
+// Piece letters in the order they are listed in a material name, strongest first
+const char TABLEBASE_PIECE_ORDER[] = "QRBNP";
+
+// Tablebase files, one per material and named after it (e.g. KRKP.bbtb), are mapped and probed in place:
+//   bytes 0-7    "BBTBASE1"
+//   bytes 8-15   material name, null padded (white pieces, then black pieces; white has the stronger set)
+//   bytes 16-23  positions per side to move (little endian)
+//   byte  24     bits per distance entry
+//   bytes 25-31  reserved
+//   then for white to move and then black to move:
+//     the result of every position, 2 bits each, 4 to the byte (see TablebaseResult)
+//     the distance to mate in plies of every position, packed at the given number of bits (0 unless won or lost)
+//   each array padded to a multiple of 8 bytes
+const char TABLEBASE_MAGIC[8] = {'B', 'B', 'T', 'B', 'A', 'S', 'E', '1'};
+const int TABLEBASE_HEADER_SIZE = 32;
+const char* const TABLEBASE_EXTENSION = ".bbtb";
+
+// For the side to move, in the order of the file codes
+enum class TablebaseResult {
+    DRAW, WIN, LOSS, INVALID
+};
+
+struct TablebaseEntry {
+    TablebaseResult result;
+    int distance;               // plies to mate, for WIN and LOSS
+};
+
+// The pieces a table covers, in index order: white king, black king, then the other white pieces and the
+// other black pieces, each strongest first
+struct TablebaseMaterial {
+    std::string name;
+    int count;
+    PieceType pieces[TABLEBASE_MAX_PIECES];
+    bool hasPawns;
+    uint64_t positions;         // per side to move, illegal ones included
+};
+
+uint64_t tablebaseResultBytes(uint64_t positions) {
+    return ((positions + 3) / 4 + 7) & ~7ULL;
+}
+
+// One spare byte, as entries are read two bytes at a time
+uint64_t tablebaseDistanceBytes(uint64_t positions, int bits) {
+    return ((positions * bits + 7) / 8 + 1 + 7) & ~7ULL;
+}
+
+PieceType swapPieceColour(PieceType type) {
+    return static_cast<PieceType>((static_cast<int>(type) + 6) % 12);
+}
+
+// Canonical name of a set of pieces ("KRKP"), the stronger side first. flipped is set when black has the
+// stronger pieces, in which case the table holds the position with colours swapped and the board mirrored.
+std::string tablebaseMaterialName(const PieceType* types, int count, bool& flipped) {
+
+    std::string white, black;
+    for (const char* letter = TABLEBASE_PIECE_ORDER; *letter; letter++) {
+        for (int i = 0; i < count; i++) {
+            if (pieceTypeToChar(types[i]) == *letter) white += *letter;
+            else if (pieceTypeToChar(types[i]) == *letter - 'A' + 'a') black += *letter;
+        }
+    }
+
+    // More pieces is stronger, otherwise the first stronger piece decides
+    flipped = black.size() > white.size();
+    if (black.size() == white.size()) {
+        for (size_t i = 0; i < white.size() && !flipped; i++) {
+            if (white[i] == black[i]) continue;
+            flipped = std::strchr(TABLEBASE_PIECE_ORDER, black[i]) < std::strchr(TABLEBASE_PIECE_ORDER, white[i]);
+            break;
+        }
+    }
+
+    return flipped ? "K" + black + "K" + white : "K" + white + "K" + black;
+
+}
+
+// Parses a material such as "KRKP" (or "KPKR", which is stored as KRKP), false if it is not one a table
+// could cover
+bool parseTablebaseMaterial(const std::string& text, TablebaseMaterial& material) {
+
+    if (text.size() < 2 || text.size() > static_cast<size_t>(TABLEBASE_MAX_PIECES) || text[0] != 'K') return false;
+    size_t blackKing = text.find('K', 1);
+    if (blackKing == std::string::npos || text.find('K', blackKing + 1) != std::string::npos) return false;
+
+    PieceType types[TABLEBASE_MAX_PIECES];
+    int count = 0;
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] != 'K' && !std::strchr(TABLEBASE_PIECE_ORDER, text[i])) return false;
+        PieceType type = pieceTypeFromChar(text[i]);
+        types[count++] = i < blackKing ? type : swapPieceColour(type);
+    }
+
+    bool flipped;
+    material.name = tablebaseMaterialName(types, count, flipped);
+    material.count = count;
+    material.hasPawns = material.name.find('P') != std::string::npos;
+
+    // Kings first, then the rest of the name in order
+    size_t weakKing = material.name.find('K', 1);
+    int slot = 0;
+    material.pieces[slot++] = PieceType::WK;
+    material.pieces[slot++] = PieceType::BK;
+    for (size_t i = 1; i < material.name.size(); i++) {
+        if (i == weakKing) continue;
+        PieceType type = pieceTypeFromChar(material.name[i]);
+        material.pieces[slot++] = i < weakKing ? type : swapPieceColour(type);
+    }
+
+    // The white king is confined to 10 squares by symmetry (a quarter of the board below the diagonal),
+    // or to 32 when pawns only allow mirroring the files
+    material.positions = material.hasPawns ? 32 : 10;
+    for (int i = 1; i < count; i++) material.positions *= 64;
+
+    return true;
+
+}
+
+int mirrorDiagonal(int square) {
+    return (square % 8) * 8 + square / 8;
+}
+
+// Index of a position, squares given in material order. Applies the symmetry that brings the white king
+// into the part of the board the table covers.
+uint64_t tablebaseIndex(const TablebaseMaterial& material, const int* squares) {
+
+    int king = squares[0];
+    int mirror = 0;
+    bool diagonal = false;
+
+    if (king % 8 > 3) mirror ^= 7;
+    if (!material.hasPawns) {
+        if (king / 8 > 3) mirror ^= 56;
+        king ^= mirror;
+        diagonal = king / 8 > king % 8;
+    }
+
+    uint64_t index = 0;
+    for (int i = 0; i < material.count; i++) {
+        int square = squares[i] ^ mirror;
+        if (diagonal) square = mirrorDiagonal(square);
+
+        if (i > 0) {
+            index = index * 64 + square;
+        } else if (material.hasPawns) {
+            index = (square / 8) * 4 + square % 8;
+        } else {
+            // Rows of the triangle hold 4, 3, 2 and 1 squares
+            int rank = square / 8, file = square % 8;
+            index = rank * 4 - rank * (rank - 1) / 2 + file - rank;
+        }
+    }
+
+    return index;
+
+}
+
+// Inverse of tablebaseIndex, without the symmetry
+void tablebaseSquares(const TablebaseMaterial& material, uint64_t index, int* squares) {
+
+    for (int i = material.count - 1; i > 0; i--) {
+        squares[i] = static_cast<int>(index % 64);
+        index /= 64;
+    }
+
+    static const int TRIANGLE[10] = {0, 1, 2, 3, 9, 10, 11, 18, 19, 27};
+    squares[0] = material.hasPawns ? static_cast<int>(index / 4) * 8 + static_cast<int>(index % 4) : TRIANGLE[index];
+
+}
+
+// Squares of the pieces in material order, matched by type from the pieces as given (colours swapped and
+// the board mirrored when flipped)
+void tablebaseSlotSquares(const TablebaseMaterial& material, const PieceType* types, const int* squares, int count,
+                          bool flipped, int* slotSquares) {
+
+    bool used[TABLEBASE_MAX_PIECES] = {false};
+
+    for (int slot = 0; slot < material.count; slot++) {
+        for (int i = 0; i < count; i++) {
+            PieceType type = flipped ? swapPieceColour(types[i]) : types[i];
+            if (used[i] || type != material.pieces[slot]) continue;
+            used[i] = true;
+            slotSquares[slot] = flipped ? squares[i] ^ 56 : squares[i];
+            break;
+        }
+    }
+
+}
+
+TablebaseResult readTablebaseResult(const uint8_t* results, uint64_t index) {
+    return static_cast<TablebaseResult>((results[index / 4] >> (2 * (index % 4))) & 3);
+}
+
+int readTablebaseDistance(const uint8_t* distances, uint64_t index, int bits) {
+    uint64_t bit = index * bits;
+    unsigned word = distances[bit / 8] | (distances[bit / 8 + 1] << 8);
+    return (word >> (bit % 8)) & ((1 << bits) - 1);
+}
+
+// Read-only, memory-mapped tablebase files. Every table is mapped up front, so probing never touches the
+// file system and is safe from any number of threads.
+class Tablebases {
+
+    private:
+        struct Table {
+            TablebaseMaterial material;
+            MappedFile file;
+            const uint8_t* results[2];      // white to move, black to move
+            const uint8_t* distances[2];
+            int distanceBits;
+        };
+
+        std::unordered_map<std::string, std::unique_ptr<Table>> tables;
+        int maxPieces;
+
+    public:
+        Tablebases();
+
+        // Maps every tablebase file in the directory, returns how many were found
+        int open(const std::string& directory);
+        bool addTable(const std::string& path);
+
+        size_t getTableCount() const;
+
+        // Most pieces (kings included) of any table loaded, 0 when there are none
+        int getMaxPieces() const;
+
+        // Result for the side to move. False when no table covers the position, which includes positions
+        // with castling rights or an en passant capture on the board.
+        bool probe(const Position& position, TablebaseEntry& entry) const;
+
+        // Copy constructor and copy assignment operators should not be allowed
+        Tablebases(const Tablebases&) = delete;
+        Tablebases& operator=(const Tablebases&) = delete;
+
+};
+
+Tablebases::Tablebases() : maxPieces(0) {}
+
+int Tablebases::open(const std::string& directory) {
+
+    std::error_code error;
+    std::filesystem::directory_iterator entries(directory, error);
+    if (error) {
+        std::cerr << "Unable to read tablebase directory " << directory << std::endl;
+        return 0;
+    }
+
+    int found = 0;
+    for (const auto& entry : entries) {
+        if (entry.path().extension() == TABLEBASE_EXTENSION && addTable(entry.path().string())) found++;
+    }
+    return found;
+
+}
+
+bool Tablebases::addTable(const std::string& path) {
+
+    std::unique_ptr<Table> table(new Table());
+    if (!table->file.open(path)) return false;
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(table->file.getData());
+    size_t size = table->file.getSize();
+
+    bool valid = size >= static_cast<size_t>(TABLEBASE_HEADER_SIZE) && memcmp(data, TABLEBASE_MAGIC, sizeof(TABLEBASE_MAGIC)) == 0;
+
+    uint64_t positions = 0;
+    if (valid) {
+        std::string name(reinterpret_cast<const char*>(data) + 8, strnlen(reinterpret_cast<const char*>(data) + 8, 8));
+        for (int i = 0; i < 8; i++) positions |= static_cast<uint64_t>(data[16 + i]) << (8 * i);
+        table->distanceBits = data[24];
+
+        valid = parseTablebaseMaterial(name, table->material) && table->material.name == name
+                && table->material.positions == positions && table->distanceBits >= 1 && table->distanceBits <= 8
+                && size == TABLEBASE_HEADER_SIZE + 2 * (tablebaseResultBytes(positions) + tablebaseDistanceBytes(positions, table->distanceBits));
+    }
+
+    if (!valid) {
+        std::cerr << path << " is not a tablebase" << std::endl;
+        return false;
+    }
+
+    const uint8_t* next = data + TABLEBASE_HEADER_SIZE;
+    for (int side = 0; side < 2; side++) {
+        table->results[side] = next;
+        next += tablebaseResultBytes(positions);
+        table->distances[side] = next;
+        next += tablebaseDistanceBytes(positions, table->distanceBits);
+    }
+
+    maxPieces = std::max(maxPieces, table->material.count);
+    tables[table->material.name] = std::move(table);
+    return true;
+
+}
+
+size_t Tablebases::getTableCount() const {
+    return tables.size();
+}
+
+int Tablebases::getMaxPieces() const {
+    return maxPieces;
+}
+
+bool Tablebases::probe(const Position& position, TablebaseEntry& entry) const {
+
+    if (position.castlingRights) return false;
+
+    PieceType types[TABLEBASE_MAX_PIECES];
+    int squares[TABLEBASE_MAX_PIECES];
+    int count = 0;
+
+    for (int type = 0; type < 12; type++) {
+        U64 pieces = position.bitboards[type];
+        while (pieces) {
+            if (count == maxPieces) return false;
+            types[count] = static_cast<PieceType>(type);
+            squares[count++] = findLSBIndex(pieces);
+            pieces &= pieces - 1;
+        }
+    }
+
+    // Tables hold no en passant rights, so they only answer if the capture is not actually on
+    if (position.enPassantSquare >= 0) {
+        int pawnSquare = position.whiteToMove ? position.enPassantSquare - 8 : position.enPassantSquare + 8;
+        int file = position.enPassantSquare % 8;
+        U64 capturers = (file > 0 ? 1ULL << (pawnSquare - 1) : 0) | (file < 7 ? 1ULL << (pawnSquare + 1) : 0);
+        if (position.bitboards[static_cast<int>(position.whiteToMove ? PieceType::WP : PieceType::BP)] & capturers) return false;
+    }
+
+    bool flipped;
+    auto found = tables.find(tablebaseMaterialName(types, count, flipped));
+    if (found == tables.end()) return false;
+    const Table& table = *found->second;
+
+    int slotSquares[TABLEBASE_MAX_PIECES];
+    tablebaseSlotSquares(table.material, types, squares, count, flipped, slotSquares);
+    uint64_t index = tablebaseIndex(table.material, slotSquares);
+    int side = position.whiteToMove != flipped ? 0 : 1;
+
+    entry.result = readTablebaseResult(table.results[side], index);
+    entry.distance = entry.result == TablebaseResult::WIN || entry.result == TablebaseResult::LOSS
+                     ? readTablebaseDistance(table.distances[side], index, table.distanceBits) : 0;
+    return entry.result != TablebaseResult::INVALID;
+
+}
+
+#endif // TABLEBASE_HPP
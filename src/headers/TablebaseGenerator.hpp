@@ -0,0 +1,678 @@
+#ifndef TABLEBASEGENERATOR_HPP
+#define TABLEBASEGENERATOR_HPP
+
+#include <Attacks.hpp>
+#include <Bitbase.hpp>
+#include <Tablebase.hpp>
+#include <BitOperations.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <thread>
+#include <vector>
+
+// A position of a table being generated. Pieces start out in material order; a capture removes one.
+struct TablebaseBoard {
+    int count;
+    PieceType types[TABLEBASE_MAX_PIECES];
+    int squares[TABLEBASE_MAX_PIECES];
+    bool whiteToMove;
+};
+
+struct TablebaseStats {
+    std::string name;
+    uint64_t positions;         // both sides to move, illegal ones included
+    uint64_t wins;              // legal positions won, drawn and lost for the side to move
+    uint64_t draws;
+    uint64_t losses;
+    int maxDistance;            // longest mate in plies
+    int iterations;
+    double seconds;
+};
+
+// Generates tablebases by retrograde analysis. Starting from the mates, every pass resolves the positions
+// one ply further from mate: a position is won in n plies if a move reaches a position lost in n - 1, and
+// lost in n if every move reaches a position won in at most n - 1. Whatever is left when the passes stop
+// finding anything is a draw. Captures and promotions lead into smaller tables, which are generated first.
+//
+// Each pass is split across threads by index. Results of a pass are only applied once every thread is done
+// with it, so the threads only ever read and never write the shared tables.
+class TablebaseGenerator {
+
+    private:
+        // Entry states while generating: the distance to mate in plies (odd when the side to move mates,
+        // even when it is mated), or one of these
+        static constexpr uint8_t UNKNOWN = 255;
+        static constexpr uint8_t ILLEGAL = 254;
+        static constexpr uint8_t DRAWN = 253;
+        static constexpr int MAX_DISTANCE = 252;
+
+        struct Table {
+            TablebaseMaterial material;
+            std::vector<uint8_t> states[2];     // white to move, black to move
+            int maxDistance;
+        };
+
+        int threadCount;
+        std::map<std::string, std::unique_ptr<Table>> tables;
+        std::vector<TablebaseStats> stats;
+
+        U64 attacks(PieceType type, int square, U64 occupied);
+        bool isAttacked(const TablebaseBoard& board, int square, bool byWhite);
+        bool isInCheck(const TablebaseBoard& board, bool white);
+
+        // Calls visit(child, sameMaterial, enPassant) for every legal move until it returns false.
+        // sameMaterial children keep their pieces in the same order, enPassant is the target square a
+        // double pawn push leaves when the opponent has a pawn next to it (-1 otherwise).
+        template <typename Visit>
+        bool forEachChild(const TablebaseBoard& board, int enPassant, Visit visit);
+
+        uint8_t childState(const Table& table, const TablebaseBoard& child, bool sameMaterial, int enPassant);
+        bool decode(const Table& table, int side, uint64_t index, TablebaseBoard& board);
+
+        Table* require(const std::string& name, const std::string& directory, bool& written);
+
+        void addPredecessors(const Table& table, const TablebaseBoard& board, std::vector<uint32_t>& indices);
+        void build(Table& table);
+        bool write(const Table& table, const std::string& path);
+
+        // Runs work over [0, count) in chunks on every thread, giving each call its thread's number
+        void parallelFor(uint64_t count, const std::function<void(uint64_t, uint64_t, int)>& work);
+
+    public:
+        TablebaseGenerator(int threadCount);
+
+        // Generates the table for the material (e.g. "KRKP") and the tables it leads into, and writes every
+        // one of them to the directory. Tables already generated by this generator are reused.
+        bool generate(const std::string& material, const std::string& directory);
+
+        // Writes the bitbase (see Bitbase.hpp) of a material generated before. Fails for materials in which
+        // the weaker side wins some positions, as a bitbase cannot tell those from draws.
+        bool writeBitbase(const std::string& material, const std::string& path);
+
+        // One entry per table generated, in order
+        const std::vector<TablebaseStats>& getStats();
+
+        // Copy constructor and copy assignment operators should not be allowed
+        TablebaseGenerator(const TablebaseGenerator&) = delete;
+        TablebaseGenerator& operator=(const TablebaseGenerator&) = delete;
+
+};
+
+TablebaseGenerator::TablebaseGenerator(int threads) : threadCount(std::max(1, threads)) {}
+
+const std::vector<TablebaseStats>& TablebaseGenerator::getStats() {
+    return stats;
+}
+
+// Squares attacked by a piece. Pawns only attack diagonally; their pushes are generated separately.
+U64 TablebaseGenerator::attacks(PieceType type, int square, U64 occupied) {
+
+    U64 piece = 1ULL << square;
+    switch (type) {
+        case PieceType::WK: case PieceType::BK: return kingAttacksOf(piece);
+        case PieceType::WN: case PieceType::BN: return knightAttacksOf(piece);
+        case PieceType::WP: case PieceType::BP: return pawnAttacksOf(piece, type == PieceType::WP);
+        case PieceType::WR: case PieceType::BR: return orthogonalAttacks(piece, ~occupied);
+        case PieceType::WB: case PieceType::BB: return diagonalAttacks(piece, ~occupied);
+        default: return orthogonalAttacks(piece, ~occupied) | diagonalAttacks(piece, ~occupied);
+    }
+
+}
+
+bool TablebaseGenerator::isAttacked(const TablebaseBoard& board, int square, bool byWhite) {
+
+    U64 occupied = 0;
+    for (int i = 0; i < board.count; i++) occupied |= 1ULL << board.squares[i];
+
+    for (int i = 0; i < board.count; i++) {
+        if (isWhitePiece(board.types[i]) != byWhite) continue;
+        if (attacks(board.types[i], board.squares[i], occupied) & (1ULL << square)) return true;
+    }
+    return false;
+
+}
+
+bool TablebaseGenerator::isInCheck(const TablebaseBoard& board, bool white) {
+    PieceType king = white ? PieceType::WK : PieceType::BK;
+    for (int i = 0; i < board.count; i++) {
+        if (board.types[i] == king) return isAttacked(board, board.squares[i], !white);
+    }
+    return false;
+}
+
+template <typename Visit>
+bool TablebaseGenerator::forEachChild(const TablebaseBoard& board, int enPassant, Visit visit) {
+
+    bool white = board.whiteToMove;
+    U64 own = 0, other = 0;
+    for (int i = 0; i < board.count; i++) {
+        if (isWhitePiece(board.types[i]) == white) own |= 1ULL << board.squares[i];
+        else other |= 1ULL << board.squares[i];
+    }
+    U64 occupied = own | other;
+
+    const PieceType promotions[4] = {
+        white ? PieceType::WQ : PieceType::BQ, white ? PieceType::WR : PieceType::BR,
+        white ? PieceType::WB : PieceType::BB, white ? PieceType::WN : PieceType::BN
+    };
+
+    for (int slot = 0; slot < board.count; slot++) {
+
+        PieceType type = board.types[slot];
+        if (isWhitePiece(type) != white) continue;
+        int from = board.squares[slot];
+        bool isPawn = type == PieceType::WP || type == PieceType::BP;
+
+        U64 targets;
+        if (isPawn) {
+            int forward = white ? 8 : -8;
+            targets = attacks(type, from, occupied) & (other | (enPassant >= 0 ? 1ULL << enPassant : 0));
+            if (!(occupied & (1ULL << (from + forward)))) {
+                targets |= 1ULL << (from + forward);
+                bool onStart = white ? from / 8 == 1 : from / 8 == 6;
+                if (onStart && !(occupied & (1ULL << (from + 2 * forward)))) targets |= 1ULL << (from + 2 * forward);
+            }
+        } else {
+            targets = attacks(type, from, occupied) & ~own;
+        }
+
+        while (targets) {
+            int to = findLSBIndex(targets);
+            targets &= targets - 1;
+
+            TablebaseBoard child = board;
+            child.whiteToMove = !white;
+            child.squares[slot] = to;
+
+            // Take off the captured piece, which stands behind the target square for en passant
+            int capturedSquare = isPawn && to == enPassant ? to + (white ? -8 : 8) : to;
+            bool isCapture = false;
+            for (int i = 0; i < child.count; i++) {
+                if (i == slot || child.squares[i] != capturedSquare) continue;
+                for (int j = i; j < child.count - 1; j++) {
+                    child.types[j] = child.types[j + 1];
+                    child.squares[j] = child.squares[j + 1];
+                }
+                child.count--;
+                isCapture = true;
+                break;
+            }
+
+            int movedSlot = slot;
+            for (int i = 0; i < child.count; i++) {
+                if (child.squares[i] == to && isWhitePiece(child.types[i]) == white) movedSlot = i;
+            }
+            if (isInCheck(child, white)) continue;
+
+            // The double push only leaves an en passant target when there is a pawn to use it
+            int childEnPassant = -1;
+            if (isPawn && (to - from == 16 || from - to == 16)) {
+                PieceType enemyPawn = white ? PieceType::BP : PieceType::WP;
+                for (int i = 0; i < child.count; i++) {
+                    int square = child.squares[i];
+                    if (child.types[i] == enemyPawn && square / 8 == to / 8 && (square - to == 1 || to - square == 1)) {
+                        childEnPassant = (from + to) / 2;
+                    }
+                }
+            }
+
+            if (isPawn && (to / 8 == 7 || to / 8 == 0)) {
+                for (PieceType promotion : promotions) {
+                    child.types[movedSlot] = promotion;
+                    if (!visit(child, false, -1)) return false;
+                }
+            } else if (!visit(child, !isCapture, childEnPassant)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+
+}
+
+// State of a child position for its side to move. A child with an en passant target is not in any table,
+// so it is worked out from its own children, as far as they are known.
+uint8_t TablebaseGenerator::childState(const Table& table, const TablebaseBoard& child, bool sameMaterial, int enPassant) {
+
+    if (enPassant >= 0) {
+
+        bool hasMove = false, allWon = true;
+        int shortestLoss = -1, longestWin = 0;
+
+        forEachChild(child, enPassant, [&](const TablebaseBoard& next, bool nextSameMaterial, int nextEnPassant) {
+            hasMove = true;
+            uint8_t state = childState(table, next, nextSameMaterial, nextEnPassant);
+            if (state <= MAX_DISTANCE && state % 2 == 0) {
+                if (shortestLoss < 0 || state < shortestLoss) shortestLoss = state;
+            } else if (state <= MAX_DISTANCE) {
+                longestWin = std::max<int>(longestWin, state);
+            } else {
+                allWon = false;
+            }
+            return true;
+        });
+
+        if (!hasMove) return isInCheck(child, child.whiteToMove) ? 0 : DRAWN;
+        if (shortestLoss >= 0) return static_cast<uint8_t>(shortestLoss + 1);
+        return allWon ? static_cast<uint8_t>(longestWin + 1) : UNKNOWN;
+    }
+
+    if (sameMaterial) return table.states[child.whiteToMove ? 0 : 1][tablebaseIndex(table.material, child.squares)];
+
+    // Bare kings
+    if (child.count == 2) return DRAWN;
+
+    bool flipped;
+    const Table& smaller = *tables.at(tablebaseMaterialName(child.types, child.count, flipped));
+    int slotSquares[TABLEBASE_MAX_PIECES];
+    tablebaseSlotSquares(smaller.material, child.types, child.squares, child.count, flipped, slotSquares);
+    return smaller.states[child.whiteToMove != flipped ? 0 : 1][tablebaseIndex(smaller.material, slotSquares)];
+
+}
+
+// Board of an index, false if it is not a legal position: pieces on the same square, pawns on the first
+// or last rank, or the side that just moved in check
+bool TablebaseGenerator::decode(const Table& table, int side, uint64_t index, TablebaseBoard& board) {
+
+    const TablebaseMaterial& material = table.material;
+    board.count = material.count;
+    board.whiteToMove = side == 0;
+    tablebaseSquares(material, index, board.squares);
+
+    U64 occupied = 0;
+    for (int i = 0; i < material.count; i++) {
+        board.types[i] = material.pieces[i];
+        U64 square = 1ULL << board.squares[i];
+        if (occupied & square) return false;
+        occupied |= square;
+
+        bool isPawn = board.types[i] == PieceType::WP || board.types[i] == PieceType::BP;
+        if (isPawn && (board.squares[i] / 8 == 0 || board.squares[i] / 8 == 7)) return false;
+    }
+
+    return !isInCheck(board, !board.whiteToMove);
+
+}
+
+void TablebaseGenerator::parallelFor(uint64_t count, const std::function<void(uint64_t, uint64_t, int)>& work) {
+
+    const uint64_t chunk = 1 << 14;
+    std::atomic<uint64_t> next(0);
+
+    auto run = [&](int worker) {
+        while (true) {
+            uint64_t begin = next.fetch_add(chunk);
+            if (begin >= count) return;
+            work(begin, std::min(count, begin + chunk), worker);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threadCount; i++) workers.emplace_back(run, i);
+    run(0);
+    for (std::thread& worker : workers) worker.join();
+
+}
+
+// Indices of the positions (same material, other side to move) that a move could have reached the board from
+void TablebaseGenerator::addPredecessors(const Table& table, const TablebaseBoard& board, std::vector<uint32_t>& indices) {
+
+    const TablebaseMaterial& material = table.material;
+    bool white = !board.whiteToMove;
+    uint64_t sideOffset = white ? 0 : material.positions;
+
+    U64 occupied = 0;
+    for (int i = 0; i < board.count; i++) occupied |= 1ULL << board.squares[i];
+
+    TablebaseBoard previous = board;
+    previous.whiteToMove = white;
+
+    for (int slot = 0; slot < board.count; slot++) {
+
+        PieceType type = board.types[slot];
+        if (isWhitePiece(type) != white) continue;
+        int to = board.squares[slot];
+
+        // Pieces move back the way they came, pawns one square back or two from their fourth rank
+        U64 sources;
+        if (type == PieceType::WP || type == PieceType::BP) {
+            int back = white ? -8 : 8;
+            int rank = white ? to / 8 : 7 - to / 8;
+            sources = 0;
+            if (rank >= 2 && !(occupied & (1ULL << (to + back)))) {
+                sources |= 1ULL << (to + back);
+                if (rank == 3 && !(occupied & (1ULL << (to + 2 * back)))) sources |= 1ULL << (to + 2 * back);
+            }
+        } else {
+            sources = attacks(type, to, occupied) & ~occupied;
+        }
+
+        while (sources) {
+            previous.squares[slot] = findLSBIndex(sources);
+            sources &= sources - 1;
+            indices.push_back(static_cast<uint32_t>(sideOffset + tablebaseIndex(material, previous.squares)));
+
+            // With the white king on the diagonal both mirror images are stored, and both need a look
+            int king = previous.squares[0];
+            if (king % 8 > 3) king ^= 7;
+            if (king / 8 > 3) king ^= 56;
+            if (!material.hasPawns && king / 8 == king % 8) {
+                int mirrored[TABLEBASE_MAX_PIECES];
+                for (int i = 0; i < material.count; i++) mirrored[i] = mirrorDiagonal(previous.squares[i]);
+                indices.push_back(static_cast<uint32_t>(sideOffset + tablebaseIndex(material, mirrored)));
+            }
+        }
+        previous.squares[slot] = to;
+    }
+
+}
+
+void TablebaseGenerator::build(Table& table) {
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t positions = table.material.positions;
+    for (int side = 0; side < 2; side++) table.states[side].assign(positions, UNKNOWN);
+
+    // Positions below are numbered across both halves, white to move first
+    typedef std::vector<std::vector<uint32_t>> WorkerLists;
+    std::vector<WorkerLists> scheduled(MAX_DISTANCE + 2, WorkerLists(threadCount));
+    WorkerLists resolved(threadCount), recheck(threadCount);
+
+    // Mates and stalemates. Moves into smaller tables already have their final result, so the pass a
+    // position can be decided by them is known up front. Positions with a move that leaves an en passant
+    // capture depend on positions two plies on, they are simply looked at on every pass.
+    parallelFor(2 * positions, [&](uint64_t begin, uint64_t end, int worker) {
+        for (uint64_t i = begin; i < end; i++) {
+            int side = static_cast<int>(i / positions);
+            uint8_t& state = table.states[side][i % positions];
+
+            TablebaseBoard board;
+            if (!decode(table, side, i % positions, board)) {
+                state = ILLEGAL;
+                continue;
+            }
+
+            bool hasMove = false, hasEnPassant = false, allWon = true;
+            int shortestLoss = -1, longestWin = -1;
+            forEachChild(board, -1, [&](const TablebaseBoard& child, bool sameMaterial, int enPassant) {
+                hasMove = true;
+                hasEnPassant = hasEnPassant || enPassant >= 0;
+                if (sameMaterial) return true;
+
+                uint8_t childState = this->childState(table, child, false, -1);
+                if (childState > MAX_DISTANCE) allWon = false;
+                else if (childState % 2 == 0 && (shortestLoss < 0 || childState < shortestLoss)) shortestLoss = childState;
+                else if (childState % 2 == 1) longestWin = std::max<int>(longestWin, childState);
+                return true;
+            });
+
+            if (!hasMove) {
+                state = isInCheck(board, board.whiteToMove) ? 0 : DRAWN;
+                if (state == 0) resolved[worker].push_back(static_cast<uint32_t>(i));
+                continue;
+            }
+
+            if (hasEnPassant) recheck[worker].push_back(static_cast<uint32_t>(i));
+            if (shortestLoss >= 0) scheduled[shortestLoss + 1][worker].push_back(static_cast<uint32_t>(i));
+            else if (allWon && longestWin >= 0) scheduled[longestWin + 1][worker].push_back(static_cast<uint32_t>(i));
+        }
+    });
+
+    int lastScheduled = 0;
+    for (int distance = 0; distance < static_cast<int>(scheduled.size()); distance++) {
+        for (const std::vector<uint32_t>& indices : scheduled[distance]) {
+            if (!indices.empty()) lastScheduled = distance;
+        }
+    }
+
+    std::vector<uint32_t> always, last, candidates;
+    for (const std::vector<uint32_t>& indices : recheck) always.insert(always.end(), indices.begin(), indices.end());
+    for (std::vector<uint32_t>& indices : resolved) {
+        last.insert(last.end(), indices.begin(), indices.end());
+        indices.clear();
+    }
+    std::vector<uint8_t> marked(2 * positions, 0);
+
+    // Every pass only looks at positions a move could have reached the last pass's results from, plus the
+    // ones scheduled for it. Passes go on while anything turns up or is still to come from smaller tables.
+    int distance = 1, lastProgress = 0;
+    for (; distance <= MAX_DISTANCE && (distance <= lastScheduled || distance <= lastProgress + 2); distance++) {
+
+        WorkerLists predecessors(threadCount);
+        parallelFor(last.size(), [&](uint64_t begin, uint64_t end, int worker) {
+            for (uint64_t j = begin; j < end; j++) {
+                TablebaseBoard board;
+                decode(table, last[j] < positions ? 0 : 1, last[j] % positions, board);
+                addPredecessors(table, board, predecessors[worker]);
+            }
+        });
+
+        candidates.clear();
+        auto addCandidates = [&](const std::vector<uint32_t>& indices) {
+            for (uint32_t i : indices) {
+                if (marked[i] || table.states[i / positions][i % positions] != UNKNOWN) continue;
+                marked[i] = 1;
+                candidates.push_back(i);
+            }
+        };
+        for (const std::vector<uint32_t>& indices : predecessors) addCandidates(indices);
+        for (const std::vector<uint32_t>& indices : scheduled[distance]) addCandidates(indices);
+        addCandidates(always);
+        for (uint32_t i : candidates) marked[i] = 0;
+
+        bool isWin = distance % 2 == 1;
+        parallelFor(candidates.size(), [&](uint64_t begin, uint64_t end, int worker) {
+            for (uint64_t j = begin; j < end; j++) {
+                uint32_t i = candidates[j];
+                TablebaseBoard board;
+                decode(table, i < positions ? 0 : 1, i % positions, board);
+
+                // Won: some move reaches a loss one ply shorter. Lost: every move reaches a win.
+                bool found = false;
+                bool finished = forEachChild(board, -1, [&](const TablebaseBoard& child, bool sameMaterial, int enPassant) {
+                    uint8_t state = childState(table, child, sameMaterial, enPassant);
+                    if (isWin) {
+                        found = state < distance && state % 2 == 0;
+                        return !found;
+                    }
+                    return state < distance && state % 2 == 1;
+                });
+
+                if (isWin ? found : finished) resolved[worker].push_back(i);
+            }
+        });
+
+        last.clear();
+        for (std::vector<uint32_t>& indices : resolved) {
+            for (uint32_t i : indices) table.states[i / positions][i % positions] = static_cast<uint8_t>(distance);
+            last.insert(last.end(), indices.begin(), indices.end());
+            indices.clear();
+        }
+        if (!last.empty()) lastProgress = distance;
+    }
+
+    TablebaseStats tableStats = {table.material.name, 2 * positions, 0, 0, 0, 0, distance - 1, 0};
+    for (int side = 0; side < 2; side++) {
+        for (uint8_t& state : table.states[side]) {
+            if (state == UNKNOWN) state = DRAWN;
+            if (state == ILLEGAL) continue;
+            if (state == DRAWN) tableStats.draws++;
+            else if (state % 2 == 1) tableStats.wins++;
+            else tableStats.losses++;
+            if (state <= MAX_DISTANCE) tableStats.maxDistance = std::max<int>(tableStats.maxDistance, state);
+        }
+    }
+
+    table.maxDistance = tableStats.maxDistance;
+    tableStats.iterations = distance - 1;
+    tableStats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stats.push_back(tableStats);
+
+}
+
+bool TablebaseGenerator::write(const Table& table, const std::string& path) {
+
+    uint64_t positions = table.material.positions;
+    int bits = 1;
+    while ((1 << bits) <= table.maxDistance) bits++;
+
+    uint8_t header[TABLEBASE_HEADER_SIZE] = {0};
+    memcpy(header, TABLEBASE_MAGIC, sizeof(TABLEBASE_MAGIC));
+    memcpy(header + 8, table.material.name.data(), table.material.name.size());
+    for (int i = 0; i < 8; i++) header[16 + i] = static_cast<uint8_t>(positions >> (8 * i));
+    header[24] = static_cast<uint8_t>(bits);
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Unable to create " << path << std::endl;
+        return false;
+    }
+
+    bool written = std::fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+    for (int side = 0; side < 2 && written; side++) {
+
+        std::vector<uint8_t> results(tablebaseResultBytes(positions), 0);
+        std::vector<uint8_t> distances(tablebaseDistanceBytes(positions, bits), 0);
+
+        for (uint64_t index = 0; index < positions; index++) {
+            uint8_t state = table.states[side][index];
+            TablebaseResult result = state == ILLEGAL ? TablebaseResult::INVALID : state == DRAWN ? TablebaseResult::DRAW
+                                   : state % 2 == 1 ? TablebaseResult::WIN : TablebaseResult::LOSS;
+            results[index / 4] |= static_cast<uint8_t>(static_cast<int>(result) << (2 * (index % 4)));
+
+            if (result == TablebaseResult::WIN || result == TablebaseResult::LOSS) {
+                uint64_t bit = index * bits;
+                distances[bit / 8] |= static_cast<uint8_t>(state << (bit % 8));
+                distances[bit / 8 + 1] |= static_cast<uint8_t>((state << (bit % 8)) >> 8);
+            }
+        }
+
+        written = std::fwrite(results.data(), 1, results.size(), file) == results.size()
+                  && std::fwrite(distances.data(), 1, distances.size(), file) == distances.size();
+    }
+
+    written = std::fclose(file) == 0 && written;
+    if (!written) std::cerr << "Failed to write " << path << std::endl;
+    return written;
+
+}
+
+TablebaseGenerator::Table* TablebaseGenerator::require(const std::string& name, const std::string& directory, bool& written) {
+
+    auto found = tables.find(name);
+    if (found != tables.end()) return found->second.get();
+
+    std::unique_ptr<Table> table(new Table());
+    parseTablebaseMaterial(name, table->material);
+    table->maxDistance = 0;
+    const TablebaseMaterial& material = table->material;
+
+    // Every material a capture, a promotion or both lead into
+    std::vector<std::string> smaller;
+    auto addSmaller = [&](std::vector<PieceType> pieces) {
+        bool flipped;
+        if (pieces.size() > 2) smaller.push_back(tablebaseMaterialName(pieces.data(), static_cast<int>(pieces.size()), flipped));
+    };
+
+    std::vector<PieceType> pieces(material.pieces, material.pieces + material.count);
+    for (int i = 2; i < material.count; i++) {
+        std::vector<PieceType> captured = pieces;
+        captured.erase(captured.begin() + i);
+        addSmaller(captured);
+
+        if (pieces[i] != PieceType::WP && pieces[i] != PieceType::BP) continue;
+        bool isWhite = isWhitePiece(pieces[i]);
+
+        for (const char* letter = TABLEBASE_PIECE_ORDER; *letter != 'P'; letter++) {
+            std::vector<PieceType> promoted = pieces;
+            promoted[i] = isWhite ? pieceTypeFromChar(*letter) : swapPieceColour(pieceTypeFromChar(*letter));
+            addSmaller(promoted);
+
+            for (int j = 2; j < material.count; j++) {
+                if (isWhitePiece(pieces[j]) == isWhite) continue;
+                std::vector<PieceType> promotedCapture = promoted;
+                promotedCapture.erase(promotedCapture.begin() + j);
+                addSmaller(promotedCapture);
+            }
+        }
+    }
+
+    for (const std::string& other : smaller) {
+        if (!require(other, directory, written)) return nullptr;
+    }
+
+    build(*table);
+    if (!write(*table, directory + "/" + name + TABLEBASE_EXTENSION)) written = false;
+
+    Table* built = table.get();
+    tables[name] = std::move(table);
+    return built;
+
+}
+
+bool TablebaseGenerator::generate(const std::string& name, const std::string& directory) {
+
+    TablebaseMaterial material;
+    if (!parseTablebaseMaterial(name, material)) {
+        std::cerr << "Not a tablebase material: " << name << std::endl;
+        return false;
+    }
+
+    bool written = true;
+    return require(material.name, directory, written) && written;
+
+}
+
+bool TablebaseGenerator::writeBitbase(const std::string& name, const std::string& path) {
+
+    TablebaseMaterial material;
+    auto found = parseTablebaseMaterial(name, material) ? tables.find(material.name) : tables.end();
+    if (found == tables.end()) {
+        std::cerr << "No table generated for " << name << std::endl;
+        return false;
+    }
+    const Table& table = *found->second;
+    uint64_t positions = material.positions;
+
+    // White wins where white to move mates (odd distances) and where black to move is mated (even ones)
+    std::vector<uint8_t> bits[2];
+    for (int side = 0; side < 2; side++) {
+        bits[side].assign(bitbaseBytes(positions), 0);
+        for (uint64_t index = 0; index < positions; index++) {
+            uint8_t state = table.states[side][index];
+            if (state > MAX_DISTANCE) continue;
+            if ((state % 2 == 1) != (side == 0)) {
+                std::cerr << "Black wins some " << material.name << " positions, which a bitbase cannot hold" << std::endl;
+                return false;
+            }
+            bits[side][index / 8] |= static_cast<uint8_t>(1 << (index % 8));
+        }
+    }
+
+    uint8_t header[BITBASE_HEADER_SIZE] = {0};
+    memcpy(header, BITBASE_MAGIC, sizeof(BITBASE_MAGIC));
+    memcpy(header + 8, material.name.data(), material.name.size());
+    for (int i = 0; i < 8; i++) header[16 + i] = static_cast<uint8_t>(positions >> (8 * i));
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Unable to create " << path << std::endl;
+        return false;
+    }
+
+    bool written = std::fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    for (int side = 0; side < 2 && written; side++) written = std::fwrite(bits[side].data(), 1, bits[side].size(), file) == bits[side].size();
+
+    written = std::fclose(file) == 0 && written;
+    if (!written) std::cerr << "Failed to write " << path << std::endl;
+    return written;
+
+}
+
+#endif // TABLEBASEGENERATOR_HPP
@@ -4,27 +4,70 @@
 #include <SDL.h>
 #include <SDL_image.h>
 #include <PieceType.hpp>
+#include <Assets.hpp>
+#include <algorithm>
 #include <string>
 #include <unordered_map>
 #include <iostream>
 #include <string>
+#include <vector>
 
 using namespace std;
 
+// Sprites that are drawn in code rather than loaded from a file
+enum class Sprite {
+    LIGHT_SQUARE,
+    DARK_SQUARE,
+    MOVE_HINT,
+    CAPTURE_RING,
+    CHECK_MARKER,
+    PIECE_PLACEHOLDER,
+    COUNT
+};
+
+// Every sprite is packed into a single atlas texture when buildAtlas is called, so that a whole frame can
+// be drawn from one texture (and in one draw call) instead of switching textures for every piece.
 class TextureManager{
 
     private:
-        // Set up map for piecetype and corresponding (current) texture
-        std::unordered_map<PieceType, SDL_Texture*> textures;
+        static const int ATLAS_MAX_WIDTH = 2048;
+        static const int ATLAS_PADDING = 1;
+
         SDL_Renderer* renderer;
+        SDL_Texture* atlas;
+        int atlasWidth, atlasHeight;
+
+        // Source surfaces, kept until the atlas is built
+        std::unordered_map<PieceType, SDL_Surface*> pieceSurfaces;
+        SDL_Surface* spriteSurfaces[static_cast<int>(Sprite::COUNT)];
+
+        // Where each sprite ended up in the atlas
+        std::unordered_map<PieceType, SDL_Rect> pieceRects;
+        SDL_Rect spriteRects[static_cast<int>(Sprite::COUNT)];
+
+        void freeSurfaces();
 
     public:
         TextureManager(SDL_Renderer* r);
         ~TextureManager();
 
-        SDL_Texture* loadTexture(PieceType type, const string path);
-        SDL_Texture* getTexture(PieceType type);
-        void clearTexture(PieceType type);
+        bool loadImage(PieceType type, const string path);
+
+        // Take ownership of the surface
+        void addImage(PieceType type, SDL_Surface* surface);
+        void addSprite(Sprite sprite, SDL_Surface* surface);
+
+        // Packs everything loaded or added so far into the atlas texture. The surfaces are freed afterwards
+        // unless more are still to come and the atlas will be built again with them.
+        bool buildAtlas(bool keepSurfaces = false);
+
+        SDL_Texture* getAtlas();
+        int getAtlasWidth();
+        int getAtlasHeight();
+
+        // Atlas rectangle of a piece or sprite, empty (w == 0) if it was never loaded
+        SDL_Rect getPieceRect(PieceType type);
+        SDL_Rect getSpriteRect(Sprite sprite);
 
         // Copy constructor and copy assignment operators should not be allowed
         TextureManager(const TextureManager&) = delete;
@@ -34,47 +77,156 @@ class TextureManager{
 
 TextureManager::TextureManager(SDL_Renderer* r){
     renderer = r;
+    atlas = nullptr;
+    atlasWidth = atlasHeight = 0;
+    for (int i = 0; i < static_cast<int>(Sprite::COUNT); i++) {
+        spriteSurfaces[i] = nullptr;
+        spriteRects[i] = {0, 0, 0, 0};
+    }
 }
 
 TextureManager::~TextureManager(){
-    for(auto& texture : textures){
-        SDL_DestroyTexture(texture.second);
+    freeSurfaces();
+    if (atlas) SDL_DestroyTexture(atlas);
+}
+
+void TextureManager::freeSurfaces(){
+
+    for (auto& surface : pieceSurfaces) SDL_FreeSurface(surface.second);
+    pieceSurfaces.clear();
+
+    for (int i = 0; i < static_cast<int>(Sprite::COUNT); i++) {
+        if (spriteSurfaces[i]) SDL_FreeSurface(spriteSurfaces[i]);
+        spriteSurfaces[i] = nullptr;
     }
+
 }
 
-SDL_Texture* TextureManager::loadTexture(PieceType type, const string path){
+bool TextureManager::loadImage(PieceType type, const string path){
 
-    SDL_Texture* texture = IMG_LoadTexture(renderer, path.c_str());
+    SDL_Surface* surface = IMG_Load_RW(openAsset(path), 1);
 
-    if(texture == NULL){
+    if(surface == NULL){
         std::cerr << "Unable to load image at " << path << "! SDL_Image Error: " << IMG_GetError() << endl;
-        return nullptr;
+        return false;
     }
 
-    textures[type] = texture;
-    return texture;
+    addImage(type, surface);
+    return true;
 
 }
 
-SDL_Texture* TextureManager::getTexture(PieceType type){
+void TextureManager::addImage(PieceType type, SDL_Surface* surface){
+    auto it = pieceSurfaces.find(type);
+    if (it != pieceSurfaces.end()) SDL_FreeSurface(it->second);
+    pieceSurfaces[type] = surface;
+}
 
-    auto it = textures.find(type);
-    if(it != textures.end()){
-        return it->second;
+void TextureManager::addSprite(Sprite sprite, SDL_Surface* surface){
+    SDL_Surface*& slot = spriteSurfaces[static_cast<int>(sprite)];
+    if (slot) SDL_FreeSurface(slot);
+    slot = surface;
+}
+
+bool TextureManager::buildAtlas(bool keepSurfaces){
+
+    struct Entry {
+        SDL_Surface* surface;
+        SDL_Rect* rect;
+    };
+
+    pieceRects.clear();
+    std::vector<Entry> entries;
+    for (auto& surface : pieceSurfaces) {
+        pieceRects[surface.first] = {0, 0, surface.second->w, surface.second->h};
+        entries.push_back({surface.second, &pieceRects[surface.first]});
     }
+    for (int i = 0; i < static_cast<int>(Sprite::COUNT); i++) {
+        spriteRects[i] = {0, 0, 0, 0};
+        if (spriteSurfaces[i]) {
+            spriteRects[i] = {0, 0, spriteSurfaces[i]->w, spriteSurfaces[i]->h};
+            entries.push_back({spriteSurfaces[i], &spriteRects[i]});
+        }
+    }
+
+    // Shelf packing, tallest first: fill a row left to right, then start a new row below it
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.rect->h > b.rect->h; });
+
+    int x = 0, y = 0, shelfHeight = 0, width = 0;
+    for (Entry& entry : entries) {
+        if (x > 0 && x + entry.rect->w > ATLAS_MAX_WIDTH) {
+            x = 0;
+            y += shelfHeight + ATLAS_PADDING;
+            shelfHeight = 0;
+        }
+        entry.rect->x = x;
+        entry.rect->y = y;
+        x += entry.rect->w + ATLAS_PADDING;
+        shelfHeight = std::max(shelfHeight, entry.rect->h);
+        width = std::max(width, x);
+    }
+    int height = y + shelfHeight;
+
+    if (width == 0 || height == 0) {
+        std::cerr << "Nothing to pack into the texture atlas" << endl;
+        return false;
+    }
+
+    SDL_Surface* packed = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+    if (packed == NULL) {
+        std::cerr << "Unable to create the atlas surface! SDL Error: " << SDL_GetError() << endl;
+        return false;
+    }
+    SDL_FillRect(packed, NULL, SDL_MapRGBA(packed->format, 0, 0, 0, 0));
+
+    // Copy pixels as they are, alpha included, rather than blending them onto the empty atlas
+    for (Entry& entry : entries) {
+        SDL_SetSurfaceBlendMode(entry.surface, SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(entry.surface, NULL, packed, entry.rect);
+    }
+
+    if (atlas) SDL_DestroyTexture(atlas);
+    atlas = SDL_CreateTextureFromSurface(renderer, packed);
+    SDL_FreeSurface(packed);
+
+    if (atlas == NULL) {
+        std::cerr << "Unable to create the atlas texture! SDL Error: " << SDL_GetError() << endl;
+        return false;
+    }
+
+    SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+    atlasWidth = width;
+    atlasHeight = height;
+    if (!keepSurfaces) freeSurfaces();
+    return true;
+
+}
 
-    return nullptr;
+SDL_Texture* TextureManager::getAtlas(){
+    return atlas;
+}
 
+int TextureManager::getAtlasWidth(){
+    return atlasWidth;
 }
 
-void TextureManager::clearTexture(PieceType type){
+int TextureManager::getAtlasHeight(){
+    return atlasHeight;
+}
 
-    auto it = textures.find(type);
-    if(it != textures.end()){
-        SDL_DestroyTexture(it->second);
-        textures.erase(it);
+SDL_Rect TextureManager::getPieceRect(PieceType type){
+
+    auto it = pieceRects.find(type);
+    if(it != pieceRects.end()){
+        return it->second;
     }
 
+    return {0, 0, 0, 0};
+
+}
+
+SDL_Rect TextureManager::getSpriteRect(Sprite sprite){
+    return spriteRects[static_cast<int>(sprite)];
 }
 
-#endif // TEXTUREMANAGER_H
\ No newline at end of file
+#endif // TEXTUREMANAGER_H
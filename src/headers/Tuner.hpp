@@ -0,0 +1,373 @@
+#ifndef TUNER_HPP
+#define TUNER_HPP
+
+#include <Board.hpp>
+#include <Evaluation.hpp>
+#include <MappedFile.hpp>
+#include <SelfPlay.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Texel tuning of the evaluation weights: minimises the mean squared difference between the game result
+// and sigmoid(evaluation) over a set of labelled positions, by gradient descent (Adam).
+//
+// The evaluation is linear in its weights (Evaluation.hpp), so each position is loaded once as the
+// counts of the parameters it uses and never touches a board again. The positions are kept as
+// structure-of-arrays: one flat array of parameter numbers and one of counts, with each position's range
+// given by an offset array, plus an array of targets. Each pass walks them front to back, split into one
+// contiguous range per thread, each thread summing its own gradient.
+
+struct TunerSettings {
+    int threads = 0;                // 0 uses every core
+    double lambda = 1.0;            // weight of the game result in the target, the search score gets the rest
+    double rate = 1.0;              // Adam step size, in centipawns
+};
+
+class EvaluationTuner {
+
+    private:
+        TunerSettings settings;
+        int threadCount;
+
+        // Positions, structure of arrays
+        std::vector<uint32_t> offsets;          // position i uses entries offsets[i] to offsets[i + 1]
+        std::vector<uint16_t> parameters;
+        std::vector<float> counts;
+        std::vector<float> results;             // 1 white won, 0.5 drawn, 0 black won
+        std::vector<float> scores;              // search scores, white's point of view
+
+        std::vector<float> targets;
+        std::vector<double> weights;
+        double scale;                           // K in sigmoid(e) = 1 / (1 + 10^(-K e / 400))
+
+        // Adam moments and step count
+        std::vector<double> firstMoments;
+        std::vector<double> secondMoments;
+        int steps;
+
+        uint64_t mismatches;
+
+        double sigmoid(double evaluation, double k);
+
+        // Runs work(begin, end, thread) over the positions, one contiguous range per thread
+        void parallelRanges(const std::function<void(size_t, size_t, int)>& work);
+
+        double errorWithScale(double k);
+        void updateTargets();
+
+    public:
+        EvaluationTuner(const TunerSettings& tunerSettings);
+
+        // Loads the positions of a self-play file (SelfPlay.hpp) whose game has a result
+        bool load(const std::string& path);
+
+        size_t getPositionCount();
+
+        // Positions whose evaluation did not match the weights times their counts, which means the
+        // features and the evaluation have drifted apart
+        uint64_t getMismatches();
+
+        // Finds the K that fits the current weights best; call once after loading, before stepping
+        double fitScale();
+
+        // Mean squared error of the current weights
+        double error();
+
+        // One gradient descent step over every position, returns the error before it
+        double step();
+
+        // The weights rounded to centipawns, in the layout of Evaluation.hpp
+        std::vector<int> getWeights();
+
+        // Writes the weights as EvaluationParameters.hpp
+        bool writeHeader(const std::string& path);
+
+        // Copy constructor and copy assignment operators should not be allowed
+        EvaluationTuner(const EvaluationTuner&) = delete;
+        EvaluationTuner& operator=(const EvaluationTuner&) = delete;
+
+};
+
+EvaluationTuner::EvaluationTuner(const TunerSettings& tunerSettings)
+    : settings(tunerSettings), offsets(1, 0), scale(1.0), firstMoments(EVAL_PARAMETER_COUNT, 0.0),
+      secondMoments(EVAL_PARAMETER_COUNT, 0.0), steps(0), mismatches(0) {
+
+    threadCount = settings.threads > 0 ? settings.threads : std::max(1u, std::thread::hardware_concurrency());
+    weights.assign(EVAL_WEIGHTS.begin(), EVAL_WEIGHTS.end());
+
+}
+
+bool EvaluationTuner::load(const std::string& path) {
+
+    MappedFile file;
+    if (!file.open(path)) return false;
+    file.adviseSequential();
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(file.getData());
+    size_t size = file.getSize();
+    if (size < static_cast<size_t>(SELFPLAY_HEADER_SIZE) || memcmp(data, SELFPLAY_MAGIC, sizeof(SELFPLAY_MAGIC)) != 0
+        || data[8] != SELFPLAY_RECORD_SIZE) {
+        std::cerr << path << " is not a self-play file" << std::endl;
+        return false;
+    }
+
+    size_t recordCount = (size - SELFPLAY_HEADER_SIZE) / SELFPLAY_RECORD_SIZE;
+
+    // Each thread turns its share of the records into features, then the shares are appended in order
+    struct Share {
+        std::vector<uint32_t> lengths;
+        std::vector<uint16_t> parameters;
+        std::vector<float> counts, results, scores;
+        uint64_t mismatches = 0;
+    };
+    std::vector<Share> shares(threadCount);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t]() {
+
+            Share& share = shares[t];
+            Board board;
+            SelfPlayRecord record;
+            std::vector<EvaluationFeature> features;
+
+            for (size_t i = recordCount * t / threadCount; i < recordCount * (t + 1) / threadCount; i++) {
+                unpackSelfPlayRecord(data + SELFPLAY_HEADER_SIZE + i * SELFPLAY_RECORD_SIZE, record);
+                if (record.result == GameResult::UNKNOWN) continue;
+
+                board.loadPosition(record.position);
+                evaluationFeatures(board, features);
+
+                int evaluation = 0;
+                for (const EvaluationFeature& feature : features) {
+                    share.parameters.push_back(feature.parameter);
+                    share.counts.push_back(feature.count);
+                    evaluation += EVAL_WEIGHTS[feature.parameter] * feature.count;
+                }
+                if (evaluation != evaluateWhite(board)) share.mismatches++;
+
+                share.lengths.push_back(static_cast<uint32_t>(features.size()));
+                share.results.push_back(record.result == GameResult::WHITE_WIN ? 1.0f : record.result == GameResult::BLACK_WIN ? 0.0f : 0.5f);
+                share.scores.push_back(static_cast<float>(record.score));
+            }
+
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    for (const Share& share : shares) {
+        for (uint32_t length : share.lengths) offsets.push_back(offsets.back() + length);
+        parameters.insert(parameters.end(), share.parameters.begin(), share.parameters.end());
+        counts.insert(counts.end(), share.counts.begin(), share.counts.end());
+        results.insert(results.end(), share.results.begin(), share.results.end());
+        scores.insert(scores.end(), share.scores.begin(), share.scores.end());
+        mismatches += share.mismatches;
+    }
+
+    updateTargets();
+    return true;
+
+}
+
+size_t EvaluationTuner::getPositionCount() {
+    return results.size();
+}
+
+uint64_t EvaluationTuner::getMismatches() {
+    return mismatches;
+}
+
+double EvaluationTuner::sigmoid(double evaluation, double k) {
+    return 1.0 / (1.0 + std::pow(10.0, -k * evaluation / 400.0));
+}
+
+void EvaluationTuner::updateTargets() {
+    targets.resize(results.size());
+    for (size_t i = 0; i < results.size(); i++) {
+        targets[i] = static_cast<float>(settings.lambda * results[i] + (1.0 - settings.lambda) * sigmoid(scores[i], scale));
+    }
+}
+
+void EvaluationTuner::parallelRanges(const std::function<void(size_t, size_t, int)>& work) {
+
+    size_t count = results.size();
+    std::vector<std::thread> threads;
+    for (int t = 1; t < threadCount; t++) threads.emplace_back(work, count * t / threadCount, count * (t + 1) / threadCount, t);
+    work(0, count / threadCount, 0);
+    for (std::thread& thread : threads) thread.join();
+
+}
+
+double EvaluationTuner::errorWithScale(double k) {
+
+    std::vector<double> sums(threadCount, 0.0);
+    parallelRanges([&](size_t begin, size_t end, int thread) {
+        const uint32_t* offset = offsets.data();
+        const uint16_t* parameter = parameters.data();
+        const float* count = counts.data();
+        const double* weight = weights.data();
+
+        double sum = 0;
+        for (size_t i = begin; i < end; i++) {
+            double evaluation = 0;
+            for (uint32_t j = offset[i]; j < offset[i + 1]; j++) evaluation += weight[parameter[j]] * count[j];
+            double difference = targets[i] - sigmoid(evaluation, k);
+            sum += difference * difference;
+        }
+        sums[thread] = sum;
+    });
+
+    double total = 0;
+    for (double sum : sums) total += sum;
+    return results.empty() ? 0 : total / results.size();
+
+}
+
+double EvaluationTuner::error() {
+    return errorWithScale(scale);
+}
+
+double EvaluationTuner::fitScale() {
+
+    // The error is unimodal in K, so a golden section search narrows it down
+    double low = 0.05, high = 5.0;
+    const double ratio = (std::sqrt(5.0) - 1) / 2;
+    double a = high - ratio * (high - low), b = low + ratio * (high - low);
+    double errorA = errorWithScale(a), errorB = errorWithScale(b);
+
+    for (int i = 0; i < 40; i++) {
+        if (errorA < errorB) {
+            high = b;
+            b = a;
+            errorB = errorA;
+            a = high - ratio * (high - low);
+            errorA = errorWithScale(a);
+        } else {
+            low = a;
+            a = b;
+            errorA = errorB;
+            b = low + ratio * (high - low);
+            errorB = errorWithScale(b);
+        }
+    }
+
+    scale = (low + high) / 2;
+    updateTargets();
+    return scale;
+
+}
+
+double EvaluationTuner::step() {
+
+    std::vector<std::vector<double>> gradients(threadCount, std::vector<double>(EVAL_PARAMETER_COUNT, 0.0));
+    std::vector<double> sums(threadCount, 0.0);
+    const double slope = scale * std::log(10.0) / 400.0;
+
+    parallelRanges([&](size_t begin, size_t end, int thread) {
+        const uint32_t* offset = offsets.data();
+        const uint16_t* parameter = parameters.data();
+        const float* count = counts.data();
+        const double* weight = weights.data();
+        double* gradient = gradients[thread].data();
+
+        double sum = 0;
+        for (size_t i = begin; i < end; i++) {
+            double evaluation = 0;
+            for (uint32_t j = offset[i]; j < offset[i + 1]; j++) evaluation += weight[parameter[j]] * count[j];
+
+            double predicted = sigmoid(evaluation, scale);
+            double difference = predicted - targets[i];
+            sum += difference * difference;
+
+            // d(difference^2)/d(weight) = 2 difference sigmoid' count
+            double factor = 2 * difference * predicted * (1 - predicted) * slope;
+            for (uint32_t j = offset[i]; j < offset[i + 1]; j++) gradient[parameter[j]] += factor * count[j];
+        }
+        sums[thread] = sum;
+    });
+
+    // Threads are summed in a fixed order so that a run can be repeated exactly
+    size_t positions = std::max<size_t>(1, results.size());
+    double total = 0;
+    for (int t = 0; t < threadCount; t++) total += sums[t];
+
+    const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+    steps++;
+    for (int p = 0; p < EVAL_PARAMETER_COUNT; p++) {
+        double gradient = 0;
+        for (int t = 0; t < threadCount; t++) gradient += gradients[t][p];
+        gradient /= positions;
+
+        firstMoments[p] = beta1 * firstMoments[p] + (1 - beta1) * gradient;
+        secondMoments[p] = beta2 * secondMoments[p] + (1 - beta2) * gradient * gradient;
+        double first = firstMoments[p] / (1 - std::pow(beta1, steps));
+        double second = secondMoments[p] / (1 - std::pow(beta2, steps));
+        weights[p] -= settings.rate * first / (std::sqrt(second) + epsilon);
+    }
+
+    return total / positions;
+
+}
+
+std::vector<int> EvaluationTuner::getWeights() {
+    std::vector<int> rounded(weights.size());
+    for (size_t i = 0; i < weights.size(); i++) rounded[i] = static_cast<int>(std::lround(weights[i]));
+    return rounded;
+}
+
+bool EvaluationTuner::writeHeader(const std::string& path) {
+
+    FILE* out = fopen(path.c_str(), "w");
+    if (!out) {
+        std::cerr << "Unable to create " << path << std::endl;
+        return false;
+    }
+
+    std::vector<int> tuned = getWeights();
+    const char* names[6] = {"Pawn", "Rook", "Bishop", "Knight", "Queen", "King, kept behind its pawns"};
+
+    fprintf(out, "#ifndef EVALUATIONPARAMETERS_HPP\n#define EVALUATIONPARAMETERS_HPP\n\n");
+    fprintf(out, "// Weights of the evaluation terms in centipawns (see Evaluation.hpp). The tuner rewrites this file:\n");
+    fprintf(out, "// ./tuner <selfplay.bin>... --out src/headers/EvaluationParameters.hpp\n\n");
+
+    fprintf(out, "// Indexed by piece kind: pawn, rook, bishop, knight, queen, king (the PieceType order)\n");
+    fprintf(out, "const int PIECE_VALUES[6] = {");
+    for (int kind = 0; kind < 6; kind++) fprintf(out, "%s%d", kind ? ", " : "", tuned[EVAL_PIECE_VALUES + kind]);
+    fprintf(out, "};\n\nconst int PIECE_SQUARE_TABLES[6][64] = {\n");
+
+    for (int kind = 0; kind < 6; kind++) {
+        fprintf(out, "\n    // %s\n    {\n", names[kind]);
+        for (int rank = 0; rank < 8; rank++) {
+            fprintf(out, "        ");
+            for (int file = 0; file < 8; file++) {
+                fprintf(out, "%s%3d", file ? "," : "", tuned[EVAL_PIECE_SQUARE_TABLES + kind * 64 + rank * 8 + file]);
+            }
+            fprintf(out, rank < 7 ? ",\n" : "\n");
+        }
+        fprintf(out, kind < 5 ? "    },\n" : "    }\n");
+    }
+    fprintf(out, "\n};\n\n");
+
+    fprintf(out, "// Per square a piece attacks that does not hold a piece of its own side, by piece kind\n");
+    fprintf(out, "const int MOBILITY_WEIGHTS[6] = {");
+    for (int kind = 0; kind < 6; kind++) fprintf(out, "%s%d", kind ? ", " : "", tuned[EVAL_MOBILITY + kind]);
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "// Per own pawn on the three squares one rank and two ranks in front of the king\n");
+    fprintf(out, "const int KING_SHIELD_WEIGHTS[2] = {%d, %d};\n\n", tuned[EVAL_KING_SHIELD], tuned[EVAL_KING_SHIELD + 1]);
+
+    fprintf(out, "// Per attack of a knight, bishop, rook or queen on the enemy king or a square next to it\n");
+    fprintf(out, "const int KING_ATTACK_WEIGHT = %d;\n\n", tuned[EVAL_KING_ATTACK]);
+    fprintf(out, "#endif // EVALUATIONPARAMETERS_HPP\n");
+
+    return fclose(out) == 0;
+
+}
+
+#endif // TUNER_HPP
@@ -5,166 +5,354 @@
 #include <SDL_image.h>
 #include <PieceType.hpp>
 #include <TextureManager.hpp>
+#include <AssetLoader.hpp>
 #include <Board.hpp>
 #include <BitOperations.hpp>
 #include <unordered_map>
+#include <vector>
 
 using namespace std;
 
+// Where each piece image is loaded from, see openAsset
+const std::pair<PieceType, const char*> PIECE_IMAGE_FILES[] = {
+
+    // Black pieces
+    {PieceType::BP, "src/assets/textures/bp.png"}, {PieceType::BR, "src/assets/textures/br.png"},
+    {PieceType::BB, "src/assets/textures/bb.png"}, {PieceType::BN, "src/assets/textures/bn.png"},
+    {PieceType::BQ, "src/assets/textures/bq.png"}, {PieceType::BK, "src/assets/textures/bk.png"},
+
+    // White pieces
+    {PieceType::WP, "src/assets/textures/wp.png"}, {PieceType::WR, "src/assets/textures/wr.png"},
+    {PieceType::WB, "src/assets/textures/wb.png"}, {PieceType::WN, "src/assets/textures/wn.png"},
+    {PieceType::WQ, "src/assets/textures/wq.png"}, {PieceType::WK, "src/assets/textures/wk.png"}
+
+};
+
 class UI{
 
     private:
         int SQUARE_SIZE;
         int BOARD_SIZE;
-        
+
         TextureManager textureManager;
         SDL_Renderer* renderer;
         Board* board;
 
+        // Frames are composed in frameTexture, which keeps its contents between frames, so only squares
+        // that changed since the last frame are redrawn.
+        SDL_Texture* frameTexture = nullptr;
+        bool frameReady = false;
+
+        // What each square showed in the last frame
+        PieceType drawnPieces[64];
+        U64 drawnValidMoves = 0;
+        int drawnCheckSquare = -1;
+        bool fullRedraw = true;
+
+        // Atlas rectangles queued for this frame, drawn together by drawQuads
+        std::vector<SDL_Rect> quadSources;
+        std::vector<SDL_Rect> quadDestinations;
+        std::vector<SDL_Vertex> vertices;
+        std::vector<int> indices;
+
         void setSquareSize(int SQ_SIZE);
+        void createFrameTexture();
+        void createSprites();
+        // Anti-aliased ring between the two radii (a disc when innerRadius is 0), blended over the surface
+        void drawRing(SDL_Surface* surface, float centerX, float centerY, float innerRadius, float outerRadius, SDL_Color colour);
+        void addQuad(const SDL_Rect& source, const SDL_Rect& destination);
+        void drawQuads();
 
     public:
         UI(SDL_Renderer* r, Board* b, int size) : renderer(r), textureManager(r), board(b), SQUARE_SIZE(size), BOARD_SIZE(size * 8) {};
+        ~UI();
 
         int getBoardSize();
-        
-        void drawChessboard();
-        void drawPieces();
-        void loadImages();
 
-        void drawValidMoves(U64 validMoves);
-        void drawFilledCircle(SDL_Renderer* renderer, int centerX, int centerY, int radius);
+        // Queues the piece images on the loader and builds an atlas of the drawn sprites straight away, so
+        // the board can be shown with placeholder pieces before any image has been decoded
+        void loadImages(AssetLoader& loader);
+
+        // Takes ownership of a decoded piece image, which shows up after the next uploadImages
+        void addImage(PieceType type, SDL_Surface* surface);
+
+        // Rebuilds the atlas with the images added so far, lastly with isFinal once nothing else is coming
+        void uploadImages(bool isFinal);
+
+        // Draws the position with the move hints and the check square (-1 for none) to the window, without
+        // presenting it. Returns the number of squares that had to be redrawn.
+        int render(U64 validMoves, int checkSquare);
+
+        // Forget the cached frame, e.g. after SDL_RENDER_TARGETS_RESET
+        void invalidate();
 
         // Copy constructor and copy assignment operators should not be allowed
         UI(const UI&) = delete;
         UI& operator=(const UI&) = delete;
-        
+
 };
 
-void UI::drawValidMoves (U64 validMoves) {
-    SDL_SetRenderDrawColor (renderer, 209, 213, 183, SDL_ALPHA_OPAQUE);
-    int radius = SQUARE_SIZE/6;
-    while (validMoves) {
+UI::~UI() {
+    if (frameTexture) SDL_DestroyTexture(frameTexture);
+}
+
+void UI::createFrameTexture() {
 
-        int index = findLSBIndex(validMoves);
-        if (index == -1) break;
+    frameReady = true;
+    fullRedraw = true;
 
-        // Clear the bit that was just found
-        validMoves &= ~(1ULL << index);
-    
-        int row = index / 8;
-        int col = index % 8;
-        int x = col * SQUARE_SIZE + SQUARE_SIZE/2;
-        int y = (7 - row) * SQUARE_SIZE + SQUARE_SIZE/2;
+    if (!frameTexture) frameTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, BOARD_SIZE, BOARD_SIZE);
 
-        drawFilledCircle(renderer, x, y, radius);
-    
+    // Without render target support every frame is simply drawn in full
+    if (!frameTexture) {
+        std::cerr << "Render targets unavailable, drawing full frames! SDL_Error: " << SDL_GetError() << endl;
+        return;
     }
 
-}
+    // Fully opaque, copying it never needs blending
+    SDL_SetTextureBlendMode(frameTexture, SDL_BLENDMODE_NONE);
 
-void UI::drawFilledCircle(SDL_Renderer* renderer, int centerX, int centerY, int radius) {
-    for (int w = 0; w < radius * 2; w++) {
-        for (int h = 0; h < radius * 2; h++) {
-            int dx = radius - w; // horizontal offset
-            int dy = radius - h; // vertical offset
-            if ((dx * dx + dy * dy) <= (radius * radius)) {
-                SDL_RenderDrawPoint(renderer, centerX + dx, centerY + dy);
-            }
-        }
-    }
 }
 
-void UI::setSquareSize(int SQ_SIZE){
-    SQUARE_SIZE = SQ_SIZE;
-    BOARD_SIZE = SQ_SIZE * 8;
+void UI::invalidate() {
+
+    // Recreated (and redrawn) on the next render
+    if (frameTexture) SDL_DestroyTexture(frameTexture);
+    frameTexture = nullptr;
+    frameReady = false;
+
 }
 
-int UI::getBoardSize(){
-    return BOARD_SIZE;
+void UI::addQuad(const SDL_Rect& source, const SDL_Rect& destination) {
+    if (source.w == 0) return;
+    quadSources.push_back(source);
+    quadDestinations.push_back(destination);
 }
 
-void UI::loadImages(){
+void UI::drawQuads() {
 
-    // Error handling has not been placed in yet. 
+    SDL_Texture* atlas = textureManager.getAtlas();
+    if (!atlas || quadSources.empty()) return;
 
-    // Black pieces
-    textureManager.loadTexture(PieceType::BP, "src/assets/textures/bp.png");
-    textureManager.loadTexture(PieceType::BR, "src/assets/textures/br.png");
-    textureManager.loadTexture(PieceType::BB, "src/assets/textures/bb.png");
-    textureManager.loadTexture(PieceType::BN, "src/assets/textures/bn.png");
-    textureManager.loadTexture(PieceType::BQ, "src/assets/textures/bq.png");
-    textureManager.loadTexture(PieceType::BK, "src/assets/textures/bk.png");
-    
-    // White pieces
-    textureManager.loadTexture(PieceType::WP, "src/assets/textures/wp.png");
-    textureManager.loadTexture(PieceType::WR, "src/assets/textures/wr.png");
-    textureManager.loadTexture(PieceType::WB, "src/assets/textures/wb.png");
-    textureManager.loadTexture(PieceType::WN, "src/assets/textures/wn.png");
-    textureManager.loadTexture(PieceType::WQ, "src/assets/textures/wq.png");
-    textureManager.loadTexture(PieceType::WK, "src/assets/textures/wk.png");
+    float atlasWidth = static_cast<float>(textureManager.getAtlasWidth());
+    float atlasHeight = static_cast<float>(textureManager.getAtlasHeight());
+    SDL_Color white = {255, 255, 255, 255};
+
+    vertices.clear();
+    indices.clear();
+
+    // Two triangles per quad, all sampling the atlas
+    for (size_t i = 0; i < quadSources.size(); i++) {
+
+        const SDL_Rect& source = quadSources[i];
+        const SDL_Rect& destination = quadDestinations[i];
+
+        float left = source.x / atlasWidth, right = (source.x + source.w) / atlasWidth;
+        float top = source.y / atlasHeight, bottom = (source.y + source.h) / atlasHeight;
+        float x0 = static_cast<float>(destination.x), x1 = static_cast<float>(destination.x + destination.w);
+        float y0 = static_cast<float>(destination.y), y1 = static_cast<float>(destination.y + destination.h);
+
+        int first = static_cast<int>(vertices.size());
+        vertices.push_back({{x0, y0}, white, {left, top}});
+        vertices.push_back({{x1, y0}, white, {right, top}});
+        vertices.push_back({{x1, y1}, white, {right, bottom}});
+        vertices.push_back({{x0, y1}, white, {left, bottom}});
+
+        int corners[6] = {0, 1, 2, 0, 2, 3};
+        for (int corner : corners) indices.push_back(first + corner);
+    }
+
+    int result = SDL_RenderGeometry(renderer, atlas, vertices.data(), static_cast<int>(vertices.size()),
+                                    indices.data(), static_cast<int>(indices.size()));
+
+    // Renderers without geometry support fall back to one copy per quad
+    if (result != 0) {
+        for (size_t i = 0; i < quadSources.size(); i++) SDL_RenderCopy(renderer, atlas, &quadSources[i], &quadDestinations[i]);
+    }
+
+    quadSources.clear();
+    quadDestinations.clear();
 
 }
 
-void UI::drawChessboard(){
+int UI::render(U64 validMoves, int checkSquare) {
 
-    SDL_Rect square;
+    if (!frameReady) createFrameTexture();
 
-    square.w = SQUARE_SIZE;
-    square.h = SQUARE_SIZE;
+    // Piece on every square, visiting only the set bits of each bitboard
+    PieceType pieces[64];
+    for (int i = 0; i < 64; i++) pieces[i] = PieceType::EMPTY;
 
-    // set up board to be alternating colours
-    for(int i = 0; i < 8; i++){
-        for(int j = 0; j < 8; j++){
+    for (int type = 0; type < 12; type++) {
+        U64 bitboard = board->getBitboard(static_cast<PieceType>(type));
+        while (bitboard) {
+            pieces[findLSBIndex(bitboard)] = static_cast<PieceType>(type);
+            bitboard &= bitboard - 1;
+        }
+    }
 
-            if ((i+j) % 2 == 0) SDL_SetRenderDrawColor(renderer,233,237,204,255);  // Colour 1
-            else                SDL_SetRenderDrawColor(renderer,119,153,84,255);   // Colour 2
+    // Squares whose piece, move hint or check marker changed since the last frame
+    U64 dirty = 0;
+    if (fullRedraw || !frameTexture) {
+        dirty = ~0ULL;
+    } else {
+        for (int i = 0; i < 64; i++) {
+            if (pieces[i] != drawnPieces[i]) dirty |= 1ULL << i;
+        }
+        dirty |= validMoves ^ drawnValidMoves;
+        if (checkSquare != drawnCheckSquare) {
+            if (drawnCheckSquare >= 0) dirty |= 1ULL << drawnCheckSquare;
+            if (checkSquare >= 0) dirty |= 1ULL << checkSquare;
+        }
+    }
 
-            // X-coordinate of square
-            square.x = j * SQUARE_SIZE;                     
+    // Every layer of every dirty square, back to front: square, check glow, piece, move hint or capture ring
+    for (U64 squares = dirty; squares; squares &= squares - 1) {
 
-            // Y-coordinate of square
-            square.y = i * SQUARE_SIZE;                     
+        int square = findLSBIndex(squares);
+        int row = 7 - (square / 8);
+        int col = square % 8;
+        SDL_Rect destination = {col * SQUARE_SIZE, row * SQUARE_SIZE, SQUARE_SIZE, SQUARE_SIZE};
+        bool isOccupied = pieces[square] != PieceType::EMPTY;
 
-            SDL_RenderFillRect(renderer, &square);
+        addQuad(textureManager.getSpriteRect((row + col) % 2 == 0 ? Sprite::LIGHT_SQUARE : Sprite::DARK_SQUARE), destination);
+        if (square == checkSquare) addQuad(textureManager.getSpriteRect(Sprite::CHECK_MARKER), destination);
+        if (isOccupied) {
+            SDL_Rect source = textureManager.getPieceRect(pieces[square]);
+            addQuad(source.w ? source : textureManager.getSpriteRect(Sprite::PIECE_PLACEHOLDER), destination);
         }
+        if (validMoves & (1ULL << square)) addQuad(textureManager.getSpriteRect(isOccupied ? Sprite::CAPTURE_RING : Sprite::MOVE_HINT), destination);
     }
 
-}
+    if (frameTexture) SDL_SetRenderTarget(renderer, frameTexture);
+    drawQuads();
 
-void UI::drawPieces(){
+    if (frameTexture) {
+        SDL_SetRenderTarget(renderer, nullptr);
+        SDL_Rect destination = {0, 0, BOARD_SIZE, BOARD_SIZE};
+        SDL_RenderCopy(renderer, frameTexture, nullptr, &destination);
+    }
 
-    // Recall that piece textures are stored in the textures map in textureManager.
+    for (int i = 0; i < 64; i++) drawnPieces[i] = pieces[i];
+    drawnValidMoves = validMoves;
+    drawnCheckSquare = checkSquare;
+    fullRedraw = false;
 
-    for(const auto& [type, bb] : board->getCurrentBoard()){
+    return countSetBits(dirty);
 
-        U64 mask = 1ULL;
-        for(int i = 0; i < 64; i++, mask <<= 1){
-            
-            // If there is an active bit at the current location, a piece exists!
-            if(bb & mask){
+}
 
-                // Calculate coordinates in terms of row and col, and then convert to pixel coordinates.
+void UI::drawRing(SDL_Surface* surface, float centerX, float centerY, float innerRadius, float outerRadius, SDL_Color colour) {
 
-                int row = 7 - (i / 8);
-                int col = i % 8;
+    SDL_LockSurface(surface);
 
-                int x = col * SQUARE_SIZE;
-                int y = row * SQUARE_SIZE;
+    for (int y = 0; y < surface->h; y++) {
+        Uint32* row = reinterpret_cast<Uint32*>(static_cast<Uint8*>(surface->pixels) + y * surface->pitch);
+        for (int x = 0; x < surface->w; x++) {
 
-                // Now obtain the texture for this piece and then draw on screen
-                SDL_Texture* texture = textureManager.getTexture(type);
-                SDL_Rect destRect = {x, y, SQUARE_SIZE, SQUARE_SIZE};
+            // Coverage of the pixel from its centre's distance to each edge, one pixel wide falloff
+            float dx = x + 0.5f - centerX;
+            float dy = y + 0.5f - centerY;
+            float distance = SDL_sqrtf(dx * dx + dy * dy);
 
-                if(texture){
-                    SDL_RenderCopy(renderer, texture, nullptr, &destRect);
-                }
+            float coverage = SDL_clamp(outerRadius + 0.5f - distance, 0.0f, 1.0f);
+            if (innerRadius > 0) coverage *= SDL_clamp(distance - innerRadius + 0.5f, 0.0f, 1.0f);
+            if (coverage <= 0) continue;
 
-            }
-        
+            // Blend over whatever is already there
+            Uint8 r, g, b, a;
+            SDL_GetRGBA(row[x], surface->format, &r, &g, &b, &a);
+            float alpha = coverage * colour.a / 255.0f;
+            float outAlpha = alpha + (a / 255.0f) * (1 - alpha);
+            auto mix = [&](Uint8 source, Uint8 target) {
+                return static_cast<Uint8>((source * alpha + target * (a / 255.0f) * (1 - alpha)) / outAlpha + 0.5f);
+            };
+            row[x] = SDL_MapRGBA(surface->format, mix(colour.r, r), mix(colour.g, g), mix(colour.b, b), static_cast<Uint8>(outAlpha * 255 + 0.5f));
         }
     }
 
+    SDL_UnlockSurface(surface);
+
+}
+
+void UI::setSquareSize(int SQ_SIZE){
+    SQUARE_SIZE = SQ_SIZE;
+    BOARD_SIZE = SQ_SIZE * 8;
+}
+
+int UI::getBoardSize(){
+    return BOARD_SIZE;
+}
+
+// Squares, move hint, capture ring and check glow are rasterised once here, anti-aliased and at display
+// size, and packed with the pieces so they cost no more to draw than a piece
+void UI::createSprites(){
+
+    auto createSurface = [&](SDL_Color fill) {
+        SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, SQUARE_SIZE, SQUARE_SIZE, 32, SDL_PIXELFORMAT_RGBA32);
+        if (surface) SDL_FillRect(surface, NULL, SDL_MapRGBA(surface->format, fill.r, fill.g, fill.b, fill.a));
+        return surface;
+    };
+
+    SDL_Surface* lightSquare = createSurface({233, 237, 204, 255});
+    SDL_Surface* darkSquare = createSurface({119, 153, 84, 255});
+    SDL_Surface* moveHint = createSurface({0, 0, 0, 0});
+    SDL_Surface* captureRing = createSurface({0, 0, 0, 0});
+    SDL_Surface* checkMarker = createSurface({0, 0, 0, 0});
+    SDL_Surface* placeholder = createSurface({0, 0, 0, 0});
+
+    if (!lightSquare || !darkSquare || !moveHint || !captureRing || !checkMarker || !placeholder) {
+        std::cerr << "Unable to create sprites! SDL Error: " << SDL_GetError() << endl;
+        return;
+    }
+
+    float centre = SQUARE_SIZE / 2.0f;
+    SDL_Color hintColour = {209, 213, 183, 255};
+
+    drawRing(moveHint, centre, centre, 0, SQUARE_SIZE / 6.0f, hintColour);
+    drawRing(captureRing, centre, centre, centre - SQUARE_SIZE / 10.0f, centre, hintColour);
+
+    // Red glow fading out from the centre, built up from concentric translucent discs
+    const int steps = 8;
+    for (int i = steps; i > 0; i--) {
+        drawRing(checkMarker, centre, centre, 0, centre * i / steps, {255, 0, 0, 40});
+    }
+
+    // Stands in for a piece whose image is still loading
+    drawRing(placeholder, centre, centre, 0, SQUARE_SIZE * 0.3f, {40, 40, 40, 110});
+
+    textureManager.addSprite(Sprite::LIGHT_SQUARE, lightSquare);
+    textureManager.addSprite(Sprite::DARK_SQUARE, darkSquare);
+    textureManager.addSprite(Sprite::MOVE_HINT, moveHint);
+    textureManager.addSprite(Sprite::CAPTURE_RING, captureRing);
+    textureManager.addSprite(Sprite::CHECK_MARKER, checkMarker);
+    textureManager.addSprite(Sprite::PIECE_PLACEHOLDER, placeholder);
+
+}
+
+void UI::loadImages(AssetLoader& loader){
+
+    for (const auto& file : PIECE_IMAGE_FILES) loader.loadImage(file.first, file.second);
+
+    createSprites();
+
+    // Squares and placeholders now, pieces are added to the same atlas as they arrive
+    textureManager.buildAtlas(true);
+
+}
+
+void UI::addImage(PieceType type, SDL_Surface* surface){
+    textureManager.addImage(type, surface);
+}
+
+void UI::uploadImages(bool isFinal){
+
+    // Everything ends up in a single texture, so it is rebuilt as a whole
+    textureManager.buildAtlas(!isFinal);
+
+    // Atlas rectangles moved and placeholders need replacing
+    fullRedraw = true;
+
 }
 
-#endif  // UI_HPP
\ No newline at end of file
+#endif  // UI_HPP
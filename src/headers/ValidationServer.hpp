@@ -0,0 +1,423 @@
+#ifndef VALIDATIONSERVER_HPP
+#define VALIDATIONSERVER_HPP
+
+#include <Board.hpp>
+#include <LineServer.hpp>
+#include <MoveGenerator.hpp>
+#include <PolyglotBook.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Move validation for many live games at once, on a Unix domain socket. Clients write one command per
+// line and get one answer per line, prefixed with the game id:
+//
+//   new <id> [fen]      -> <id> ok                      starts (or restarts) game id, from the start position by default
+//   move <id> e7e8q     -> <id> ok|check|checkmate|stalemate|draw, or <id> illegal
+//   end <id>            -> <id> ended
+//   stats               -> stats games=.. validated=.. illegal=.. moves_per_sec=.. p50_us=.. p99_us=.. max_us=..
+//
+// A move is refused with "unknown" when the game was never started and with "over" once it has ended.
+// Answers for one game come in the order its commands were sent; those of different games may not.
+//
+// Games live in one arena allocated at start-up, a fixed-size record per game id, so that a game costs no
+// allocation while it is played. A game id always goes to the same worker (id modulo the worker count),
+// which is then the only thread to touch that record: no locking per game, and the moves of a game are
+// validated in order. Each worker keeps its own Board and MoveGenerator to check moves on. The socket and
+// the clients are handled by a LineServer.
+
+const int ARENA_REPETITION_KEYS = 101;      // positions since the last capture or pawn move, the fifty move rule's 100 plies at most
+const int VALIDATION_LATENCY_BUCKETS = 256; // quarter powers of two of nanoseconds
+const size_t VALIDATION_MAX_LINE = 256;
+
+enum class GameStatus : uint8_t {
+    EMPTY, PLAYING, ENDED
+};
+
+struct ArenaGame {
+    Position position;
+    uint32_t repetitionKeys[ARENA_REPETITION_KEYS];    // upper halves of the polyglot keys, the current position last
+    uint16_t keyCount;
+    GameStatus status;
+    uint32_t plies;
+};
+
+class ValidationServer {
+
+    private:
+        enum class Command : uint8_t {
+            NEW, MOVE, END
+        };
+
+        struct Request {
+            std::shared_ptr<LineConnection> connection;
+            Command command;
+            uint32_t gameId;
+            char move[6];
+            std::string fen;                // for NEW, empty for the start position
+            std::chrono::steady_clock::time_point received;
+        };
+
+        // One worker and the games it owns
+        struct Shard {
+            std::mutex queueMutex;
+            std::condition_variable queueChanged;
+            std::deque<Request> queue;
+            std::thread thread;
+
+            std::atomic<uint64_t> validated{0};
+            std::atomic<uint64_t> illegal{0};
+            std::atomic<uint64_t> latencies[VALIDATION_LATENCY_BUCKETS];
+        };
+
+        std::vector<ArenaGame> arena;
+        std::vector<std::unique_ptr<Shard>> shards;
+        std::atomic<int> liveGames;
+        LineServer server;
+
+        std::atomic<bool> stopping;
+
+        // Totals at the previous stats request, for the rate since then
+        std::mutex rateMutex;
+        uint64_t lastValidated;
+        std::chrono::steady_clock::time_point lastStats;
+
+        void work(Shard& shard);
+        void handle(const std::shared_ptr<LineConnection>& connection, const char* line, size_t length,
+                    std::chrono::steady_clock::time_point received);
+        std::string execute(Request& request, Board& board, MoveGenerator& moveGenerator);
+        std::string statistics();
+
+        static int latencyBucket(int64_t nanoseconds);
+        static double bucketMicroseconds(int bucket);
+
+    public:
+        // capacity is the number of game ids, 0 to capacity - 1
+        ValidationServer(uint32_t capacity, int threads);
+        ~ValidationServer();
+
+        // Creates the socket, replacing a stale one left at the path, and starts the workers
+        bool listen(const std::string& path);
+
+        // Accepts clients until stop() is called, then closes every connection and removes the socket
+        void serve();
+
+        // Safe from any thread and from a signal handler
+        void stop();
+
+        size_t getArenaBytes() { return arena.size() * sizeof(ArenaGame); }
+
+        // Copy constructor and copy assignment operators should not be allowed
+        ValidationServer(const ValidationServer&) = delete;
+        ValidationServer& operator=(const ValidationServer&) = delete;
+
+};
+
+ValidationServer::ValidationServer(uint32_t capacity, int threads)
+    : arena(capacity), liveGames(0),
+      server([this](const std::shared_ptr<LineConnection>& connection, const char* line, size_t length,
+                    std::chrono::steady_clock::time_point received) { handle(connection, line, length, received); },
+             VALIDATION_MAX_LINE, "error line too long"),
+      stopping(false), lastValidated(0), lastStats(std::chrono::steady_clock::now()) {
+
+    int shardCount = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 0; i < shardCount; i++) {
+        shards.emplace_back(new Shard());
+        for (std::atomic<uint64_t>& bucket : shards.back()->latencies) bucket = 0;
+    }
+    for (ArenaGame& game : arena) game.status = GameStatus::EMPTY;
+
+}
+
+ValidationServer::~ValidationServer() {
+    stop();
+    for (std::unique_ptr<Shard>& shard : shards) {
+        shard->queueChanged.notify_all();
+        if (shard->thread.joinable()) shard->thread.join();
+    }
+}
+
+bool ValidationServer::listen(const std::string& path) {
+
+    if (!server.listen(path)) return false;
+    for (std::unique_ptr<Shard>& shard : shards) shard->thread = std::thread(&ValidationServer::work, this, std::ref(*shard));
+    return true;
+
+}
+
+void ValidationServer::stop() {
+    stopping = true;
+    server.stop();
+}
+
+void ValidationServer::serve() {
+
+    server.serve();
+
+    for (std::unique_ptr<Shard>& shard : shards) {
+        shard->queueChanged.notify_all();
+        shard->thread.join();
+    }
+
+    server.close();
+
+}
+
+void ValidationServer::handle(const std::shared_ptr<LineConnection>& connection, const char* line, size_t length,
+                              std::chrono::steady_clock::time_point received) {
+
+    while (length && (line[length - 1] == '\r' || line[length - 1] == ' ')) length--;
+    if (length == 0) return;
+
+    // The command word, the game id and the rest of the line
+    const char* end = line + length;
+    const char* word = line;
+    while (word < end && *word == ' ') word++;
+    const char* wordEnd = std::find(word, end, ' ');
+    std::string command(word, wordEnd);
+
+    if (command == "stats") {
+        LineServer::send(*connection, statistics());
+        return;
+    }
+
+    Request request;
+    if (command == "new") request.command = Command::NEW;
+    else if (command == "move") request.command = Command::MOVE;
+    else if (command == "end") request.command = Command::END;
+    else {
+        LineServer::send(*connection, "error unknown command " + command);
+        return;
+    }
+
+    const char* field = wordEnd;
+    while (field < end && *field == ' ') field++;
+    char* idEnd;
+    unsigned long gameId = std::strtoul(field, &idEnd, 10);
+    if (idEnd == field || (idEnd < end && *idEnd != ' ')) {
+        LineServer::send(*connection, "error " + command + " needs a game id");
+        return;
+    }
+    if (gameId >= arena.size()) {
+        LineServer::send(*connection, std::to_string(gameId) + " error game id out of range");
+        return;
+    }
+
+    const char* rest = idEnd;
+    while (rest < end && *rest == ' ') rest++;
+
+    request.gameId = static_cast<uint32_t>(gameId);
+    request.received = received;
+    request.move[0] = '\0';
+    if (request.command == Command::MOVE) {
+        size_t moveLength = end - rest;
+        if (moveLength < 4 || moveLength > 5) {
+            LineServer::send(*connection, std::to_string(gameId) + " illegal");
+            return;
+        }
+        memcpy(request.move, rest, moveLength);
+        request.move[moveLength] = '\0';
+    }
+    if (request.command == Command::NEW) request.fen.assign(rest, end);
+    request.connection = connection;
+
+    LineServer::addPending(*connection);
+    Shard& shard = *shards[gameId % shards.size()];
+    {
+        std::lock_guard<std::mutex> lock(shard.queueMutex);
+        shard.queue.push_back(std::move(request));
+    }
+    shard.queueChanged.notify_one();
+
+}
+
+void ValidationServer::work(Shard& shard) {
+
+    Board board;
+    MoveGenerator moveGenerator(board);
+    std::deque<Request> batch;
+
+    while (true) {
+
+        // Everything queued at once: moves take microseconds, the lock would otherwise be taken for each
+        {
+            std::unique_lock<std::mutex> lock(shard.queueMutex);
+            shard.queueChanged.wait(lock, [&]() { return stopping || !shard.queue.empty(); });
+            if (stopping) return;
+            batch.swap(shard.queue);
+        }
+
+        for (Request& request : batch) {
+            LineConnection& connection = *request.connection;
+            if (connection.open) {
+                std::string answer = execute(request, board, moveGenerator);
+                LineServer::send(connection, answer);
+
+                if (request.command == Command::MOVE) {
+                    int64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - request.received).count();
+                    shard.latencies[latencyBucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+
+            LineServer::answered(connection);
+        }
+        batch.clear();
+    }
+
+}
+
+std::string ValidationServer::execute(Request& request, Board& board, MoveGenerator& moveGenerator) {
+
+    ArenaGame& game = arena[request.gameId];
+    std::string id = std::to_string(request.gameId);
+    Shard& shard = *shards[request.gameId % shards.size()];
+
+    if (request.command == Command::END) {
+        if (game.status != GameStatus::EMPTY) liveGames--;
+        game.status = GameStatus::EMPTY;
+        return id + " ended";
+    }
+
+    if (request.command == Command::NEW) {
+        if (!board.loadFEN(request.fen.empty() ? std::string(START_FEN) : request.fen)) return id + " error invalid fen";
+        if (game.status == GameStatus::EMPTY) liveGames++;
+        board.savePosition(game.position);
+        game.repetitionKeys[0] = static_cast<uint32_t>(polyglotKey(game.position) >> 32);
+        game.keyCount = 1;
+        game.plies = 0;
+        game.status = GameStatus::PLAYING;
+        return id + " ok";
+    }
+
+    if (game.status == GameStatus::EMPTY) return id + " unknown";
+    if (game.status == GameStatus::ENDED) return id + " over";
+
+    // Coordinate notation: from, to and the promotion piece when a pawn reaches the last rank
+    const char* text = request.move;
+    auto illegal = [&]() {
+        shard.illegal.fetch_add(1, std::memory_order_relaxed);
+        return id + " illegal";
+    };
+    if (text[0] < 'a' || text[0] > 'h' || text[1] < '1' || text[1] > '8' || text[2] < 'a' || text[2] > 'h' || text[3] < '1' || text[3] > '8') {
+        return illegal();
+    }
+    int fromPos = (text[1] - '1') * 8 + (text[0] - 'a');
+    int toPos = (text[3] - '1') * 8 + (text[2] - 'a');
+
+    board.loadPosition(game.position);
+    bool isWhite = board.isWhiteToMove();
+    PieceType piece = board.getPieceAtPosition(fromPos);
+    if (piece == PieceType::EMPTY || isWhitePiece(piece) != isWhite) return illegal();
+
+    PieceType promotion = PieceType::EMPTY;
+    bool promotes = (piece == PieceType::WP && toPos >= 56) || (piece == PieceType::BP && toPos < 8);
+    if (promotes != (text[4] != '\0')) return illegal();
+    if (promotes) {
+        switch (text[4]) {
+            case 'q': promotion = isWhite ? PieceType::WQ : PieceType::BQ; break;
+            case 'r': promotion = isWhite ? PieceType::WR : PieceType::BR; break;
+            case 'b': promotion = isWhite ? PieceType::WB : PieceType::BB; break;
+            case 'n': promotion = isWhite ? PieceType::WN : PieceType::BN; break;
+            default: return illegal();
+        }
+    }
+
+    if (!moveGenerator.isLegalMove(piece, fromPos, toPos)) return illegal();
+
+    board.executeMove(piece, fromPos, toPos, promotion);
+    board.savePosition(game.position);
+    game.plies++;
+    shard.validated.fetch_add(1, std::memory_order_relaxed);
+
+    // History for threefold repetition, which a capture or a pawn move starts afresh
+    uint32_t key = static_cast<uint32_t>(polyglotKey(game.position) >> 32);
+    if (board.getHalfmoveClock() == 0 || game.keyCount == ARENA_REPETITION_KEYS) game.keyCount = 0;
+    game.repetitionKeys[game.keyCount++] = key;
+
+    // The state of the game for the side now to move
+    moveGenerator.updatePieces();
+    bool inCheck = moveGenerator.isKingInCheck(board.isWhiteToMove());
+    if (!moveGenerator.hasLegalMove()) {
+        game.status = GameStatus::ENDED;
+        return id + (inCheck ? " checkmate" : " stalemate");
+    }
+
+    int repetitions = std::count(game.repetitionKeys, game.repetitionKeys + game.keyCount, key);
+    if (isDrawnByRule(board, repetitions)) {
+        game.status = GameStatus::ENDED;
+        return id + " draw";
+    }
+
+    return id + (inCheck ? " check" : " ok");
+
+}
+
+// Four buckets per doubling, which is within 19% of the true latency
+int ValidationServer::latencyBucket(int64_t nanoseconds) {
+    if (nanoseconds < 1) return 0;
+    int bucket = static_cast<int>(std::log2(static_cast<double>(nanoseconds)) * 4);
+    return std::min(bucket, VALIDATION_LATENCY_BUCKETS - 1);
+}
+
+double ValidationServer::bucketMicroseconds(int bucket) {
+    return std::exp2((bucket + 1) / 4.0) / 1000;
+}
+
+std::string ValidationServer::statistics() {
+
+    uint64_t validated = 0, illegal = 0;
+    std::vector<uint64_t> histogram(VALIDATION_LATENCY_BUCKETS, 0);
+    for (std::unique_ptr<Shard>& shard : shards) {
+        validated += shard->validated.load(std::memory_order_relaxed);
+        illegal += shard->illegal.load(std::memory_order_relaxed);
+        for (int i = 0; i < VALIDATION_LATENCY_BUCKETS; i++) histogram[i] += shard->latencies[i].load(std::memory_order_relaxed);
+    }
+
+    uint64_t samples = 0;
+    for (uint64_t count : histogram) samples += count;
+
+    // The upper edge of the bucket the fraction falls in
+    auto percentile = [&](double fraction) {
+        uint64_t target = static_cast<uint64_t>(fraction * samples), seen = 0;
+        for (int i = 0; i < VALIDATION_LATENCY_BUCKETS; i++) {
+            seen += histogram[i];
+            if (histogram[i] && seen > target) return bucketMicroseconds(i);
+        }
+        return 0.0;
+    };
+    int highest = VALIDATION_LATENCY_BUCKETS - 1;
+    while (highest > 0 && !histogram[highest]) highest--;
+
+    // The rate since the previous stats request
+    double rate;
+    {
+        std::lock_guard<std::mutex> lock(rateMutex);
+        auto now = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(now - lastStats).count();
+        rate = seconds > 0 ? (validated - lastValidated) / seconds : 0;
+        lastValidated = validated;
+        lastStats = now;
+    }
+
+    char text[256];
+    std::snprintf(text, sizeof(text), "stats games=%d validated=%llu illegal=%llu moves_per_sec=%.0f p50_us=%.1f p99_us=%.1f max_us=%.1f",
+                  liveGames.load(), static_cast<unsigned long long>(validated), static_cast<unsigned long long>(illegal), rate,
+                  percentile(0.5), percentile(0.99), samples ? bucketMicroseconds(highest) : 0.0);
+    return text;
+
+}
+
+#endif // VALIDATIONSERVER_HPP
@@ -3,8 +3,7 @@
 
 int main(int argc, char *argv[]){
 
-    AudioManager a;
-    Board b(a);
+    Board b;
     MoveGenerator mg(b);
 
     b.clearBoard();
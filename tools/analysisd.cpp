@@ -0,0 +1,129 @@
+// Analysis daemon: answers best move / evaluation requests from any number of clients over a Unix socket
+//
+// Usage: analysisd serve <socket> [--threads N] [--nodes N] [--time MS] [--tablebases DIR]
+//        analysisd send <socket>
+//
+// serve runs until interrupted; --nodes and --time cap what a request may ask for (see
+// AnalysisService.hpp for the protocol). send passes the request lines on standard input to a running
+// daemon and prints the answers as they come, with the throughput once every request is answered.
+
+#include <AnalysisService.hpp>
+#include <Bitbase.hpp>
+#include <Tablebase.hpp>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+AnalysisService* service = nullptr;
+
+void handleInterrupt(int) {
+    if (service) service->stop();
+}
+
+int serve(int argc, char *argv[]) {
+
+    ServiceLimits limits;
+    int threadCount = 0;
+    const char* tablebaseDirectory = nullptr;
+
+    for (int i = 3; i < argc; i += 2) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << option << " needs a value" << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (option == "--threads") threadCount = std::atoi(argv[i + 1]);
+        else if (option == "--nodes") limits.nodes = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (option == "--time") limits.timeMs = std::atoll(argv[i + 1]);
+        else if (option == "--tablebases") tablebaseDirectory = argv[i + 1];
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    Tablebases tablebases;
+    Bitbases bitbases;
+    if (tablebaseDirectory) {
+        std::printf("%d tablebases, %d bitbases found in %s\n", tablebases.open(tablebaseDirectory), bitbases.open(tablebaseDirectory),
+                    tablebaseDirectory);
+    }
+
+    AnalysisService analysisService(threadCount, limits, &tablebases, &bitbases);
+    if (!analysisService.listen(argv[2])) return EXIT_FAILURE;
+
+    service = &analysisService;
+    std::signal(SIGINT, handleInterrupt);
+    std::signal(SIGTERM, handleInterrupt);
+
+    std::printf("listening on %s\n", argv[2]);
+    std::fflush(stdout);
+    analysisService.serve();
+    service = nullptr;
+
+    std::printf("stopped\n");
+    return EXIT_SUCCESS;
+
+}
+
+int send(const std::string& path) {
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path too long: " << path << std::endl;
+        return EXIT_FAILURE;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        std::cerr << "Unable to connect to " << path << ": " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t requests = 0;
+
+    // Requests go out on one thread while the answers are read on this one
+    std::thread writer([fd, &requests]() {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            line += "\n";
+            if (::send(fd, line.data(), line.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(line.size())) break;
+            requests++;
+        }
+        shutdown(fd, SHUT_WR);
+    });
+
+    size_t answers = 0;
+    char buffer[4096];
+    ssize_t length;
+    while ((length = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+        fwrite(buffer, 1, length, stdout);
+        for (ssize_t i = 0; i < length; i++) answers += buffer[i] == '\n';
+    }
+    writer.join();
+    ::close(fd);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "%zu requests, %zu answers in %.3f s (%.0f per second)\n", requests, answers, seconds, answers / seconds);
+    return EXIT_SUCCESS;
+
+}
+
+int main(int argc, char *argv[]){
+
+    std::string mode = argc > 1 ? argv[1] : "";
+
+    if (mode == "serve" && argc >= 3) return serve(argc, argv);
+    if (mode == "send" && argc == 3) return send(argv[2]);
+
+    std::cerr << "Usage: " << argv[0] << " serve <socket> [--threads N] [--nodes N] [--time MS] [--tablebases DIR]" << std::endl;
+    std::cerr << "       " << argv[0] << " send <socket>" << std::endl;
+    return EXIT_FAILURE;
+
+}
@@ -0,0 +1,139 @@
+// Benchmark of attack map generation over many unrelated positions
+//
+// Usage: attack_bench [positions] [rounds] [seed]
+//
+// Plays random games to collect the positions, checks that the batched attacks (BatchAttacks.hpp) agree
+// on every one of them with MoveGenerator's square by square ray walks, which share no code with the fills,
+// then times four ways of finding both sides' attacks for all of them: the ray walks piece by piece,
+// MoveGenerator::generateAttacks, the set-wise fills one position at a time, and the set-wise fills on
+// ATTACK_BATCH positions at once in vector lanes.
+
+#include <BatchAttacks.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Every square one side attacks, piece by piece. Pawns only count where they could capture something.
+U64 referenceAttacks(MoveGenerator& moveGenerator, const Position& position, bool isWhite) {
+    U64 attacks = 0;
+    for (int type = isWhite ? 6 : 0, last = type + 6; type < last; type++) {
+        for (U64 pieces = position.bitboards[type]; pieces; pieces &= pieces - 1) {
+            attacks |= moveGenerator.generatePieceAttacks(static_cast<PieceType>(type), findLSBIndex(pieces));
+        }
+    }
+    return attacks;
+}
+
+int main(int argc, char *argv[]){
+
+    int positionCount = argc > 1 ? std::atoi(argv[1]) : 4096;
+    int rounds = argc > 2 ? std::atoi(argv[2]) : 20;
+    uint64_t seed = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1;
+    if (positionCount <= 0 || rounds <= 0) {
+        std::cerr << "Usage: " << argv[0] << " [positions] [rounds] [seed]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    positionCount = (positionCount + ATTACK_BATCH - 1) / ATTACK_BATCH * ATTACK_BATCH;
+
+    // Positions from random games, a few moves in to well into the middlegame
+    std::mt19937_64 random(seed);
+    std::vector<Position> positions;
+    std::vector<Move> moves;
+    Board board;
+    MoveGenerator moveGenerator(board);
+    while (static_cast<int>(positions.size()) < positionCount) {
+        board.loadFEN(START_FEN);
+        int plies = 4 + random() % 80;
+        for (int ply = 0; ply < plies; ply++) {
+            moveGenerator.generateLegalMoves(moves);
+            if (moves.empty()) break;
+            const Move& move = moves[random() % moves.size()];
+            board.executeMove(move.piece, move.fromPos, move.toPos, move.promotion);
+        }
+        Position position;
+        board.savePosition(position);
+        positions.push_back(position);
+    }
+
+    // A Board and MoveGenerator per position, so that the timing below leaves out loading positions
+    std::vector<std::unique_ptr<Board>> boards;
+    std::vector<std::unique_ptr<MoveGenerator>> generators;
+    for (const Position& position : positions) {
+        boards.emplace_back(new Board());
+        boards.back()->loadPosition(position);
+        generators.emplace_back(new MoveGenerator(*boards.back()));
+    }
+
+    std::vector<AttackBatch> batches(positionCount / ATTACK_BATCH);
+    for (int i = 0; i < positionCount; i++) setBatchPosition(batches[i / ATTACK_BATCH], i % ATTACK_BATCH, positions[i]);
+
+    // The reference counts a pawn's diagonal only where there is something to capture
+    size_t mismatches = 0;
+    for (AttackBatch& batch : batches) computeBatchAttacks(batch);
+    for (int i = 0; i < positionCount; i++) {
+        const AttackBatch& batch = batches[i / ATTACK_BATCH];
+        int lane = i % ATTACK_BATCH;
+        for (int side = 0; side < 2; side++) {
+            U64 enemy = 0;
+            for (int type = side == 1 ? 0 : 6, last = type + 6; type < last; type++) enemy |= positions[i].bitboards[type];
+            U64 expected = referenceAttacks(*generators[i], positions[i], side == 1);
+            U64 batched = batch.pieceAttacks[side][lane] | (batch.pawnAttacks[side][lane] & enemy);
+            if (expected != batched && mismatches++ == 0) {
+                std::fprintf(stderr, "Mismatch in %s for %s: %016llx, expected %016llx\n", boards[i]->getFEN().c_str(),
+                             side ? "white" : "black", static_cast<unsigned long long>(batched), static_cast<unsigned long long>(expected));
+            }
+        }
+    }
+
+    auto time = [&](auto&& body) {
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++) body();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return seconds * 1e9 / (static_cast<double>(rounds) * positionCount);
+    };
+
+    // Results are folded into a checksum so that none of the work can be left out
+    U64 checksum = 0;
+    double referenceNs = time([&]() {
+        for (int i = 0; i < positionCount; i++) {
+            checksum += referenceAttacks(*generators[i], positions[i], true) ^ referenceAttacks(*generators[i], positions[i], false);
+        }
+    });
+
+    double generatorNs = time([&]() {
+        for (int i = 0; i < positionCount; i++) checksum += generators[i]->generateAttacks(true) ^ generators[i]->generateAttacks(false);
+    });
+
+    double scalarNs = time([&]() {
+        for (const Position& position : positions) {
+            U64 pawnAttacks[2], pieceAttacks[2];
+            sideAttacks(position.bitboards, false, pawnAttacks[0], pieceAttacks[0]);
+            sideAttacks(position.bitboards, true, pawnAttacks[1], pieceAttacks[1]);
+            checksum += (pawnAttacks[1] | pieceAttacks[1]) ^ (pawnAttacks[0] | pieceAttacks[0]);
+        }
+    });
+
+    double batchNs = time([&]() {
+        for (AttackBatch& batch : batches) {
+            computeBatchAttacks(batch);
+            checksum += batch.pieceAttacks[1][0] ^ batch.pawnAttacks[0][ATTACK_BATCH - 1];
+        }
+    });
+
+    std::printf("%d positions, %d rounds, %d lanes per vector, checksum %016llx\n", positionCount, rounds, ATTACK_VECTOR_LANES,
+                static_cast<unsigned long long>(checksum));
+    std::printf("Ray walks, piece by piece:              %8.1f ns per position\n", referenceNs);
+    std::printf("MoveGenerator, one position at a time:  %8.1f ns per position (%.1fx)\n", generatorNs, referenceNs / generatorNs);
+    std::printf("Set-wise fills, one position at a time: %8.1f ns per position (%.1fx)\n", scalarNs, referenceNs / scalarNs);
+    std::printf("Set-wise fills, %d positions at a time:  %8.1f ns per position (%.1fx)\n", ATTACK_BATCH, batchNs, referenceNs / batchNs);
+
+    if (mismatches) {
+        std::cerr << mismatches << " attack maps differ from the ray walks" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+
+}
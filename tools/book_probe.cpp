@@ -0,0 +1,78 @@
+// Looks a position up in a Polyglot opening book
+//
+// Usage: book_probe <book.bin> [fen] [picks]
+//
+// Prints the book moves with their weights, then draws picks weighted random moves and how often
+// each one came up. Also reports how long opening the book and a single probe take.
+
+#include <PolyglotBook.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+
+std::string moveToString(const Move& move) {
+    std::string text;
+    text += static_cast<char>('a' + move.fromPos % 8);
+    text += static_cast<char>('1' + move.fromPos / 8);
+    text += static_cast<char>('a' + move.toPos % 8);
+    text += static_cast<char>('1' + move.toPos / 8);
+    if (move.promotion != PieceType::EMPTY) text += pieceTypeToChar(move.promotion);
+    return text;
+}
+
+int main(int argc, char *argv[]){
+
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <book.bin> [fen] [picks]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Board board;
+    MoveGenerator moveGenerator(board);
+
+    if (argc > 2 && !board.loadFEN(std::string(argv[2]))) {
+        std::cerr << "Invalid FEN: " << argv[2] << std::endl;
+        return EXIT_FAILURE;
+    }
+    int picks = argc > 3 ? std::atoi(argv[3]) : 1000;
+
+    PolyglotBook book;
+    auto start = std::chrono::steady_clock::now();
+    if (!book.open(argv[1])) return EXIT_FAILURE;
+    double openSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%zu entries, opened in %.1f us\n", book.getEntryCount(), openSeconds * 1e6);
+    std::printf("key %016llx\n", static_cast<unsigned long long>(polyglotKey(board)));
+
+    // Probe timing, the first probe faults in the pages it touches
+    const int probes = 10000;
+    std::vector<BookMove> moves;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < probes; i++) book.findMoves(board, moveGenerator, moves);
+    double probeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t totalWeight = 0;
+    for (const BookMove& bookMove : moves) totalWeight += bookMove.weight;
+
+    if (moves.empty()) {
+        std::printf("position not in book\n");
+        return EXIT_SUCCESS;
+    }
+
+    for (const BookMove& bookMove : moves) {
+        std::printf("%-6s weight %5u (%5.1f%%)\n", moveToString(bookMove.move).c_str(), bookMove.weight,
+                    totalWeight ? 100.0 * bookMove.weight / totalWeight : 0.0);
+    }
+    std::printf("probe: %.2f us\n", probeSeconds * 1e6 / probes);
+
+    std::map<std::string, int> counts;
+    for (int i = 0; i < picks; i++) {
+        Move move;
+        if (book.pickMove(board, moveGenerator, move)) counts[moveToString(move)]++;
+    }
+    for (const auto& count : counts) std::printf("picked %-6s %5.1f%%\n", count.first.c_str(), 100.0 * count.second / picks);
+
+    return EXIT_SUCCESS;
+
+}
@@ -0,0 +1,79 @@
+// Build step that turns asset files into a header of byte arrays, so they can be compiled into the game
+//
+// Usage: embed_assets <out.hpp> <asset>...
+// Each asset is looked up at run time by the path it was given here, e.g. src/assets/textures/bp.png.
+// The header is only rewritten when its contents change, so unchanged assets cause no rebuild.
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+bool readFile(const std::string& path, std::vector<unsigned char>& bytes) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+int main(int argc, char *argv[]){
+
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <out.hpp> <asset>..." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::ostringstream header;
+    header << "// Generated by tools/embed_assets.cpp, do not edit\n\n";
+    header << "#ifndef EMBEDDEDASSETS_HPP\n#define EMBEDDEDASSETS_HPP\n\n#include <cstddef>\n\n";
+
+    size_t total = 0;
+    std::vector<unsigned char> bytes;
+    std::vector<size_t> sizes;
+    for (int i = 2; i < argc; i++) {
+
+        if (!readFile(argv[i], bytes)) {
+            std::cerr << "Unable to read asset " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        header << "alignas(16) const unsigned char EMBEDDED_ASSET_" << i - 2 << "[] = {";
+        for (size_t j = 0; j < bytes.size(); j++) {
+            char hex[16];
+            std::snprintf(hex, sizeof(hex), "%s0x%02x,", j % 20 == 0 ? "\n    " : "", bytes[j]);
+            header << hex;
+        }
+        // Never empty, so that the array is valid even for an empty file
+        if (bytes.empty()) header << "0";
+        header << "\n};\n\n";
+        sizes.push_back(bytes.size());
+        total += bytes.size();
+    }
+
+    header << "struct EmbeddedAsset {\n    const char* path;\n    const unsigned char* data;\n    size_t size;\n};\n\n";
+    header << "const EmbeddedAsset EMBEDDED_ASSETS[] = {\n";
+    for (int i = 2; i < argc; i++) {
+        header << "    {\"" << argv[i] << "\", EMBEDDED_ASSET_" << i - 2 << ", " << sizes[i - 2] << "},\n";
+    }
+    header << "};\n\nconst size_t EMBEDDED_ASSET_COUNT = " << argc - 2 << ";\n\n#endif // EMBEDDEDASSETS_HPP\n";
+
+    // Leave the old header alone if nothing changed
+    std::vector<unsigned char> existing;
+    std::string generated = header.str();
+    if (readFile(argv[1], existing) && std::string(existing.begin(), existing.end()) == generated) return EXIT_SUCCESS;
+
+    std::ofstream output(argv[1], std::ios::binary);
+    output << generated;
+    if (!output) {
+        std::cerr << "Unable to write " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::printf("Embedded %d assets (%zu bytes) in %s\n", argc - 2, total, argv[1]);
+    return EXIT_SUCCESS;
+
+}
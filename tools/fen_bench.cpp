@@ -0,0 +1,96 @@
+// Microbenchmark for Board::loadFEN / Board::writeFEN
+//
+// Usage: fen_bench [fen_file] [iterations]
+// With no file, a built in set of positions is used. Each line of fen_file holds one FEN.
+
+#include <Board.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+const char* const SAMPLE_FENS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "8/8/8/8/8/8/6k1/4K2R w K - 12 57",
+};
+
+int main(int argc, char *argv[]){
+
+    // Load the positions to parse
+    std::vector<std::string> fens;
+
+    if (argc > 1) {
+        std::ifstream file(argv[1]);
+        if (!file) {
+            std::cerr << "Unable to open " << argv[1] << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.find_first_not_of(" \t\r") != std::string::npos) fens.push_back(line);
+        }
+    } else {
+        for (const char* fen : SAMPLE_FENS) fens.emplace_back(fen);
+    }
+
+    if (fens.empty()) {
+        std::cerr << "No FENs in " << argv[1] << std::endl;
+        std::cerr << "Usage: " << argv[0] << " [fen_file] [iterations]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    long iterations = argc > 2 ? std::atol(argv[2]) : 0;
+    if (iterations <= 0) iterations = 2000000 / static_cast<long>(fens.size()) + 1;
+
+    Board board;
+    char buffer[FEN_MAX_LENGTH];
+
+    // Round trip check, a FEN written back out must parse to the same FEN
+    size_t rejected = 0;
+    for (const std::string& fen : fens) {
+        if (!board.loadFEN(fen)) {
+            rejected++;
+            continue;
+        }
+        std::string written = board.getFEN();
+        Board copy = board;
+        if (!copy.loadFEN(written) || copy.getFEN() != written) {
+            std::cerr << "Round trip mismatch: " << fen << " -> " << written << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Parse
+    size_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) {
+        for (const std::string& fen : fens) {
+            checksum += board.loadFEN(fen.data(), fen.size());
+        }
+    }
+    double parseSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Serialise
+    start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) {
+        checksum += board.writeFEN(buffer);
+    }
+    double writeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double parsed = static_cast<double>(iterations) * fens.size();
+    std::printf("positions: %zu (%zu rejected), iterations: %ld\n", fens.size(), rejected, iterations);
+    std::printf("loadFEN : %.0f FENs/sec (%.1f ns/FEN)\n", parsed / parseSeconds, parseSeconds * 1e9 / parsed);
+    std::printf("writeFEN: %.0f FENs/sec (%.1f ns/FEN)\n", iterations / writeSeconds, writeSeconds * 1e9 / iterations);
+    std::printf("checksum: %zu\n", checksum);
+
+    return EXIT_SUCCESS;
+
+}
@@ -0,0 +1,149 @@
+// Converts PGN files into the binary game archive format and reads archives back
+//
+// Usage: game_archive pack <in.pgn> <out.bba> [threads]
+//        game_archive get <archive.bba> <game number>
+//        game_archive bench <in.pgn> <archive.bba>
+//
+// pack keeps the PGN game order by default. With more than one thread the games are encoded in
+// parallel and stored in the order they finish in.
+
+#include <GameArchive.hpp>
+#include <PgnReader.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+
+int pack(const char* pgnPath, const char* archivePath, int threadCount) {
+
+    PgnReader reader;
+    if (!reader.open(pgnPath)) return EXIT_FAILURE;
+
+    GameArchiveWriter writer;
+    if (!writer.open(archivePath)) return EXIT_FAILURE;
+
+    // Records are encoded on the PGN worker threads, only the append is serialised
+    struct WorkerCodec {
+        GameCodec codec;
+        std::vector<uint8_t> record;
+    };
+    std::vector<std::unique_ptr<WorkerCodec>> codecs;
+    int workers = std::max(1, threadCount);
+    for (int i = 0; i < workers; i++) codecs.emplace_back(new WorkerCodec);
+
+    std::mutex writerMutex;
+    size_t skipped = 0;
+
+    PgnStats stats = reader.run([&](const PgnGame& game, int worker) {
+
+        WorkerCodec& local = *codecs[worker];
+        local.record.clear();
+
+        bool encoded = game.complete && local.codec.encode(game.positions[0], game.moves, game.result, local.record);
+
+        std::lock_guard<std::mutex> lock(writerMutex);
+        if (encoded) writer.addRecord(local.record.data(), local.record.size());
+        else skipped++;
+
+    }, workers);
+
+    uint64_t games = writer.getGameCount();
+    if (!writer.close()) {
+        std::cerr << "Failed to write " << archivePath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    MappedFile archive;
+    archive.open(archivePath);
+    std::printf("packed %llu games (%zu skipped as incomplete) in %.3f s\n", static_cast<unsigned long long>(games), skipped, stats.seconds);
+    std::printf("PGN %zu bytes -> archive %zu bytes (%.1f%%)\n", stats.bytes, archive.getSize(), 100.0 * archive.getSize() / stats.bytes);
+    return EXIT_SUCCESS;
+
+}
+
+int get(const char* archivePath, uint64_t gameNumber) {
+
+    GameArchiveReader reader;
+    if (!reader.open(archivePath)) return EXIT_FAILURE;
+
+    ArchivedGame game;
+    if (!reader.readGame(gameNumber, game)) {
+        std::cerr << "Unable to read game " << gameNumber << " of " << reader.getGameCount() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Board board;
+    board.loadPosition(game.positions[0]);
+    std::cout << "[FEN \"" << board.getFEN() << "\"]" << std::endl;
+
+    for (const Move& move : game.moves) {
+        std::cout << static_cast<char>('a' + move.fromPos % 8) << 1 + move.fromPos / 8
+                  << static_cast<char>('a' + move.toPos % 8) << 1 + move.toPos / 8;
+        if (move.promotion != PieceType::EMPTY) std::cout << pieceTypeToChar(move.promotion);
+        std::cout << " ";
+    }
+
+    const char* results[] = {"1-0", "0-1", "1/2-1/2", "*"};
+    std::cout << results[static_cast<int>(game.result)] << std::endl;
+
+    board.loadPosition(game.positions.back());
+    std::cout << "Final position: " << board.getFEN() << std::endl;
+    return EXIT_SUCCESS;
+
+}
+
+// Single threaded comparison of replaying the PGN against decoding the archive. Only the PGN's complete
+// games are timed and counted, as pack leaves the rest out, so both sides cover the same games.
+int bench(const char* pgnPath, const char* archivePath) {
+
+    PgnReader pgnReader;
+    GameArchiveReader archiveReader;
+    if (!pgnReader.open(pgnPath) || !archiveReader.open(archivePath)) return EXIT_FAILURE;
+
+    // With one worker games arrive in file order, each as soon as it has been replayed, so the time
+    // since the previous callback is the time spent on that game
+    size_t pgnGames = 0, pgnPositions = 0;
+    double pgnSeconds = 0;
+    auto last = std::chrono::steady_clock::now();
+    pgnReader.run([&](const PgnGame& game, int) {
+        auto now = std::chrono::steady_clock::now();
+        if (game.complete) {
+            pgnGames++;
+            pgnPositions += game.positions.size();
+            pgnSeconds += std::chrono::duration<double>(now - last).count();
+        }
+        last = std::chrono::steady_clock::now();
+    }, 1);
+
+    size_t archivePositions = 0;
+    auto start = std::chrono::steady_clock::now();
+    uint64_t archiveGames = archiveReader.forEachGame([&](const ArchivedGame& game) { archivePositions += game.positions.size(); });
+    double archiveSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("PGN    : %zu games, %zu positions, %.0f games/sec\n", pgnGames, pgnPositions, pgnGames / pgnSeconds);
+    std::printf("archive: %llu games, %zu positions, %.0f games/sec\n", static_cast<unsigned long long>(archiveGames), archivePositions, archiveGames / archiveSeconds);
+    std::printf("speedup: %.1fx\n", (archiveGames / archiveSeconds) / (pgnGames / pgnSeconds));
+
+    if (archiveGames != pgnGames || archivePositions != pgnPositions) {
+        std::cerr << archivePath << " does not hold the complete games of " << pgnPath << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+
+}
+
+int main(int argc, char *argv[]){
+
+    std::string mode = argc > 1 ? argv[1] : "";
+
+    if (mode == "pack" && argc >= 4) return pack(argv[2], argv[3], argc > 4 ? std::atoi(argv[4]) : 1);
+    if (mode == "get" && argc == 4) return get(argv[2], std::strtoull(argv[3], nullptr, 10));
+    if (mode == "bench" && argc == 4) return bench(argv[2], argv[3]);
+
+    std::cerr << "Usage: " << argv[0] << " pack <in.pgn> <out.bba> [threads]" << std::endl;
+    std::cerr << "       " << argv[0] << " get <archive.bba> <game number>" << std::endl;
+    std::cerr << "       " << argv[0] << " bench <in.pgn> <archive.bba>" << std::endl;
+    return EXIT_FAILURE;
+
+}
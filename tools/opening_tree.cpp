@@ -0,0 +1,128 @@
+// Builds opening books and explorer trees from PGN files and game archives, and queries them
+//
+// Usage: opening_tree build <out.bin|out.bbt> <games.pgn|games.bba>... [options]
+//            --plies N       positions counted per game (default 30)
+//            --min-count N   drop moves played fewer than N times (default 2)
+//            --memory MB     hash map budget before spilling sorted runs to disk (default 256)
+//            --threads N     worker threads, 0 for every core (default 0)
+//            --temp DIR      directory for the sorted runs (default .)
+//        opening_tree query <tree.bbt> [fen]
+//
+// Output ending in .bin is written as a Polyglot book, anything else as an opening tree.
+
+#include <GameArchive.hpp>
+#include <OpeningTree.hpp>
+#include <PgnReader.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+int build(int argc, char *argv[]) {
+
+    std::string output = argv[2];
+    std::vector<std::string> inputs;
+    OpeningTreeOptions options;
+    options.threadCount = 0;
+
+    for (int i = 3; i < argc; i++) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--plies" && hasValue) options.maxPlies = std::atoi(argv[++i]);
+        else if (argument == "--min-count" && hasValue) options.minCount = static_cast<uint32_t>(std::atoi(argv[++i]));
+        else if (argument == "--memory" && hasValue) options.memoryBudget = static_cast<size_t>(std::atoll(argv[++i])) * 1024 * 1024;
+        else if (argument == "--threads" && hasValue) options.threadCount = std::atoi(argv[++i]);
+        else if (argument == "--temp" && hasValue) options.tempDirectory = argv[++i];
+        else inputs.push_back(argument);
+    }
+
+    if (options.threadCount <= 0) options.threadCount = std::max(1u, std::thread::hardware_concurrency());
+    if (inputs.empty()) {
+        std::cerr << "No input files" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    OpeningTreeBuilder builder(options);
+    auto start = std::chrono::steady_clock::now();
+
+    for (const std::string& input : inputs) {
+
+        if (endsWith(input, ".pgn")) {
+            PgnReader reader;
+            if (!reader.open(input)) return EXIT_FAILURE;
+            reader.run([&](const PgnGame& game, int worker) {
+                builder.addGame(game.moves, game.positions, game.result, worker);
+            }, options.threadCount);
+        } else {
+            GameArchiveReader reader;
+            if (!reader.open(input)) return EXIT_FAILURE;
+            reader.run([&](const ArchivedGame& game, int worker) {
+                builder.addGame(game.moves, game.positions, game.result, worker);
+            }, options.threadCount);
+        }
+    }
+
+    double replaySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    bool written = endsWith(output, ".bin") ? builder.writePolyglot(output) : builder.writeTree(output);
+    double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!written) return EXIT_FAILURE;
+
+    OpeningTreeStats stats = builder.getStats();
+    std::printf("%llu games, %llu positions replayed in %.2f s on %d threads (%.0f games/sec)\n",
+                static_cast<unsigned long long>(stats.games), static_cast<unsigned long long>(stats.positions),
+                replaySeconds, options.threadCount, stats.games / replaySeconds);
+    std::printf("%llu sorted runs, %llu run records merged into %llu moves (min count %u) in %.2f s\n",
+                static_cast<unsigned long long>(stats.runs), static_cast<unsigned long long>(stats.mergedRecords),
+                static_cast<unsigned long long>(stats.writtenRecords), options.minCount, totalSeconds - replaySeconds);
+    return EXIT_SUCCESS;
+
+}
+
+int query(const char* treePath, const char* fen) {
+
+    OpeningTree tree;
+    if (!tree.open(treePath)) return EXIT_FAILURE;
+
+    Board board;
+    if (fen && !board.loadFEN(std::string(fen))) {
+        std::cerr << "Invalid FEN: " << fen << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<TreeRecord> moves;
+    if (tree.findMoves(polyglotKey(board), moves) == 0) {
+        std::printf("position not in tree\n");
+        return EXIT_SUCCESS;
+    }
+
+    std::sort(moves.begin(), moves.end(), [](const TreeRecord& a, const TreeRecord& b) { return a.stats.count > b.stats.count; });
+
+    std::printf("move     games    win   draw   loss\n");
+    for (const TreeRecord& record : moves) {
+        int from = (record.move >> 6) & 63, to = record.move & 63;
+        const MoveStats& stats = record.stats;
+        double decided = stats.wins + stats.draws + stats.losses;
+        if (decided == 0) decided = 1;
+        std::printf("%c%d%c%d  %8u %5.1f%% %5.1f%% %5.1f%%\n", 'a' + from % 8, 1 + from / 8, 'a' + to % 8, 1 + to / 8,
+                    stats.count, 100.0 * stats.wins / decided, 100.0 * stats.draws / decided, 100.0 * stats.losses / decided);
+    }
+    return EXIT_SUCCESS;
+
+}
+
+int main(int argc, char *argv[]){
+
+    std::string mode = argc > 1 ? argv[1] : "";
+
+    if (mode == "build" && argc >= 4) return build(argc, argv);
+    if (mode == "query" && (argc == 3 || argc == 4)) return query(argv[2], argc == 4 ? argv[3] : nullptr);
+
+    std::cerr << "Usage: " << argv[0] << " build <out.bin|out.bbt> <games.pgn|games.bba>... [--plies N] [--min-count N] [--memory MB] [--threads N] [--temp DIR]" << std::endl;
+    std::cerr << "       " << argv[0] << " query <tree.bbt> [fen]" << std::endl;
+    return EXIT_FAILURE;
+
+}
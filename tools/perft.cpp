@@ -0,0 +1,132 @@
+// Move generator check: counts the leaf nodes of the legal move tree (perft) of well known positions and
+// compares them against their published counts
+//
+// Usage: perft [--deep]
+//        perft <fen> <depth>
+//
+// With no position, runs the standard suite, one ply deeper with --deep, and fails if any count is off.
+// Given a position, prints the count below each legal move and the total, for narrowing down a wrong count.
+
+#include <Board.hpp>
+#include <MoveGenerator.hpp>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+struct PerftCase {
+    const char* fen;
+    int depth;              // the --deep run adds one
+    uint64_t nodes;
+    uint64_t deepNodes;
+};
+
+// Start position, "Kiwipete", and positions 3, 4 and 5 of the Chess Programming Wiki's perft results
+const PerftCase PERFT_SUITE[] = {
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 4, 197281, 4865609},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 3, 97862, 4085603},
+    {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624, 11030083},
+    {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333, 15833292},
+    {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 3, 62379, 2103487},
+};
+
+// Leaf nodes depth plies below the board's position, with one move list per ply so that none is allocated
+// on the way
+uint64_t perft(Board& board, MoveGenerator& moveGenerator, int depth, std::vector<std::vector<Move>>& moveLists) {
+
+    std::vector<Move>& moves = moveLists[depth];
+    moveGenerator.generateLegalMoves(moves);
+    if (depth == 1) return moves.size();
+
+    Position position;
+    board.savePosition(position);
+
+    uint64_t nodes = 0;
+    for (const Move& move : moves) {
+        board.executeMove(move.piece, move.fromPos, move.toPos, move.promotion);
+        nodes += perft(board, moveGenerator, depth - 1, moveLists);
+        board.loadPosition(position);
+    }
+    return nodes;
+
+}
+
+int divide(const std::string& fen, int depth) {
+
+    Board board;
+    MoveGenerator moveGenerator(board);
+    if (depth < 1 || !board.loadFEN(fen)) {
+        std::cerr << "Invalid position or depth" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::vector<Move>> moveLists(depth + 1);
+    std::vector<Move> moves;
+    moveGenerator.generateLegalMoves(moves);
+
+    Position position;
+    board.savePosition(position);
+
+    uint64_t total = 0;
+    for (const Move& move : moves) {
+        board.executeMove(move.piece, move.fromPos, move.toPos, move.promotion);
+        uint64_t nodes = depth > 1 ? perft(board, moveGenerator, depth - 1, moveLists) : 1;
+        board.loadPosition(position);
+
+        std::printf("%c%d%c%d", 'a' + move.fromPos % 8, 1 + move.fromPos / 8, 'a' + move.toPos % 8, 1 + move.toPos / 8);
+        if (move.promotion != PieceType::EMPTY) std::printf("%c", tolower(pieceTypeToChar(move.promotion)));
+        std::printf(": %llu\n", static_cast<unsigned long long>(nodes));
+        total += nodes;
+    }
+
+    std::printf("total: %llu\n", static_cast<unsigned long long>(total));
+    return EXIT_SUCCESS;
+
+}
+
+int suite(bool deep) {
+
+    int failures = 0;
+    uint64_t totalNodes = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (const PerftCase& test : PERFT_SUITE) {
+        Board board;
+        MoveGenerator moveGenerator(board);
+        board.loadFEN(std::string(test.fen));
+
+        int depth = test.depth + (deep ? 1 : 0);
+        uint64_t expected = deep ? test.deepNodes : test.nodes;
+        std::vector<std::vector<Move>> moveLists(depth + 1);
+
+        auto caseStart = std::chrono::steady_clock::now();
+        uint64_t nodes = perft(board, moveGenerator, depth, moveLists);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - caseStart).count();
+        totalNodes += nodes;
+
+        bool ok = nodes == expected;
+        if (!ok) failures++;
+        std::printf("%-4s depth %d: %10llu nodes (expected %10llu) %8.3f s  %s\n", ok ? "ok" : "FAIL", depth,
+                    static_cast<unsigned long long>(nodes), static_cast<unsigned long long>(expected), seconds, test.fen);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%llu nodes in %.3f s (%.0f nodes/sec), %d failed\n", static_cast<unsigned long long>(totalNodes), seconds,
+                totalNodes / seconds, failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+
+}
+
+int main(int argc, char *argv[]){
+
+    if (argc == 1) return suite(false);
+    if (argc == 2 && std::string(argv[1]) == "--deep") return suite(true);
+    if (argc == 3) return divide(argv[1], std::atoi(argv[2]));
+
+    std::cerr << "Usage: " << argv[0] << " [--deep]" << std::endl;
+    std::cerr << "       " << argv[0] << " <fen> <depth>" << std::endl;
+    return EXIT_FAILURE;
+
+}
@@ -0,0 +1,68 @@
+// Replays every game of a PGN file through the move generator and reports throughput
+//
+// Usage: pgn_ingest <file.pgn> [threads]
+
+#include <PgnReader.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+int main(int argc, char *argv[]){
+
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <file.pgn> [threads]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Resolved here the way PgnReader::run would, so that there is a tally for every worker index it hands out
+    int threadCount = argc > 2 ? std::atoi(argv[2]) : 0;
+    if (threadCount <= 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    PgnReader reader;
+    if (!reader.open(argv[1])) return EXIT_FAILURE;
+
+    // Per worker tallies, padded so that the workers do not share cache lines
+    struct alignas(64) WorkerTally {
+        size_t positions = 0;
+        size_t results[4] = {0, 0, 0, 0};
+    };
+    std::vector<WorkerTally> tallies(threadCount);
+
+    std::mutex logMutex;
+    size_t loggedFailures = 0;
+
+    PgnStats stats = reader.run([&](const PgnGame& game, int worker) {
+
+        WorkerTally& tally = tallies[worker];
+        tally.positions += game.positions.size();
+        tally.results[static_cast<int>(game.result)]++;
+
+        // Show the first few games that could not be replayed completely
+        if (!game.complete) {
+            std::lock_guard<std::mutex> lock(logMutex);
+            if (loggedFailures++ < 5) {
+                std::cerr << "Could not replay past ply " << game.moves.size() << " of game:\n" << game.tags << std::endl;
+            }
+        }
+
+    }, threadCount);
+
+    size_t positions = 0, results[4] = {0, 0, 0, 0};
+    for (const WorkerTally& tally : tallies) {
+        positions += tally.positions;
+        for (int i = 0; i < 4; i++) results[i] += tally.results[i];
+    }
+
+    double megabytes = stats.bytes / (1024.0 * 1024.0);
+    std::printf("games     : %zu (%zu incomplete)\n", stats.games, stats.incompleteGames);
+    std::printf("results   : 1-0 %zu, 0-1 %zu, 1/2-1/2 %zu, unknown %zu\n", results[0], results[1], results[2], results[3]);
+    std::printf("plies     : %zu (%zu positions)\n", stats.plies, positions);
+    std::printf("time      : %.3f s\n", stats.seconds);
+    std::printf("throughput: %.0f games/sec, %.0f plies/sec, %.2f MB/s\n",
+                stats.games / stats.seconds, stats.plies / stats.seconds, megabytes / stats.seconds);
+
+    return EXIT_SUCCESS;
+
+}
@@ -0,0 +1,87 @@
+// Plays engine games against itself to produce labelled positions for evaluation tuning
+//
+// Usage: selfplay <out.bin> [--games N] [--threads N] [--nodes N] [--random-plies N] [--seed N]
+//
+// Runs one game per core, each move a search of --nodes nodes, each game opened with --random-plies
+// random moves. Running it again on the same file resumes where it stopped: Ctrl-C keeps every finished
+// game. Reports positions per second for each core as it goes.
+
+#include <SelfPlay.hpp>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+
+SelfPlayFarm farm;
+
+void handleInterrupt(int) {
+    farm.stop();
+}
+
+int main(int argc, char *argv[]){
+
+    if (argc < 2 || argc % 2 != 0) {
+        std::cerr << "Usage: " << argv[0] << " <out.bin> [--games N] [--threads N] [--nodes N] [--random-plies N] [--seed N]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    SelfPlaySettings settings;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        uint64_t value = std::strtoull(argv[i + 1], nullptr, 10);
+        if (option == "--games") settings.games = value;
+        else if (option == "--threads") settings.threads = static_cast<int>(value);
+        else if (option == "--nodes") settings.nodes = std::max<uint64_t>(1, value);
+        else if (option == "--random-plies") settings.randomPlies = static_cast<int>(value);
+        else if (option == "--seed") settings.seed = value;
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (settings.threads <= 0) settings.threads = std::max(1u, std::thread::hardware_concurrency());
+
+    if (!farm.open(argv[1])) return EXIT_FAILURE;
+    if (farm.getResumedGames()) {
+        std::printf("resuming: %llu games, %llu positions already in %s\n", static_cast<unsigned long long>(farm.getResumedGames()),
+                    static_cast<unsigned long long>(farm.getResumedPositions()), argv[1]);
+    }
+
+    std::signal(SIGINT, handleInterrupt);
+    std::signal(SIGTERM, handleInterrupt);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<SelfPlayWorkerStats> last;
+
+    bool written = farm.run(settings, [&](const std::vector<SelfPlayWorkerStats>& stats) {
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        uint64_t games = 0, positions = 0;
+        std::string perCore;
+        for (const SelfPlayWorkerStats& worker : stats) {
+            games += worker.games;
+            positions += worker.positions;
+            char rate[24];
+            std::snprintf(rate, sizeof(rate), " %.0f", worker.positions / seconds);
+            perCore += rate;
+        }
+
+        std::printf("%7.0f s  %llu games  %llu positions  %.0f positions/s  per core:%s\n", seconds,
+                    static_cast<unsigned long long>(games), static_cast<unsigned long long>(positions), positions / seconds, perCore.c_str());
+        std::fflush(stdout);
+        last = stats;
+
+    });
+
+    farm.close();
+
+    uint64_t games = farm.getResumedGames(), positions = farm.getResumedPositions();
+    for (const SelfPlayWorkerStats& worker : last) {
+        games += worker.games;
+        positions += worker.positions;
+    }
+    std::printf("%s: %llu games, %llu positions\n", argv[1], static_cast<unsigned long long>(games), static_cast<unsigned long long>(positions));
+
+    return written ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
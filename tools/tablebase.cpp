@@ -0,0 +1,297 @@
+// Generates endgame tablebases, and probes and verifies them
+//
+// Usage: tablebase build <dir> <material|all>... [--threads N]
+//        tablebase bitbase <dir> <material>... [--threads N]
+//        tablebase probe <dir> <fen>
+//        tablebase verify <dir> <material> [samples]
+//
+// Materials are named white pieces first, e.g. KQK or KRKP; all builds every 3 and 4 piece table. bitbase
+// builds the tables like build does and also writes a bitbase of each material given. verify
+// plays the moves of random positions of a table with MoveGenerator and checks that every stored result
+// follows from the stored results of the positions its moves lead to.
+
+#include <MoveGenerator.hpp>
+#include <TablebaseGenerator.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+
+std::string moveToString(const Move& move) {
+    std::string text;
+    text += static_cast<char>('a' + move.fromPos % 8);
+    text += static_cast<char>('1' + move.fromPos / 8);
+    text += static_cast<char>('a' + move.toPos % 8);
+    text += static_cast<char>('1' + move.toPos / 8);
+    if (move.promotion != PieceType::EMPTY) text += pieceTypeToChar(move.promotion);
+    return text;
+}
+
+std::string describe(const TablebaseEntry& entry) {
+    char text[48];
+    if (entry.result == TablebaseResult::WIN) std::snprintf(text, sizeof(text), "win, mate in %d (%d plies)", (entry.distance + 1) / 2, entry.distance);
+    else if (entry.result == TablebaseResult::LOSS) std::snprintf(text, sizeof(text), "loss, mated in %d (%d plies)", entry.distance / 2, entry.distance);
+    else std::snprintf(text, sizeof(text), "draw");
+    return text;
+}
+
+// Result of the position on the board, bare kings are drawn without a table
+bool probeBoard(const Tablebases& tablebases, Board& board, TablebaseEntry& entry) {
+
+    Position position;
+    board.savePosition(position);
+
+    int pieces = 0;
+    for (int type = 0; type < 12; type++) pieces += countSetBits(position.bitboards[type]);
+    if (pieces == 2) {
+        entry = {TablebaseResult::DRAW, 0};
+        return true;
+    }
+    return tablebases.probe(position, entry);
+
+}
+
+// Ranks results for the side to move: quick wins first, then draws, then the slowest losses
+int resultOrder(const TablebaseEntry& entry) {
+    if (entry.result == TablebaseResult::WIN) return entry.distance;
+    if (entry.result == TablebaseResult::DRAW) return 1000;
+    return 2000 - entry.distance;
+}
+
+int build(int argc, char *argv[], bool writeBitbases) {
+
+    std::string directory = argv[2];
+    std::vector<std::string> materials;
+    int threadCount = 0;
+
+    for (int i = 3; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--threads" && i + 1 < argc) threadCount = std::atoi(argv[++i]);
+        else materials.push_back(argument);
+    }
+    if (threadCount <= 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    // Every combination of up to two pieces besides the kings, named the way the tables are stored
+    if (std::find(materials.begin(), materials.end(), "all") != materials.end()) {
+        std::set<std::string> all;
+        std::string letters = TABLEBASE_PIECE_ORDER;
+        for (char first : letters) {
+            all.insert(std::string("K") + first + "K");
+            for (char second : letters) {
+                TablebaseMaterial material;
+                if (parseTablebaseMaterial(std::string("K") + first + second + "K", material)) all.insert(material.name);
+                if (parseTablebaseMaterial(std::string("K") + first + "K" + second, material)) all.insert(material.name);
+            }
+        }
+        materials.assign(all.begin(), all.end());
+        std::sort(materials.begin(), materials.end(), [](const std::string& a, const std::string& b) {
+            return a.size() != b.size() ? a.size() < b.size() : a < b;
+        });
+    }
+
+    if (materials.empty()) {
+        std::cerr << "No materials given" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    TablebaseGenerator generator(threadCount);
+    size_t reported = 0;
+
+    for (const std::string& material : materials) {
+        bool generated = generator.generate(material, directory);
+
+        const std::vector<TablebaseStats>& stats = generator.getStats();
+        for (; reported < stats.size(); reported++) {
+            const TablebaseStats& table = stats[reported];
+            std::printf("%-6s %10llu positions: %llu won, %llu drawn, %llu lost, longest mate %d plies (%d passes, %.1f s)\n",
+                        table.name.c_str(), static_cast<unsigned long long>(table.positions),
+                        static_cast<unsigned long long>(table.wins), static_cast<unsigned long long>(table.draws),
+                        static_cast<unsigned long long>(table.losses), table.maxDistance, table.iterations, table.seconds);
+        }
+
+        if (!generated) return EXIT_FAILURE;
+
+        if (!writeBitbases) continue;
+        TablebaseMaterial parsed;
+        parseTablebaseMaterial(material, parsed);
+        std::string bitbasePath = directory + "/" + parsed.name + BITBASE_EXTENSION;
+        if (!generator.writeBitbase(material, bitbasePath)) return EXIT_FAILURE;
+        std::printf("wrote %s\n", bitbasePath.c_str());
+    }
+
+    return EXIT_SUCCESS;
+
+}
+
+int probe(const std::string& directory, const std::string& fen) {
+
+    Tablebases tablebases;
+    Bitbases bitbases;
+    int tableCount = tablebases.open(directory), bitbaseCount = bitbases.open(directory);
+    if (tableCount == 0 && bitbaseCount == 0) {
+        std::cerr << "No tablebases or bitbases in " << directory << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Board board;
+    MoveGenerator moveGenerator(board);
+    if (!board.loadFEN(fen)) {
+        std::cerr << "Invalid FEN: " << fen << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // The bitbase answers from the board itself
+    const int bitbaseProbes = 1000000;
+    TablebaseResult bitbaseResult = TablebaseResult::INVALID;
+    for (int i = 0; i < bitbaseProbes; i++) bitbases.probe(board, bitbaseResult);
+    BitbaseCounters counters = bitbases.getCounters();
+    if (counters.hits) {
+        const char* names[] = {"draw", "win", "loss"};
+        std::printf("bitbase: %s (%llu probes, %.1f%% hits, %.1f ns per probe)\n", names[static_cast<int>(bitbaseResult)],
+                    static_cast<unsigned long long>(counters.probes), 100.0 * counters.hits / counters.probes, counters.averageNanoseconds);
+    }
+
+    Position position;
+    board.savePosition(position);
+    TablebaseEntry entry;
+
+    // The first probe faults in the pages it touches
+    const int probes = 100000;
+    bool found = false;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < probes; i++) found = tablebases.probe(position, entry);
+    double probeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!found) {
+        std::printf("position not in the tablebases\n");
+        return EXIT_SUCCESS;
+    }
+    std::printf("%s\nprobe: %.3f us\n", describe(entry).c_str(), probeSeconds * 1e6 / probes);
+
+    // Every move with the result it leads to, for the side playing it
+    std::vector<Move> moves;
+    moveGenerator.generateLegalMoves(moves);
+    std::vector<std::pair<TablebaseEntry, Move>> results;
+
+    for (const Move& move : moves) {
+        board.loadPosition(position);
+        board.executeMove(move.piece, move.fromPos, move.toPos, move.promotion);
+        if (!probeBoard(tablebases, board, entry)) continue;
+
+        if (entry.result == TablebaseResult::WIN) entry = {TablebaseResult::LOSS, entry.distance + 1};
+        else if (entry.result == TablebaseResult::LOSS) entry = {TablebaseResult::WIN, entry.distance + 1};
+        results.push_back({entry, move});
+    }
+
+    std::stable_sort(results.begin(), results.end(), [](const std::pair<TablebaseEntry, Move>& a, const std::pair<TablebaseEntry, Move>& b) {
+        return resultOrder(a.first) < resultOrder(b.first);
+    });
+    for (const auto& result : results) std::printf("%-6s %s\n", moveToString(result.second).c_str(), describe(result.first).c_str());
+
+    return EXIT_SUCCESS;
+
+}
+
+int verify(const std::string& directory, const std::string& name, int samples) {
+
+    Tablebases tablebases;
+    tablebases.open(directory);
+
+    TablebaseMaterial material;
+    if (!parseTablebaseMaterial(name, material)) {
+        std::cerr << "Not a tablebase material: " << name << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Board board;
+    MoveGenerator moveGenerator(board);
+    std::mt19937_64 random(12345);
+    std::vector<Move> moves;
+    int checked = 0, skipped = 0, mismatches = 0;
+
+    for (int sample = 0; sample < samples; sample++) {
+
+        int squares[TABLEBASE_MAX_PIECES];
+        tablebaseSquares(material, random() % material.positions, squares);
+
+        Position position = {};
+        position.whiteToMove = random() % 2 == 0;
+        position.enPassantSquare = -1;
+        position.fullmoveNumber = 1;
+        for (int i = 0; i < material.count; i++) position.bitboards[static_cast<int>(material.pieces[i])] |= 1ULL << squares[i];
+
+        TablebaseEntry stored;
+        if (!tablebases.probe(position, stored)) {
+            skipped++;
+            continue;
+        }
+
+        // What the results of the moves say this position is
+        board.loadPosition(position);
+        moveGenerator.generateLegalMoves(moves);
+
+        TablebaseEntry expected = {TablebaseResult::LOSS, 0};
+        bool complete = true;
+        if (moves.empty()) {
+            moveGenerator.updatePieces();
+            if (!moveGenerator.isKingInCheck(position.whiteToMove)) expected.result = TablebaseResult::DRAW;
+        }
+
+        int shortestLoss = -1, longestWin = -1;
+        bool hasDraw = false;
+        for (const Move& move : moves) {
+            board.loadPosition(position);
+            board.executeMove(move.piece, move.fromPos, move.toPos, move.promotion);
+
+            TablebaseEntry child;
+            if (!probeBoard(tablebases, board, child)) {
+                complete = false;
+                break;
+            }
+            if (child.result == TablebaseResult::LOSS && (shortestLoss < 0 || child.distance < shortestLoss)) shortestLoss = child.distance;
+            if (child.result == TablebaseResult::WIN) longestWin = std::max(longestWin, child.distance);
+            if (child.result == TablebaseResult::DRAW) hasDraw = true;
+        }
+
+        if (!complete) {
+            skipped++;
+            continue;
+        }
+
+        if (shortestLoss >= 0) expected = {TablebaseResult::WIN, shortestLoss + 1};
+        else if (hasDraw) expected = {TablebaseResult::DRAW, 0};
+        else if (longestWin >= 0) expected = {TablebaseResult::LOSS, longestWin + 1};
+
+        checked++;
+        if (expected.result != stored.result || expected.distance != stored.distance) {
+            mismatches++;
+            if (mismatches <= 10) {
+                board.loadPosition(position);
+                std::printf("%s stored %s, moves say %s\n", board.getFEN().c_str(), describe(stored).c_str(), describe(expected).c_str());
+            }
+        }
+    }
+
+    std::printf("%d positions checked, %d mismatches (%d illegal or not covered skipped)\n", checked, mismatches, skipped);
+    return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
+
+int main(int argc, char *argv[]){
+
+    std::string mode = argc > 1 ? argv[1] : "";
+
+    if (mode == "build" && argc >= 4) return build(argc, argv, false);
+    if (mode == "bitbase" && argc >= 4) return build(argc, argv, true);
+    if (mode == "probe" && argc == 4) return probe(argv[2], argv[3]);
+    if (mode == "verify" && (argc == 4 || argc == 5)) return verify(argv[2], argv[3], argc == 5 ? std::atoi(argv[4]) : 100000);
+
+    std::cerr << "Usage: " << argv[0] << " build <dir> <material|all>... [--threads N]" << std::endl;
+    std::cerr << "       " << argv[0] << " bitbase <dir> <material>... [--threads N]" << std::endl;
+    std::cerr << "       " << argv[0] << " probe <dir> <fen>" << std::endl;
+    std::cerr << "       " << argv[0] << " verify <dir> <material> [samples]" << std::endl;
+    return EXIT_FAILURE;
+
+}
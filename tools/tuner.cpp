@@ -0,0 +1,76 @@
+// Tunes the evaluation weights on self-play positions (Texel's method)
+//
+// Usage: tuner <selfplay.bin>... [--epochs N] [--threads N] [--rate R] [--lambda L] [--out FILE]
+//
+// Loads every position of the self-play files (see selfplay), fits the sigmoid scale to the current
+// weights and runs --epochs gradient descent steps over all of them. The tuned weights are written as a
+// header, by default over src/headers/EvaluationParameters.hpp so that the next build plays with them.
+
+#include <Tuner.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char *argv[]){
+
+    TunerSettings settings;
+    std::vector<std::string> paths;
+    std::string out = "src/headers/EvaluationParameters.hpp";
+    int epochs = 500;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--epochs" && hasValue) epochs = std::atoi(argv[++i]);
+        else if (argument == "--threads" && hasValue) settings.threads = std::atoi(argv[++i]);
+        else if (argument == "--rate" && hasValue) settings.rate = std::atof(argv[++i]);
+        else if (argument == "--lambda" && hasValue) settings.lambda = std::atof(argv[++i]);
+        else if (argument == "--out" && hasValue) out = argv[++i];
+        else if (argument.compare(0, 2, "--") == 0) {
+            std::cerr << "Unknown option " << argument << std::endl;
+            return EXIT_FAILURE;
+        }
+        else paths.push_back(argument);
+    }
+
+    if (paths.empty()) {
+        std::cerr << "Usage: " << argv[0] << " <selfplay.bin>... [--epochs N] [--threads N] [--rate R] [--lambda L] [--out FILE]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    EvaluationTuner tuner(settings);
+
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string& path : paths) {
+        if (!tuner.load(path)) return EXIT_FAILURE;
+    }
+    double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("loaded %zu positions in %.1f s\n", tuner.getPositionCount(), loadSeconds);
+
+    if (tuner.getPositionCount() == 0) {
+        std::cerr << "No positions with a game result" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (tuner.getMismatches()) {
+        std::cerr << tuner.getMismatches() << " positions evaluate differently from their features, Evaluation.hpp is out of step" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    double scale = tuner.fitScale();
+    std::printf("scale K = %.3f, error %.6f\n", scale, tuner.error());
+
+    start = std::chrono::steady_clock::now();
+    for (int epoch = 1; epoch <= epochs; epoch++) {
+        double error = tuner.step();
+        if (epoch % 50 == 0 || epoch == 1) std::printf("epoch %4d  error %.6f\n", epoch, error);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (epochs > 0) {
+        std::printf("final error %.6f, %.1f ms per epoch\n", tuner.error(), seconds * 1000 / epochs);
+    }
+
+    if (!tuner.writeHeader(out)) return EXIT_FAILURE;
+    std::printf("wrote %s\n", out.c_str());
+    return EXIT_SUCCESS;
+
+}
@@ -0,0 +1,241 @@
+// Move validation server: keeps many games going at once and checks every move sent to it
+//
+// Usage: validator serve <socket> [--games N] [--threads N]
+//        validator bench <socket> [--games N] [--window N] [--seed N]
+//
+// serve runs until interrupted, with room for --games game ids (see ValidationServer.hpp for the
+// protocol). bench plays --games random games against a running server at once, their moves interleaved
+// and at most --window of them unanswered, then prints the validated moves per second and the server's
+// latency percentiles.
+
+#include <ValidationServer.hpp>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+const int BENCH_SAMPLE_GAMES = 256;     // distinct random games, shared out between the game ids
+const int BENCH_MAX_PLIES = 160;
+
+ValidationServer* server = nullptr;
+
+void handleInterrupt(int) {
+    if (server) server->stop();
+}
+
+int serve(int argc, char *argv[]) {
+
+    uint32_t games = 65536;
+    int threadCount = 0;
+
+    for (int i = 3; i < argc; i += 2) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << option << " needs a value" << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (option == "--games") games = std::strtoul(argv[i + 1], nullptr, 10);
+        else if (option == "--threads") threadCount = std::atoi(argv[i + 1]);
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    ValidationServer validationServer(games, threadCount);
+    if (!validationServer.listen(argv[2])) return EXIT_FAILURE;
+
+    server = &validationServer;
+    std::signal(SIGINT, handleInterrupt);
+    std::signal(SIGTERM, handleInterrupt);
+
+    std::printf("listening on %s, %u games in %.1f MB\n", argv[2], games, validationServer.getArenaBytes() / 1048576.0);
+    std::fflush(stdout);
+    validationServer.serve();
+    server = nullptr;
+
+    std::printf("stopped\n");
+    return EXIT_SUCCESS;
+
+}
+
+// A random game that stops where the server would end it, as coordinate moves
+std::vector<std::string> randomGame(std::mt19937_64& random) {
+
+    Board board;
+    MoveGenerator moveGenerator(board);
+    std::vector<Move> moves;
+    std::vector<U64> keys = {polyglotKey(board)};
+    std::vector<std::string> game;
+
+    while (static_cast<int>(game.size()) < BENCH_MAX_PLIES) {
+        moveGenerator.generateLegalMoves(moves);
+        if (moves.empty()) break;
+
+        const Move& move = moves[random() % moves.size()];
+        std::string text = {static_cast<char>('a' + move.fromPos % 8), static_cast<char>('1' + move.fromPos / 8),
+                            static_cast<char>('a' + move.toPos % 8), static_cast<char>('1' + move.toPos / 8)};
+        if (move.promotion != PieceType::EMPTY) text += static_cast<char>(tolower(pieceTypeToChar(move.promotion)));
+        game.push_back(text);
+
+        board.executeMove(move.piece, move.fromPos, move.toPos, move.promotion);
+        if (board.getHalfmoveClock() == 0) keys.clear();
+        keys.push_back(polyglotKey(board));
+
+        if (isDrawnByRule(board, std::count(keys.begin(), keys.end(), keys.back()))) break;
+    }
+    return game;
+
+}
+
+int bench(int argc, char *argv[]) {
+
+    int games = 10000;
+    size_t window = 512;
+    uint64_t seed = 1;
+
+    for (int i = 3; i < argc; i += 2) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << option << " needs a value" << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (option == "--games") games = std::atoi(argv[i + 1]);
+        else if (option == "--window") window = std::max(1, std::atoi(argv[i + 1]));
+        else if (option == "--seed") seed = std::strtoull(argv[i + 1], nullptr, 10);
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::mt19937_64 random(seed);
+    std::vector<std::vector<std::string>> samples;
+    for (int i = 0; i < BENCH_SAMPLE_GAMES; i++) samples.push_back(randomGame(random));
+
+    std::string path = argv[2];
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path too long: " << path << std::endl;
+        return EXIT_FAILURE;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        std::cerr << "Unable to connect to " << path << ": " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Answers are read on their own thread, which lets the writer send more as they come in
+    std::mutex mutex;
+    std::condition_variable answeredMore;
+    size_t sent = 0, answered = 0, rejected = 0;
+    bool closed = false;
+    std::string statsLine;
+
+    std::thread reader([&]() {
+        std::string pending;
+        char buffer[16384];
+        ssize_t length;
+        while ((length = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+            pending.append(buffer, length);
+            size_t start = 0, end;
+            size_t lines = 0, bad = 0;
+            std::string firstBad;
+            while ((end = pending.find('\n', start)) != std::string::npos) {
+                std::string line = pending.substr(start, end - start);
+                if (line.compare(0, 6, "stats ") == 0) statsLine = line;
+                else if (line.find(" illegal") != std::string::npos || line.find(" error") != std::string::npos
+                         || line.find(" over") != std::string::npos) {
+                    if (bad++ == 0) firstBad = line;
+                }
+                lines++;
+                start = end + 1;
+            }
+            pending.erase(0, start);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (bad && rejected == 0) std::cerr << "Unexpected answer: " << firstBad << std::endl;
+            answered += lines;
+            rejected += bad;
+            answeredMore.notify_all();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        answeredMore.notify_all();
+    });
+
+    auto submit = [&](const std::string& line) {
+        std::unique_lock<std::mutex> lock(mutex);
+        answeredMore.wait(lock, [&]() { return closed || sent - answered < window; });
+        if (closed) return false;
+        sent++;
+        lock.unlock();
+        return ::send(fd, line.data(), line.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(line.size());
+    };
+
+    bool connected = true;
+    for (int id = 0; id < games && connected; id++) connected = submit("new " + std::to_string(id) + "\n");
+
+    // The stats request resets the server's rate, so that it covers the moves alone
+    connected = connected && submit("stats\n");
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        answeredMore.wait(lock, [&]() { return closed || sent == answered; });
+    }
+
+    // One ply of every game at a time, so that every game is live at once
+    auto start = std::chrono::steady_clock::now();
+    size_t moveCount = 0;
+    std::string line;
+    for (int ply = 0; ply < BENCH_MAX_PLIES && connected; ply++) {
+        for (int id = 0; id < games && connected; id++) {
+            const std::vector<std::string>& game = samples[id % BENCH_SAMPLE_GAMES];
+            if (ply >= static_cast<int>(game.size())) continue;
+            line = "move " + std::to_string(id) + " " + game[ply] + "\n";
+            connected = submit(line);
+            moveCount++;
+        }
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        answeredMore.wait(lock, [&]() { return closed || sent == answered; });
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    connected = connected && submit("stats\n");
+    for (int id = 0; id < games && connected; id++) connected = submit("end " + std::to_string(id) + "\n");
+    shutdown(fd, SHUT_WR);
+    reader.join();
+    ::close(fd);
+
+    if (!connected) {
+        std::cerr << "Connection lost" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::printf("%d games, %zu moves in %.3f s: %.0f validated moves per second, %zu rejected\n", games, moveCount, seconds,
+                moveCount / seconds, rejected);
+    std::printf("%s\n", statsLine.c_str());
+    return rejected ? EXIT_FAILURE : EXIT_SUCCESS;
+
+}
+
+int main(int argc, char *argv[]){
+
+    std::string mode = argc > 1 ? argv[1] : "";
+
+    if (mode == "serve" && argc >= 3) return serve(argc, argv);
+    if (mode == "bench" && argc >= 3) return bench(argc, argv);
+
+    std::cerr << "Usage: " << argv[0] << " serve <socket> [--games N] [--threads N]" << std::endl;
+    std::cerr << "       " << argv[0] << " bench <socket> [--games N] [--window N] [--seed N]" << std::endl;
+    return EXIT_FAILURE;
+
+}